@@ -0,0 +1,1142 @@
+//
+// Performance benchmark suite for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2024 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+// Usage: bench [-n max_items] [-r reps] [-o out.json] [-b baseline.json]
+//              [-t threshold_percent] [name_filter]
+//
+// Every case is run 'reps' times with deterministic input; the minimum and
+// median wall clock times are reported as JSON (one result per line, so the
+// file can also be diffed and grepped). With -b the previous JSON output is
+// read back and each case is compared against it; the exit status is 1 if
+// any case got slower than the threshold (default 10%) or found wrong
+// results.
+//
+// Cases that need a graphics context are skipped if no X11 display can be
+// opened, the skipped cases are listed in the JSON output.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <unistd.h>
+
+#include "fltk/hdr/Fl.h"
+#include "fltk/hdr/platform.h"
+#include "fltk/hdr/Fl_Double_Window.h"
+#include "fltk/hdr/Fl_Tree.h"
+#include "fltk/hdr/Fl_Text_Buffer.h"
+#include "fltk/hdr/Fl_Text_Display.h"
+#include "fltk/hdr/Fl_Terminal.h"
+#include "fltk/hdr/Fl_Table.h"
+#include "fltk/hdr/Fl_Hold_Browser.h"
+#include "fltk/hdr/Fl_Image.h"
+#include "fltk/hdr/Fl_Pixmap.h"
+#include "fltk/hdr/Fl_GIF_Image.h"
+#include "fltk/hdr/Fl_Anim_GIF_Image.h"
+#include "fltk/hdr/Fl_SVG_Image.h"
+#include "fltk/hdr/filename.h"
+#include "fltk/src/Fl_Timeout.h"
+
+#define BENCH_MAX_REPS    50
+#define BENCH_MAX_RESULTS 256
+
+/**
+ One benchmark case: a setup function, the timed function and a teardown.
+ All three are called for every repetition but only run() is timed,
+ 'n' is the problem size passed to all three.
+*/
+struct Bench_Case {
+    const char* name;
+    int n;
+    int need_display;
+    void (*setup)(int n);
+    void (*run)(int n);
+    void (*teardown)(int n);
+};
+
+struct Bench_Result {
+    char name[80];
+    int n;
+    int reps;
+    double min_ms;
+    double median_ms;
+    double baseline_ms;         // < 0 if not in baseline
+};
+
+static Bench_Result G_results[BENCH_MAX_RESULTS];
+static int G_nresults = 0;
+static const struct Bench_Case* G_skipped[BENCH_MAX_RESULTS];
+static int G_nskipped = 0;
+static int G_have_display = 0;
+static int G_failures = 0;     // cases whose results were wrong
+
+static double now_ms() {
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+/**
+ Deterministic pseudo random numbers, so all runs see the same input
+*/
+static unsigned int G_seed = 1;
+static unsigned int bench_rand() {
+    G_seed = G_seed * 1103515245u + 12345u;
+    return (G_seed >> 16) & 0x7fff;
+}
+
+// --- Fl_Tree ---
+
+static Fl_Double_Window* G_win = 0;
+static Fl_Tree* G_tree = 0;
+
+/**
+ Populate the tree like RebuildTree() does in the 'chief' test app,
+ but with 'n' items spread over folders of 1000 items each.
+*/
+static void tree_populate(int n) {
+    char s[80];
+    G_tree->clear();
+    G_tree->sortorder(FL_TREE_SORT_NONE);
+    Fl_Tree_Item* folder = 0;
+    for (int t = 0; t < n; t++) {
+        if ((t % 1000) == 0) {
+            snprintf(s, 80, "%d Items", t);
+            folder = G_tree->add(s);
+        }
+        snprintf(s, 80, "item %07d", t + 1);
+        G_tree->add(folder, s);
+    }
+}
+
+static void tree_setup(int n) {
+    G_win = new Fl_Double_Window(400, 600, "bench");
+    G_tree = new Fl_Tree(0, 0, 400, 600);
+    G_tree->showroot(0);
+    G_win->end();
+    (void)n;
+}
+
+static void tree_setup_populated(int n) {
+    tree_setup(n);
+    tree_populate(n);
+}
+
+static void win_teardown(int) {
+    delete G_win;
+    G_win = 0;
+    G_tree = 0;
+}
+
+static void tree_build(int n) {
+    tree_populate(n);
+}
+
+static void tree_open_close(int) {
+    for (Fl_Tree_Item* i = G_tree->first(); i; i = i->next()) {
+        if (i->has_children()) i->close();
+    }
+    for (Fl_Tree_Item* i = G_tree->first(); i; i = i->next()) {
+        if (i->has_children()) i->open();
+    }
+}
+
+static void tree_clear(int) {
+    G_tree->clear();
+}
+
+static void tree_scroll(int) {
+    G_tree->calc_tree();
+    int ymax = G_tree->vposition() + 600 * 200;
+    for (int y = 0; y < ymax; y += 600) {
+        G_tree->vposition(y);
+        G_tree->calc_tree();
+    }
+}
+
+// --- Fl_Text_Buffer / Fl_Text_Display ---
+
+static Fl_Text_Buffer* G_buf = 0;
+static Fl_Text_Display* G_disp = 0;
+
+static const char* G_words[] = {
+    "the", "quick", "brown", "fox", "jumped", "over", "lazy", "dog",
+    "fltk", "widget", "buffer", "display", "0123456789", "\n"
+};
+
+static void buf_fill(int n) {
+    char line[256];
+    G_seed = 1;
+    for (int i = 0; i < n; i++) {
+        int len = 0;
+        int nw = 4 + bench_rand() % 16;
+        for (int w = 0; w < nw; w++)
+            len += snprintf(line + len, sizeof(line) - len, "%s ",
+                            G_words[bench_rand() % 13]);
+        line[len - 1] = '\n';
+        line[len] = 0;
+        G_buf->append(line, len);
+    }
+}
+
+static void buf_setup(int) {
+    G_buf = new Fl_Text_Buffer();
+}
+
+static void buf_setup_filled(int n) {
+    buf_setup(n);
+    buf_fill(n);
+}
+
+static void buf_teardown(int) {
+    delete G_buf;
+    G_buf = 0;
+}
+
+/**
+ Typing-like insertion: short runs of sequential inserts at random places
+*/
+static void buf_insert(int n) {
+    G_seed = 7;
+    int pos = 0;
+    for (int i = 0; i < n; i++) {
+        if ((i % 100) == 0)
+            pos = bench_rand() * (G_buf->length() / 0x7fff + 1) % (G_buf->length() + 1);
+        G_buf->insert(pos, "insert ");
+        pos += 7;
+    }
+}
+
+static void buf_search(int) {
+    int pos = 0, found;
+    while (G_buf->search_forward(pos, "jumped over", &found, 1))
+        pos = found + 1;
+}
+
+static void buf_count_lines(int) {
+    int len = G_buf->length();
+    for (int i = 0; i < 10; i++)
+        G_buf->count_lines(0, len);
+}
+
+static void disp_setup(int n) {
+    buf_setup_filled(n);
+    G_win = new Fl_Double_Window(600, 400, "bench");
+    G_disp = new Fl_Text_Display(0, 0, 600, 400);
+    G_disp->buffer(G_buf);
+    G_win->end();
+    G_win->show();
+    Fl::flush();
+}
+
+static void disp_teardown(int n) {
+    delete G_win;
+    G_win = 0;
+    G_disp = 0;
+    buf_teardown(n);
+}
+
+static void disp_wrap(int) {
+    G_disp->wrap_mode(Fl_Text_Display::WRAP_AT_BOUNDS, 0);
+    Fl::flush();
+    G_disp->wrap_mode(Fl_Text_Display::WRAP_NONE, 0);
+    Fl::flush();
+}
+
+static void disp_scroll(int) {
+    int lines = G_buf->count_lines(0, G_buf->length());
+    for (int l = 0; l < lines; l += 20) {
+        G_disp->scroll(l, 0);
+        Fl::flush();
+    }
+}
+
+// --- Fl_Terminal ---
+
+static Fl_Terminal* G_tty = 0;
+
+static void tty_setup(int) {
+    G_win = new Fl_Double_Window(800, 600, "bench");
+    // rows/cols/hist constructor: does not need the font system (issue 837)
+    G_tty = new Fl_Terminal(0, 0, 800, 600, 0, 40, 120, 1000);
+    G_tty->redraw_style(Fl_Terminal::NO_REDRAW);
+    G_win->end();
+}
+
+static void tty_flood(int n) {
+    static const char* colors[] = { "31", "32", "33", "34", "35", "36", "1;37", "0" };
+    char line[200];
+    for (int i = 0; i < n; i++) {
+        snprintf(line, sizeof(line),
+                 "\033[%smdrwxr-xr-x\033[0m  2 user group  4096 Jan  1 00:00 "
+                 "\033[1;%sm%07d\033[0m \033[2K\033[K\n",
+                 colors[i & 7], colors[(i >> 3) & 7], i);
+        G_tty->append(line);
+    }
+}
+
+static void tty_teardown(int) {
+    delete G_win;
+    G_win = 0;
+    G_tty = 0;
+}
+
+// A synthetic capture of full screen programs: 'ls --color' listings and
+// htop-like screen refreshes (cursor positioning, 256 color and RGB SGR,
+// private modes, charset selection, window title)
+static char* G_capture = 0;
+static int G_capture_len = 0;
+
+static void tty_setup_capture(int n) {
+    tty_setup(n);
+    int size = n * 2200, len = 0;
+    G_capture = (char*)malloc(size);
+    for (int i = 0; i < n; i++) {
+        if (size - len < 2200) break;
+        if (i % 4 == 0) {                   // ls --color
+            for (int j = 0; j < 8; j++)
+                len += snprintf(G_capture + len, size - len,
+                    "\033[0m\033[01;34mdir_%d_%d\033[0m  \033[01;32mrun.sh\033[0m  "
+                    "\033[38;5;%dmdata_%d.csv\033[0m  \xc3\xa9t\xc3\xa9.txt\n",
+                    i, j, 16 + (i + j) % 216, j);
+        } else {                            // htop-like refresh
+            len += snprintf(G_capture + len, size - len,
+                "\033]0;top - %d\007\033[?25l\033(B\033[H\033[2J", i);
+            for (int r = 1; r <= 10; r++) {
+                int pct = (i * 7 + r * 13) % 100;
+                len += snprintf(G_capture + len, size - len,
+                    "\033[%d;1H\033[38;2;%d;%d;40m%5d \033[38:5:%dmuser    "
+                    "\033[1;97;48;5;%dm%3d.%d%%\033[0m\033[K\033[%d;60H[\033[32m%.*s\033[m]",
+                    r, 200 - pct, 55 + pct, 1000 + r, 232 + r, 17 + r, pct, r, r,
+                    pct / 10, "||||||||||");
+            }
+            len += snprintf(G_capture + len, size - len, "\033[12;1H\033[?25h");
+        }
+    }
+    G_capture_len = len;
+}
+
+static void tty_replay(int) {
+    // replay in pipe sized chunks: splits sequences and UTF-8 chars
+    for (int i = 0; i < G_capture_len; i += 4096)
+        G_tty->append(G_capture + i, G_capture_len - i < 4096 ? G_capture_len - i : 4096);
+}
+
+static void tty_teardown_capture(int n) {
+    free(G_capture);
+    G_capture = 0;
+    tty_teardown(n);
+}
+
+// --- Fl_Table ---
+
+class Bench_Table : public Fl_Table {
+public:
+    Bench_Table(int X, int Y, int W, int H) : Fl_Table(X, Y, W, H) {
+        end();
+    }
+protected:
+    void draw_cell(TableContext, int = 0, int = 0, int = 0, int = 0, int = 0, int = 0) FL_OVERRIDE {}
+};
+
+static Bench_Table* G_table = 0;
+
+static void table_setup(int n) {
+    G_win = new Fl_Double_Window(800, 600, "bench");
+    G_table = new Bench_Table(0, 0, 800, 600);
+    G_table->rows(n);
+    G_table->cols(50);
+    G_table->row_header(1);
+    G_table->col_header(1);
+    G_win->end();
+}
+
+static void table_scroll(int n) {
+    for (int r = 0; r < n; r += n / 1000)
+        G_table->row_position(r);
+    G_table->row_position(0);
+}
+
+// --- Fl_Browser ---
+
+static Fl_Hold_Browser* G_browser = 0;
+
+static void browser_setup(int n) {
+    char s[80];
+    G_win = new Fl_Double_Window(400, 600, "bench");
+    G_browser = new Fl_Hold_Browser(0, 0, 400, 600);
+    for (int i = 0; i < n; i++) {
+        snprintf(s, 80, "process %05d\t%5d%%", i, 0);
+        G_browser->add(s);
+    }
+    G_win->end();
+    G_win->show();
+    Fl::flush();
+}
+
+static void browser_teardown(int) {
+    delete G_win;
+    G_win = 0;
+    G_browser = 0;
+}
+
+/**
+ Like a process monitor: every frame changes a status column of 30 of
+ the visible lines, which should not repaint the whole list.
+*/
+static void browser_update(int) {
+    char s[80];
+    G_seed = 7;
+    for (int frame = 0; frame < 100; frame++) {
+        for (int i = 0; i < 30; i++) {
+            int line = 1 + (int)(bench_rand() % 30);
+            snprintf(s, 80, "process %05d\t%5d%%", line - 1, (int)(bench_rand() % 100));
+            G_browser->text(line, s);
+        }
+        Fl::flush();
+    }
+}
+
+static const int G_browser_widths[] = { 120, 80, 60, 0 };
+
+static void browser_setup_columns(int n) {
+    char s[80];
+    G_win = new Fl_Double_Window(400, 600, "bench");
+    G_browser = new Fl_Hold_Browser(0, 0, 400, 600);
+    G_browser->column_widths(G_browser_widths);
+    for (int i = 0; i < n; i++) {
+        snprintf(s, 80, "@b%d\t@C%dname %d\t@r%d%%\tstatus", i, i % 8, i, i % 100);
+        G_browser->add(s);
+    }
+    G_win->end();
+    G_win->show();
+    Fl::flush();
+}
+
+static void browser_scroll(int n) {
+    for (int l = 1; l < n; l += n / 500) {
+        G_browser->topline(l);
+        Fl::flush();
+    }
+}
+
+// --- images ---
+
+static Fl_RGB_Image* G_img = 0;
+
+static void img_setup(int n) {
+    uchar* p = new uchar[n * n * 4];
+    G_seed = 3;
+    for (int i = 0; i < n * n * 4; i++) p[i] = (uchar)bench_rand();
+    G_img = new Fl_RGB_Image(p, n, n, 4);
+    G_img->alloc_array = 1;
+}
+
+static void img_teardown(int) {
+    delete G_img;
+    G_img = 0;
+}
+
+static void img_scale_nearest(int n) {
+    Fl_Image::RGB_scaling(FL_RGB_SCALING_NEAREST);
+    delete G_img->copy(n / 3, n / 3);
+    delete G_img->copy(n * 2, n * 2);
+}
+
+static void img_scale_bilinear(int n) {
+    Fl_Image::RGB_scaling(FL_RGB_SCALING_BILINEAR);
+    delete G_img->copy(n / 3, n / 3);
+    delete G_img->copy(n * 2, n * 2);
+    Fl_Image::RGB_scaling(FL_RGB_SCALING_NEAREST);
+}
+
+static void img_convert(int n) {
+    Fl_Image* c = G_img->copy();
+    c->desaturate();
+    c->color_average(FL_RED, 0.5f);
+    delete c;
+    (void)n;
+}
+
+static const char* G_xpm[] = {
+    "16 16 4 1",
+    ".  c None",
+    "x  c #d8d833",
+    "@  c #808011",
+    "o  c red",
+    "................",
+    ".....@@@@.......",
+    "....@xxxx@......",
+    "@@@@@xxxx@@@@@@.",
+    "@xxxxxxxxxxxxx@.",
+    "@xxxxxxxxxxxxx@.",
+    "@xxxoooooooxxx@.",
+    "@xxxoooooooxxx@.",
+    "@xxxoooooooxxx@.",
+    "@xxxoooooooxxx@.",
+    "@xxxxxxxxxxxxx@.",
+    "@xxxxxxxxxxxxx@.",
+    "@xxxxxxxxxxxxx@.",
+    "@@@@@@@@@@@@@@@.",
+    "................",
+    "................"
+};
+
+static void img_xpm_convert(int n) {
+    Fl_Pixmap pxm(G_xpm);
+    for (int i = 0; i < n; i++) {
+        Fl_RGB_Image rgb(&pxm);
+    }
+}
+
+// --- GIF decoding ---
+
+// The test GIFs are made by a small LZW encoder, so no data files are needed
+
+struct Gif_Data {
+    uchar* data;
+    size_t len, cap;
+};
+
+static Gif_Data G_gif[4];       // photo-like, flat, flat interlaced, animation
+static unsigned int G_gif_bits; // bit accumulator of gif_code()
+static int G_gif_nbits;
+static uchar G_gif_block[256];  // data sub-block being filled
+
+static void gif_put(Gif_Data& g, uchar c) {
+    if (g.len == g.cap) {
+        g.cap = g.cap ? 2 * g.cap : 65536;
+        g.data = (uchar*)realloc(g.data, g.cap);
+    }
+    g.data[g.len++] = c;
+}
+
+static void gif_word(Gif_Data& g, int v) {
+    gif_put(g, (uchar)(v & 255));
+    gif_put(g, (uchar)(v >> 8));
+}
+
+static void gif_flush_block(Gif_Data& g) {
+    if (!G_gif_block[0]) return;
+    for (int i = 0; i <= G_gif_block[0]; i++) gif_put(g, G_gif_block[i]);
+    G_gif_block[0] = 0;
+}
+
+static void gif_code(Gif_Data& g, int code, int size) {
+    G_gif_bits |= (unsigned int)code << G_gif_nbits;
+    for (G_gif_nbits += size; G_gif_nbits >= 8; G_gif_nbits -= 8, G_gif_bits >>= 8) {
+        G_gif_block[++G_gif_block[0]] = (uchar)G_gif_bits;
+        if (G_gif_block[0] == 255) gif_flush_block(g);
+    }
+}
+
+// Writes an image descriptor and the LZW data of 8-bit pixels
+static void gif_image(Gif_Data& g, const uchar* pix, int w, int h, int interlace) {
+    static int keys[5003], vals[5003];
+    const int bits = 8, clear = 1 << bits, first = clear + 2;
+    gif_put(g, 0x2c);
+    gif_word(g, 0); gif_word(g, 0); gif_word(g, w); gif_word(g, h);
+    gif_put(g, interlace ? 0x40 : 0);
+    gif_put(g, bits);
+    G_gif_bits = 0; G_gif_nbits = 0; G_gif_block[0] = 0;
+    // pixels in the order of the interlace passes
+    uchar* order = new uchar[w * h];
+    if (interlace) {
+        static const int start[4] = { 0, 4, 2, 1 }, step[4] = { 8, 8, 4, 2 };
+        uchar* o = order;
+        for (int p = 0; p < 4; p++)
+            for (int y = start[p]; y < h; y += step[p], o += w) memcpy(o, pix + y * w, w);
+    } else {
+        memcpy(order, pix, w * h);
+    }
+    int next = first, size = bits + 1;
+    memset(keys, -1, sizeof(keys));
+    gif_code(g, clear, size);
+    int prefix = order[0];
+    for (int i = 1; i < w * h; i++) {
+        int key = (prefix << 8) | order[i];
+        int k = (key * 31) % 5003;
+        while (keys[k] >= 0 && keys[k] != key) k = (k + 1) % 5003;
+        if (keys[k] == key) {
+            prefix = vals[k];
+            continue;
+        }
+        gif_code(g, prefix, size);
+        if (next < 4096) {
+            keys[k] = key;
+            vals[k] = next++;
+            if (next - 1 >= (1 << size) && size < 12) size++;
+        } else {
+            gif_code(g, clear, size);
+            next = first;
+            size = bits + 1;
+            memset(keys, -1, sizeof(keys));
+        }
+        prefix = order[i];
+    }
+    gif_code(g, prefix, size);
+    gif_code(g, clear + 1, size);
+    if (G_gif_nbits) gif_code(g, 0, 8 - G_gif_nbits);
+    gif_flush_block(g);
+    gif_put(g, 0);
+    delete[] order;
+}
+
+static void gif_header(Gif_Data& g, int w, int h) {
+    g.len = 0;
+    const char* sig = "GIF89a";
+    while (*sig) gif_put(g, (uchar)*sig++);
+    gif_word(g, w); gif_word(g, h);
+    gif_put(g, 0xf7); gif_put(g, 0); gif_put(g, 0);
+    for (int i = 0; i < 256; i++) {
+        gif_put(g, (uchar)i); gif_put(g, (uchar)(255 - i)); gif_put(g, (uchar)(i * 7));
+    }
+}
+
+static void gif_make(int) {
+    if (G_gif[0].len) return;
+    const int w = 640, h = 480;
+    uchar* pix = new uchar[w * h];
+    // photo-like: gradient with noise, short LZW strings
+    G_seed = 5;
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++) pix[y * w + x] = (uchar)((x + y) / 5 + bench_rand() % 6);
+    gif_header(G_gif[0], w, h);
+    gif_image(G_gif[0], pix, w, h, 0);
+    gif_put(G_gif[0], 0x3b);
+    // flat areas like a screenshot, long LZW strings
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++) pix[y * w + x] = (uchar)(((x / 40) ^ (y / 24)) * 13 + (x % 97 == 0));
+    for (int i = 1; i <= 2; i++) {
+        gif_header(G_gif[i], w, h);
+        gif_image(G_gif[i], pix, w, h, i == 2);
+        gif_put(G_gif[i], 0x3b);
+    }
+    delete[] pix;
+}
+
+// animation of n frames: a square moving over a gradient
+static void gif_make_anim(int n) {
+    static int frames = 0;
+    if (frames == n) return;
+    frames = n;
+    const int aw = 200, ah = 150;
+    uchar* frame = new uchar[aw * ah];
+    gif_header(G_gif[3], aw, ah);
+    for (int f = 0; f < n; f++) {
+        for (int y = 0; y < ah; y++)
+            for (int x = 0; x < aw; x++) {
+                int in = x >= f % aw && x < f % aw + 30 && y >= 60 && y < 90;
+                frame[y * aw + x] = (uchar)(in ? 255 : (x + y) / 2);
+            }
+        const uchar gce[] = { 0x21, 0xf9, 4, 0, 4, 0, 0, 0 };
+        for (size_t i = 0; i < sizeof(gce); i++) gif_put(G_gif[3], gce[i]);
+        gif_image(G_gif[3], frame, aw, ah, 0);
+    }
+    gif_put(G_gif[3], 0x3b);
+    delete[] frame;
+}
+
+static void gif_decode(int n) {
+    for (int i = 0; i < n; i++)
+        for (int k = 0; k < 3; k++) {
+            Fl_GIF_Image img("bench.gif", G_gif[k].data, G_gif[k].len);
+        }
+}
+
+static void gif_anim_decode(int) {
+    Fl_Anim_GIF_Image anim("bench_anim.gif", G_gif[3].data, G_gif[3].len, 0,
+                           Fl_Anim_GIF_Image::DONT_START);
+}
+
+// --- SVG parsing ---
+
+// An icon theme: n different icons of a few KB each, with gradients,
+// transforms, curves and style attributes like those of real themes
+
+#define SVG_MAX_ICONS 1000
+
+static char* G_svg[SVG_MAX_ICONS];
+
+static int svg_printf(char*& p, const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsprintf(p, fmt, ap);
+    va_end(ap);
+    p += n;
+    return n;
+}
+
+static void svg_make(int n) {
+    if (n > SVG_MAX_ICONS) n = SVG_MAX_ICONS;
+    if (G_svg[n - 1]) return;
+    G_seed = 7;
+    for (int i = 0; i < n; i++) {
+        char* buf = (char*)malloc(16384);
+        char* p = buf;
+        svg_printf(p, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                      "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"48\" height=\"48\" "
+                      "viewBox=\"0 0 48 48\" version=\"1.1\">\n"
+                      " <defs>\n  <linearGradient id=\"g%d\" x1=\"0\" y1=\"0\" x2=\"0\" y2=\"48\" "
+                      "gradientUnits=\"userSpaceOnUse\">\n"
+                      "   <stop offset=\"0\" style=\"stop-color:#%06x;stop-opacity:1\"/>\n"
+                      "   <stop offset=\"1\" style=\"stop-color:#%06x;stop-opacity:1\"/>\n"
+                      "  </linearGradient>\n </defs>\n"
+                      " <g transform=\"translate(%d.5,%d.25) scale(0.97)\">\n",
+                   i, bench_rand() * 511, bench_rand() * 511, i % 3, i % 5);
+        svg_printf(p, "  <rect x=\"4\" y=\"6\" width=\"40\" height=\"36\" rx=\"3\" "
+                      "style=\"fill:url(#g%d);stroke:#2e3436;stroke-width:1\"/>\n", i);
+        for (int k = 0; k < 12; k++) {
+            int x = 6 + bench_rand() % 30, y = 8 + bench_rand() % 28;
+            svg_printf(p, "  <path d=\"M %d.%d,%d.%d C %d.%d,%d.%d %d.%d,%d.%d %d.%d,%d.%d "
+                          "S %d,%d %d.5,%d.5 L %d,%d c 1.5,-2.25 3.125,0.5 4,1 z\" "
+                          "style=\"fill:#%06x;fill-opacity:0.%d;stroke:#%06x;stroke-width:0.%d;"
+                          "stroke-linecap:round;stroke-linejoin:round\"/>\n",
+                       x, bench_rand() % 10, y, bench_rand() % 10,
+                       x + 4, bench_rand() % 10, y - 3, bench_rand() % 10,
+                       x + 8, bench_rand() % 10, y + 3, bench_rand() % 10,
+                       x + 12, bench_rand() % 10, y, bench_rand() % 10,
+                       x + 9, y + 7, x + 4, y + 9, x, y + 5,
+                       bench_rand() * 511, 5 + bench_rand() % 5, bench_rand() * 511, 5 + bench_rand() % 5);
+        }
+        svg_printf(p, "  <circle cx=\"%d\" cy=\"%d\" r=\"%d.5\" fill=\"#ffffff\" opacity=\"0.6\"/>\n"
+                      "  <polygon points=\"10,40 18,30 26,36 34,26 40,40\" fill=\"none\" "
+                      "stroke=\"#%06x\" stroke-dasharray=\"2,1\"/>\n"
+                      " </g>\n</svg>\n",
+                   12 + i % 20, 14 + i % 17, 3 + i % 4, bench_rand() * 511);
+        G_svg[i] = buf;
+    }
+}
+
+static unsigned char* G_svg_bin[SVG_MAX_ICONS];
+static size_t G_svg_bin_len[SVG_MAX_ICONS];
+
+// parsed images are kept by Fl_SVG_Image, Fl::memory_trim() frees them
+static void svg_setup(int n) {
+    svg_make(n);
+    Fl::memory_trim();
+}
+
+static void svg_setup_cached(int n) {
+    svg_setup(n);
+    for (int i = 0; i < n; i++) {
+        Fl_SVG_Image svg(0, G_svg[i]);
+    }
+}
+
+static void svg_setup_precompiled(int n) {
+    svg_setup(n);
+    for (int i = 0; i < n && !G_svg_bin[i]; i++) {
+        Fl_SVG_Image svg(0, G_svg[i]);
+        G_svg_bin_len[i] = svg.precompiled_data(0, 0);
+        G_svg_bin[i] = (unsigned char*)malloc(G_svg_bin_len[i]);
+        svg.precompiled_data(G_svg_bin[i], G_svg_bin_len[i]);
+    }
+    Fl::memory_trim();
+}
+
+static void svg_parse(int n) {
+    for (int i = 0; i < n; i++) {
+        Fl_SVG_Image svg(0, G_svg[i]);
+    }
+}
+
+static void svg_load_precompiled(int n) {
+    for (int i = 0; i < n; i++) {
+        Fl_SVG_Image svg(0, G_svg_bin[i], G_svg_bin_len[i]);
+    }
+}
+
+// --- X font list cache ---
+
+static char** G_fonts = 0;     // fake XListFonts() result, unsorted
+static int G_nfonts = 0;       // while > 0, XListFonts() returns G_fonts
+static int G_list_calls = 0;   // XListFonts() calls that returned G_fonts
+static char G_font_dir[FL_PATH_MAX];
+static char* G_font_old_cache = 0;
+static char* G_font_table_live = 0;
+
+/**
+ XListFonts() of the linked fltk code: the fake font list in the processes
+ forked by font_table(), the X server's list everywhere else.
+*/
+char** XListFonts(Display* d, const char* pattern, int max, int* count) {
+    typedef char** (*List_Fonts)(Display*, const char*, int, int*);
+    static List_Fonts real = (List_Fonts)dlsym(RTLD_NEXT, "XListFonts");
+    if (!G_nfonts) return real(d, pattern, max, count);
+    G_list_calls++;
+    char** list = (char**)malloc(G_nfonts * sizeof(char*));
+    memcpy(list, G_fonts, G_nfonts * sizeof(char*));
+    *count = G_nfonts;
+    return list;
+}
+
+int XFreeFontNames(char** list) {
+    typedef int (*Free_Names)(char**);
+    static Free_Names real = (Free_Names)dlsym(RTLD_NEXT, "XFreeFontNames");
+    if (!G_nfonts) return real(list);
+    free(list);
+    return 1;
+}
+
+/**
+ Run Fl::set_fonts() on the fake font list in a child process, because the
+ font table can only be filled once. Returns the number of XListFonts()
+ calls on the first line, then every font added to the table with its
+ attributes and sizes, one per line.
+*/
+static char* font_table(int n) {
+    int fd[2];
+    if (pipe(fd)) return 0;
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fd[0]);
+        close(fd[1]);
+        return 0;
+    }
+    if (pid == 0) {
+        close(fd[0]);
+        // a connection of its own, the parent's one must not see any requests
+        fl_display = XOpenDisplay(0);
+        if (!fl_display) _exit(1);
+        G_nfonts = n;
+        FILE* fp = fdopen(fd[1], "w");
+        int nfonts = Fl::set_fonts(0);
+        fprintf(fp, "%d\n", G_list_calls);
+        for (int i = FL_FREE_FONT; i < nfonts; i++) {
+            int attr = 0, *sizes = 0;
+            const char* name = Fl::get_font_name((Fl_Font)i, &attr);
+            int nsizes = Fl::get_font_sizes((Fl_Font)i, sizes);
+            fprintf(fp, "%s %d:", name, attr);
+            for (int k = 0; k < nsizes; k++) fprintf(fp, " %d", sizes[k]);
+            fputc('\n', fp);
+        }
+        fclose(fp);
+        _exit(0);
+    }
+    close(fd[1]);
+    size_t len = 0, size = 1 << 16;
+    char* table = (char*)malloc(size);
+    ssize_t r;
+    while ((r = read(fd[0], table + len, size - len - 1)) > 0) {
+        len += r;
+        if (size - len < 4096) table = (char*)realloc(table, size *= 2);
+    }
+    table[len] = 0;
+    close(fd[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) || !len) {
+        free(table);
+        return 0;
+    }
+    return table;
+}
+
+/**
+ Make 'n' X font names with several foundries, weights, slants, sizes and
+ encodings per family, plus a few aliases, in random order. Point the font
+ cache to an empty directory and fill the font table from the X server,
+ which writes the cache.
+*/
+static void font_cache_setup(int n) {
+    static const char* foundries[] = { "adobe", "b&h", "misc", "urw" };
+    static const char* weights[] = { "medium", "bold", "demibold" };
+    static const char* slants[] = { "r", "i", "o" };
+    static const char* encodings[] = { "iso8859-1", "iso10646-1", "koi8-r" };
+    G_seed = 1;
+    G_fonts = (char**)malloc(n * sizeof(char*));
+    for (int i = 0; i < n; i++) {
+        char s[200];
+        unsigned int r = bench_rand();
+        if (r % 50 == 0)
+            snprintf(s, sizeof(s), "%dx%d", 5 + r % 7, 8 + r % 13);
+        else
+            snprintf(s, sizeof(s), "-%s-family %u-%s-%s-normal--%u-%u-75-75-%c-0-%s",
+                     foundries[r % 4], bench_rand() % (n / 40 + 1), weights[r % 3],
+                     slants[(r >> 2) % 3], r % 9 ? 6 + r % 30 : 0, (r % 9 ? 6 + r % 30 : 0) * 10,
+                     (r & 16) ? 'p' : 'm', encodings[(r >> 5) % 3]);
+        G_fonts[i] = strdup(s);
+    }
+    const char* tmp = getenv("TMPDIR");
+    snprintf(G_font_dir, sizeof(G_font_dir), "%s/fltk_bench_xfonts.XXXXXX",
+             tmp && *tmp ? tmp : "/tmp");
+    if (!mkdtemp(G_font_dir)) G_font_dir[0] = 0;
+    const char* old = getenv("XDG_CACHE_HOME");
+    G_font_old_cache = old ? strdup(old) : 0;
+    setenv("XDG_CACHE_HOME", G_font_dir, 1);
+    G_font_table_live = font_table(n);
+}
+
+static void font_cache_teardown(int n) {
+    if (G_font_dir[0]) {
+        char path[FL_PATH_MAX + 300];
+        snprintf(path, sizeof(path), "%s/fltk", G_font_dir);
+        DIR* dir = opendir(path);
+        if (dir) {
+            struct dirent* e;
+            while ((e = readdir(dir))) {
+                if (e->d_name[0] == '.') continue;
+                snprintf(path, sizeof(path), "%s/fltk/%s", G_font_dir, e->d_name);
+                unlink(path);
+            }
+            closedir(dir);
+            snprintf(path, sizeof(path), "%s/fltk", G_font_dir);
+            rmdir(path);
+        }
+        rmdir(G_font_dir);
+    }
+    if (G_font_old_cache) setenv("XDG_CACHE_HOME", G_font_old_cache, 1);
+    else unsetenv("XDG_CACHE_HOME");
+    free(G_font_old_cache);
+    G_font_old_cache = 0;
+    free(G_font_table_live);
+    G_font_table_live = 0;
+    for (int i = 0; i < n; i++) free(G_fonts[i]);
+    free(G_fonts);
+    G_fonts = 0;
+}
+
+/**
+ Fill the font table again, now from the cache written by the setup. It
+ must not list the fonts of the X server and must be the same table.
+*/
+static void font_cache_load(int n) {
+    char* cached = font_table(n);
+    const char* live = G_font_table_live;
+    if (!live || !cached || strncmp(live, "1\n", 2) || strncmp(cached, "0\n", 2) ||
+        strcmp(live + 2, cached + 2)) {
+        fprintf(stderr, "bench: FAILED font_cache_load: %s\n",
+                !live || !cached ? "can't fill the font table" :
+                strncmp(live, "1\n", 2) || strncmp(cached, "0\n", 2) ? "cache not used" :
+                "font table from the cache differs");
+        G_failures++;
+    }
+    free(cached);
+}
+
+// --- timeout and awake queues ---
+
+static int G_counter = 0;
+
+static void count_cb(void*) {
+    G_counter++;
+}
+
+static void timeout_queue(int n) {
+    for (int i = 0; i < n; i++)
+        Fl::add_timeout((i % 97) * 1.0, count_cb, (void*)(fl_intptr_t)i);
+    for (int i = 0; i < n; i += 2)
+        Fl::remove_timeout(count_cb, (void*)(fl_intptr_t)i);
+    Fl::remove_timeout(count_cb);
+}
+
+static void timeout_fire(int n) {
+    for (int i = 0; i < n; i++)
+        Fl::add_timeout(0.0, count_cb, 0);
+    Fl_Timeout::do_timeouts();
+}
+
+static void awake_queue(int n) {
+    Fl_Awake_Handler cb;
+    void* data;
+    for (int i = 0; i < n; i++) {
+        Fl::add_awake_handler_(count_cb, 0);
+        if (Fl::get_awake_handler_(cb, data) == 0) cb(data);
+    }
+}
+
+static void noop(int) {}
+
+/**
+ The list of all benchmark cases.
+ Cases with n > max_items (-n option) are skipped.
+*/
+static const Bench_Case G_cases[] = {
+    { "tree_build",        10000,   0, tree_setup,           tree_build,         win_teardown },
+    { "tree_build",        100000,  0, tree_setup,           tree_build,         win_teardown },
+    { "tree_build",        1000000, 0, tree_setup,           tree_build,         win_teardown },
+    { "tree_open_close",   10000,   0, tree_setup_populated, tree_open_close,    win_teardown },
+    { "tree_open_close",   100000,  0, tree_setup_populated, tree_open_close,    win_teardown },
+    { "tree_open_close",   1000000, 0, tree_setup_populated, tree_open_close,    win_teardown },
+    { "tree_clear",        10000,   0, tree_setup_populated, tree_clear,         win_teardown },
+    { "tree_clear",        100000,  0, tree_setup_populated, tree_clear,         win_teardown },
+    { "tree_clear",        1000000, 0, tree_setup_populated, tree_clear,         win_teardown },
+    { "tree_scroll",       10000,   1, tree_setup_populated, tree_scroll,        win_teardown },
+    { "tree_scroll",       100000,  1, tree_setup_populated, tree_scroll,        win_teardown },
+    { "tree_scroll",       1000000, 1, tree_setup_populated, tree_scroll,        win_teardown },
+    { "textbuf_insert",    100000,  0, buf_setup_filled,     buf_insert,         buf_teardown },
+    { "textbuf_search",    100000,  0, buf_setup_filled,     buf_search,         buf_teardown },
+    { "textbuf_count_lines", 100000, 0, buf_setup_filled,    buf_count_lines,    buf_teardown },
+    { "textdisp_wrap",     20000,   1, disp_setup,           disp_wrap,          disp_teardown },
+    { "textdisp_scroll",   20000,   1, disp_setup,           disp_scroll,        disp_teardown },
+    { "terminal_ansi_flood", 20000, 0, tty_setup,            tty_flood,          tty_teardown },
+    { "terminal_capture_replay", 20000, 0, tty_setup_capture, tty_replay,        tty_teardown_capture },
+    { "table_scroll",      100000,  0, table_setup,          table_scroll,       win_teardown },
+    { "browser_update",    2000,    1, browser_setup,        browser_update,     browser_teardown },
+    { "browser_scroll",    100000,  1, browser_setup_columns, browser_scroll,    browser_teardown },
+    { "image_scale_nearest", 512,   0, img_setup,            img_scale_nearest,  img_teardown },
+    { "image_scale_bilinear", 512,  0, img_setup,            img_scale_bilinear, img_teardown },
+    { "image_convert",     1024,    0, img_setup,            img_convert,        img_teardown },
+    { "image_xpm_convert", 10000,   1, noop,                 img_xpm_convert,    noop },
+    { "gif_decode",        20,      0, gif_make,             gif_decode,         noop },
+    { "gif_anim_decode",   200,     0, gif_make_anim,        gif_anim_decode,    noop },
+    { "svg_parse",         600,     0, svg_setup,            svg_parse,          noop },
+    { "svg_parse_cached",  600,     0, svg_setup_cached,     svg_parse,          noop },
+    { "svg_load_precompiled", 600,  0, svg_setup_precompiled, svg_load_precompiled, noop },
+    { "font_cache_load",   20000,   1, font_cache_setup,     font_cache_load,    font_cache_teardown },
+    { "timeout_queue",     10000,   0, noop,                 timeout_queue,      noop },
+    { "timeout_fire",      10000,   0, noop,                 timeout_fire,       noop },
+    { "awake_queue",       1000000, 0, noop,                 awake_queue,        noop },
+    { 0, 0, 0, 0, 0, 0 }
+};
+
+/**
+ Read the median times of a previous run.
+ Relies on the one-result-per-line layout written by write_json().
+*/
+static void load_baseline(const char* filename) {
+    FILE* fp = fopen(filename, "r");
+    if (!fp) {
+        fprintf(stderr, "bench: can't open baseline '%s'\n", filename);
+        return;
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), fp)) {
+        char name[80];
+        int n;
+        double median;
+        const char* p = strstr(line, "{\"name\": \"");
+        if (!p) continue;
+        if (sscanf(p, "{\"name\": \"%79[^\"]\", \"n\": %d,", name, &n) != 2) continue;
+        const char* m = strstr(p, "\"median_ms\": ");
+        if (!m || sscanf(m, "\"median_ms\": %lf", &median) != 1) continue;
+        for (int i = 0; i < G_nresults; i++) {
+            if (G_results[i].n == n && strcmp(G_results[i].name, name) == 0)
+                G_results[i].baseline_ms = median;
+        }
+    }
+    fclose(fp);
+}
+
+static void write_json(FILE* fp) {
+    fprintf(fp, "{\n  \"fltk_bench\": 1,\n  \"display\": %d,\n  \"results\": [\n", G_have_display);
+    for (int i = 0; i < G_nresults; i++) {
+        Bench_Result& r = G_results[i];
+        fprintf(fp, "    {\"name\": \"%s\", \"n\": %d, \"reps\": %d, \"min_ms\": %.3f, \"median_ms\": %.3f",
+                r.name, r.n, r.reps, r.min_ms, r.median_ms);
+        if (r.baseline_ms >= 0)
+            fprintf(fp, ", \"baseline_ms\": %.3f, \"ratio\": %.3f",
+                    r.baseline_ms, r.baseline_ms > 0 ? r.median_ms / r.baseline_ms : 0.0);
+        fprintf(fp, "}%s\n", (i + 1 < G_nresults) ? "," : "");
+    }
+    fprintf(fp, "  ],\n  \"skipped\": [");
+    for (int i = 0; i < G_nskipped; i++)
+        fprintf(fp, "%s\"%s/%d\"", i ? ", " : "", G_skipped[i]->name, G_skipped[i]->n);
+    fprintf(fp, "]\n}\n");
+}
+
+static void usage() {
+    fprintf(stderr, "usage: bench [-n max_items] [-r reps] [-o out.json] "
+                    "[-b baseline.json] [-t threshold_percent] [name_filter]\n");
+    exit(2);
+}
+
+int main(int argc, char* argv[]) {
+    int max_items = 1000000;
+    int reps = 5;
+    double threshold = 10.0;
+    const char* outname = 0;
+    const char* basename = 0;
+    const char* filter = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-' && i + 1 >= argc) usage();
+        if (!strcmp(argv[i], "-n")) max_items = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-r")) reps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-o")) outname = argv[++i];
+        else if (!strcmp(argv[i], "-b")) basename = argv[++i];
+        else if (!strcmp(argv[i], "-t")) threshold = atof(argv[++i]);
+        else if (argv[i][0] == '-') usage();
+        else filter = argv[i];
+    }
+    if (reps < 1) reps = 1;
+    if (reps > BENCH_MAX_REPS) reps = BENCH_MAX_REPS;
+
+    // Only open the display if there is one, so the suite can run headless
+    Display* d = XOpenDisplay(0);
+    if (d) {
+        fl_x11_use_display(d);
+        fl_open_display();
+        G_have_display = 1;
+    }
+
+    for (const Bench_Case* c = G_cases; c->name; c++) {
+        if (filter && !strstr(c->name, filter)) continue;
+        if (c->n > max_items) continue;
+        if (c->need_display && !G_have_display) {
+            G_skipped[G_nskipped++] = c;
+            continue;
+        }
+        double times[BENCH_MAX_REPS];
+        for (int r = 0; r < reps; r++) {
+            c->setup(c->n);
+            double t0 = now_ms();
+            c->run(c->n);
+            times[r] = now_ms() - t0;
+            c->teardown(c->n);
+        }
+        qsort(times, reps, sizeof(double), cmp_double);
+        Bench_Result& res = G_results[G_nresults++];
+        snprintf(res.name, sizeof(res.name), "%s", c->name);
+        res.n = c->n;
+        res.reps = reps;
+        res.min_ms = times[0];
+        res.median_ms = times[reps / 2];
+        res.baseline_ms = -1;
+        fprintf(stderr, "%-22s n=%-8d median %10.3f ms\n", c->name, c->n, res.median_ms);
+    }
+
+    if (basename) load_baseline(basename);
+
+    FILE* fp = outname ? fopen(outname, "w") : stdout;
+    if (!fp) {
+        fprintf(stderr, "bench: can't write '%s'\n", outname);
+        return 2;
+    }
+    write_json(fp);
+    if (fp != stdout) fclose(fp);
+
+    int regressions = 0;
+    for (int i = 0; i < G_nresults; i++) {
+        Bench_Result& r = G_results[i];
+        if (r.baseline_ms > 0 && r.median_ms > r.baseline_ms * (1.0 + threshold / 100.0)) {
+            fprintf(stderr, "bench: REGRESSION %s n=%d: %.3f ms -> %.3f ms\n",
+                    r.name, r.n, r.baseline_ms, r.median_ms);
+            regressions++;
+        }
+    }
+    return (regressions || G_failures) ? 1 : 0;
+}
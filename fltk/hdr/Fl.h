@@ -102,6 +102,11 @@ typedef void (*Fl_Awake_Handler)(void *data);
 /** Signature of add_idle callback functions passed as parameters */
 typedef void (*Fl_Idle_Handler)(void *data);
 
+/** Signature of budgeted idle callback functions, which should return
+    when \p deadline is reached.
+    \see Fl::add_idle(Fl_Idle_Slice_Handler, void*, int) */
+typedef void (*Fl_Idle_Slice_Handler)(void *data, Fl_Timestamp deadline);
+
 /** Signature of set_idle callback functions passed as parameters */
 typedef void (*Fl_Old_Idle_Handler)();
 
@@ -130,8 +135,48 @@ typedef int (*Fl_Event_Dispatch)(int event, Fl_Window *w);
 /** Signature of add_clipboard_notify functions passed as parameters */
 typedef void (*Fl_Clipboard_Notify_Handler)(int source, void *data);
 
+/** Signature of add_frame_handler functions passed as parameters */
+typedef void (*Fl_Frame_Handler)(void *data);
+
 /** @} */ /* group callback_functions */
 
+/**
+  Statistics of the frame scheduler, see Fl::frame_stats().
+*/
+struct Fl_Frame_Stats {
+  unsigned long frames;       ///< window flushes done
+  unsigned long input_frames; ///< flushes done without delay because of user input
+  unsigned long skipped;      ///< window flushes postponed by the frame rate cap
+  unsigned long coalesced;    ///< flushes that merged the damage of postponed ones
+};
+
+/**
+  Memory owners reported by Fl::memory_stats().
+*/
+enum Fl_Memory_Category {
+  FL_MEMORY_IMAGES = 0,   ///< pixel data of shared images
+  FL_MEMORY_IMAGE_CACHE,  ///< cached (drawable) forms of images
+  FL_MEMORY_TEXT_BUFFER,  ///< Fl_Text_Buffer gap buffers
+  FL_MEMORY_TEXT_UNDO,    ///< Fl_Text_Buffer undo buffers
+  FL_MEMORY_TERMINAL,     ///< Fl_Terminal ring buffers
+  FL_MEMORY_FONTS,        ///< font descriptors and the X fonts they load
+  FL_MEMORY_TREE,         ///< Fl_Tree items, labels and child arrays
+  FL_MEMORY_OFFSCREEN,    ///< offscreen buffers, including double buffered windows
+  FL_MEMORY_CONVERT,      ///< scratch buffers of the image drawing code
+  FL_MEMORY_CATEGORIES    ///< number of categories
+};
+
+/**
+  Memory accounting data, see Fl::memory_stats().
+  Sizes are in bytes. Memory held by the X server is estimated.
+*/
+struct Fl_Memory_Stats {
+  size_t live[FL_MEMORY_CATEGORIES];  ///< bytes currently held, per category
+  size_t peak[FL_MEMORY_CATEGORIES];  ///< highest live value, per category
+  size_t total;                       ///< sum of all live values
+  size_t total_peak;                  ///< highest total
+};
+
 
 /**
   The Fl is the FLTK global (static) class containing
@@ -504,10 +549,28 @@ public:
   static void add_idle(Fl_Idle_Handler cb, void* data = 0);
   static int  has_idle(Fl_Idle_Handler cb, void* data = 0);
   static void remove_idle(Fl_Idle_Handler cb, void* data = 0);
+  static void add_idle(Fl_Idle_Slice_Handler cb, void* data, int priority);
+  static int  has_idle(Fl_Idle_Slice_Handler cb, void* data = 0);
+  static void remove_idle(Fl_Idle_Slice_Handler cb, void* data = 0);
   /** If true then flush() will do something. */
   static int damage() {return damage_;}
   static void redraw();
   static void flush();
+
+  // frame scheduling:
+  static void frame_rate(double fps);
+  static double frame_rate();
+  static void add_frame_handler(Fl_Frame_Handler cb, void *data = 0);
+  static void remove_frame_handler(Fl_Frame_Handler cb, void *data = 0);
+  static void frame_stats(Fl_Frame_Stats &stats);
+  static void reset_frame_stats();
+
+  // memory accounting:
+  static void memory_accounting(int on);
+  static int memory_accounting();
+  static void memory_stats(Fl_Memory_Stats &stats);
+  static void reset_memory_peaks();
+  static size_t memory_trim();
   /** \addtogroup group_comdlg
     @{ */
   /**
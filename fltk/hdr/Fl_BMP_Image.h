@@ -30,11 +30,13 @@ class Fl_BMP_Image : public Fl_RGB_Image {
 public:
 
   Fl_BMP_Image(const char* filename);
+  Fl_BMP_Image(const char* filename, int W, int H);
   Fl_BMP_Image(const char* imagename, const unsigned char *data, const long length = -1);
 
 protected:
 
-  void load_bmp_(class Fl_Image_Reader &rdr, int ico_height = 0, int ico_width = 0);
+  void load_bmp_(class Fl_Image_Reader &rdr, int ico_height = 0, int ico_width = 0,
+                 int reduce_w = 0, int reduce_h = 0);
 
 };
 
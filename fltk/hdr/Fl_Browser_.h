@@ -93,12 +93,15 @@ class Fl_Browser_ : public Fl_Group {
   Fl_Color textcolor_;
   void* top_;           // which item scrolling position is in
   void* selection_;     // which is selected (except for FL_MULTI_BROWSER)
-  void *redraw1,*redraw2; // minimal update pointers
+  enum { DIRTY_LINES = 256 }; // lines that redraw_line() can track
+  unsigned int dirty_[DIRTY_LINES/32]; // minimal update: one bit per line from top_
+  int dirty_count_;     // lines from top_ shown by the last draw(), -1 if unknown
   void* max_width_item; // which item has max_width_
   int scrollbar_size_;  // size of scrollbar trough
   int linespacing_;
 
   void update_top();
+  void draw_line(void *item, int X, int Y, int W, int H);
 
 protected:
 
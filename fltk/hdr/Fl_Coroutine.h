@@ -0,0 +1,232 @@
+//
+// C++20 coroutine support header file for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2024 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/** \file
+   Awaitables that resume C++20 coroutines from the FLTK event loop. */
+
+#ifndef Fl_Coroutine_H
+#define Fl_Coroutine_H
+
+#if defined(__cpp_impl_coroutine)
+
+#include "Fl.h"
+#include <coroutine>
+#include <exception>
+#include <thread>
+
+/**
+  Coroutine support for the FLTK event loop.
+
+  This header is optional and needs a C++20 compiler; it is empty otherwise.
+  A coroutine returning fl::task runs on the UI thread and can wait for
+  the event loop without blocking it:
+
+  \code
+  fl::task blink(Fl_Widget *w) {
+    for (int i = 0; i < 10; i++) {
+      w->color(i & 1 ? FL_RED : FL_GRAY);
+      w->redraw();
+      co_await fl::sleep(250);
+    }
+  }
+  \endcode
+
+  The awaitables are the queue entries: they live in the coroutine frame
+  and are passed to Fl::add_timeout(), Fl::add_fd() or Fl::awake() as
+  the callback data, so suspending does not allocate. Destroying a
+  suspended coroutine, e.g. with task::cancel(), removes its pending
+  timeout or fd handler.
+*/
+namespace fl {
+
+/**
+  Handle of a coroutine started on the UI thread.
+
+  The coroutine runs until its first co_await when it is called and
+  destroys itself when it finishes. The task object does not own it:
+  it can be dropped without stopping the coroutine, or kept to cancel()
+  it while it is suspended.
+*/
+class task {
+public:
+  struct promise_type {
+    task *owner = nullptr;        // task object to clear when done
+    task get_return_object() {
+      return task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+    ~promise_type() { if (owner) owner->handle_ = nullptr; }
+  };
+
+  task() = default;
+  task(task &&o) noexcept : handle_(o.handle_) {
+    o.handle_ = nullptr;
+    if (handle_) handle_.promise().owner = this;
+  }
+  task &operator=(task &&o) noexcept {
+    if (this != &o) {
+      detach();
+      handle_ = o.handle_;
+      o.handle_ = nullptr;
+      if (handle_) handle_.promise().owner = this;
+    }
+    return *this;
+  }
+  task(const task &) = delete;
+  task &operator=(const task &) = delete;
+  ~task() { detach(); }
+
+  /** Returns true while the coroutine has not finished or been cancelled. */
+  bool running() const { return handle_ != nullptr; }
+
+  /**
+    Destroys the coroutine if it is suspended. Its pending timeout or fd
+    handler is removed and its local objects are destroyed, so the code
+    after the current co_await never runs.
+    Must be called on the UI thread; not allowed for a coroutine waiting
+    in on_ui_thread().
+  */
+  void cancel() {
+    if (!handle_) return;
+    std::coroutine_handle<promise_type> h = handle_;
+    detach();
+    h.destroy();
+  }
+
+private:
+  explicit task(std::coroutine_handle<promise_type> h) : handle_(h) {
+    h.promise().owner = this;
+  }
+  void detach() {
+    if (handle_) handle_.promise().owner = nullptr;
+    handle_ = nullptr;
+  }
+  std::coroutine_handle<promise_type> handle_ = nullptr;
+};
+
+/**
+  Awaitable returned by fl::sleep().
+  Resumes the coroutine from an Fl::add_timeout() callback.
+*/
+class sleep_awaiter {
+public:
+  explicit sleep_awaiter(double seconds) : seconds_(seconds) {}
+  sleep_awaiter(const sleep_awaiter &) = delete;
+  ~sleep_awaiter() { if (handle_) Fl::remove_timeout(cb, this); }
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> h) {
+    handle_ = h;
+    Fl::add_timeout(seconds_, cb, this);
+  }
+  void await_resume() const noexcept {}
+private:
+  static void cb(void *data) {
+    sleep_awaiter *a = (sleep_awaiter *)data;
+    std::coroutine_handle<> h = a->handle_;
+    a->handle_ = nullptr;         // timeout is gone
+    h.resume();
+  }
+  double seconds_;
+  std::coroutine_handle<> handle_ = nullptr;
+};
+
+/**
+  Awaitable returned by fl::readable() and fl::writable().
+  Resumes the coroutine from an Fl::add_fd() callback.
+*/
+class fd_awaiter {
+public:
+  fd_awaiter(int fd, int when) : fd_(fd), when_(when) {}
+  fd_awaiter(const fd_awaiter &) = delete;
+  ~fd_awaiter() { if (handle_) Fl::remove_fd(fd_, when_); }
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> h) {
+    handle_ = h;
+    Fl::add_fd(fd_, when_, cb, this);
+  }
+  void await_resume() const noexcept {}
+private:
+  static void cb(FL_SOCKET, void *data) {
+    fd_awaiter *a = (fd_awaiter *)data;
+    std::coroutine_handle<> h = a->handle_;
+    a->handle_ = nullptr;
+    Fl::remove_fd(a->fd_, a->when_);
+    h.resume();
+  }
+  int fd_, when_;
+  std::coroutine_handle<> handle_ = nullptr;
+};
+
+/**
+  Awaitable returned by fl::on_ui_thread().
+  Resumes the coroutine from an Fl::awake() callback.
+*/
+class ui_thread_awaiter {
+public:
+  ui_thread_awaiter() = default;
+  ui_thread_awaiter(const ui_thread_awaiter &) = delete;
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> h) {
+    handle_ = h;
+    while (Fl::awake(cb, this) < 0)   // awake queue full? wait for the UI thread
+      std::this_thread::yield();
+  }
+  void await_resume() const noexcept {}
+private:
+  static void cb(void *data) {
+    ((ui_thread_awaiter *)data)->handle_.resume();
+  }
+  std::coroutine_handle<> handle_ = nullptr;
+};
+
+/**
+  Suspends the coroutine for \p ms milliseconds.
+  \see Fl::add_timeout()
+*/
+inline sleep_awaiter sleep(double ms) { return sleep_awaiter(ms / 1000.0); }
+
+/**
+  Suspends the coroutine until data can be read from \p fd.
+  \note Fl::remove_fd(fd, FL_READ) is called when it resumes or is
+  cancelled, so don't use another FL_READ handler on the same fd.
+  \see Fl::add_fd()
+*/
+inline fd_awaiter readable(int fd) { return fd_awaiter(fd, FL_READ); }
+
+/**
+  Suspends the coroutine until data can be written to \p fd.
+  \see readable(int)
+*/
+inline fd_awaiter writable(int fd) { return fd_awaiter(fd, FL_WRITE); }
+
+/**
+  Moves the coroutine to the UI thread.
+
+  Use it in a coroutine resumed by a worker thread before touching
+  widgets. As with Fl::awake(), Fl::lock() must have been called once by
+  the UI thread. A coroutine waiting here can't be cancelled, since
+  Fl::awake() callbacks can't be removed.
+*/
+inline ui_thread_awaiter on_ui_thread() { return ui_thread_awaiter(); }
+
+} // namespace fl
+
+#endif // __cpp_impl_coroutine
+
+#endif // !Fl_Coroutine_H
@@ -0,0 +1,101 @@
+//
+// Widget draw profiler header file for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2024 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/** \file
+   Fl_Draw_Profiler, per-widget draw cost accounting. */
+
+#ifndef Fl_Draw_Profiler_H
+#define Fl_Draw_Profiler_H
+
+#include "Fl_Export.h"
+#include <stdio.h>
+
+class Fl_Widget;
+class Fl_Window;
+
+/**
+  The Fl_Draw_Profiler class measures how much time each widget spends
+  in its draw() method. It contains only static methods.
+
+  When enabled, every draw() called by Fl_Group::draw_child() and
+  Fl_Group::update_child(), and every window flush done by Fl::flush(),
+  is timed. For each widget the number of draws, the inclusive time
+  (with children), the self time (without children), the drawn pixel
+  area and the current redraw rate are kept.
+
+  The overlay mode frames every profiled widget after each flush in a color
+  going from green (cheap) to red (the most expensive widget of the last
+  second) and prints its redraws per second, so that widgets which redraw
+  on every timer tick or have a slow draw() stand out.
+
+  The profiler can be enabled without changing the program by setting the
+  environment variable \c FLTK_DRAW_PROFILER to \c 1 (statistics only) or
+  \c overlay. While it is enabled, Ctrl+Shift+F12 toggles the overlay.
+
+  \note Disabled, the profiler costs one test of a static flag per draw().
+*/
+class FL_EXPORT Fl_Draw_Profiler {
+public:
+  /** Profile data of one widget, times in seconds. */
+  struct Entry {
+    const Fl_Widget *widget;  ///< the profiled widget
+    int calls;                ///< number of draw() calls
+    double total;             ///< time spent in draw(), including children
+    double self;              ///< time spent in draw(), excluding children
+    double area;              ///< sum of the drawn widget areas in pixels
+    double rate;              ///< draw() calls per second during the last second
+    double recent;            ///< self time during the last second
+    int recent_calls;         // calls since the last rate update
+    double recent_self;       // self time since the last rate update
+  };
+
+  static void enable(int on = 1);
+  /** Returns non-zero if draw times are collected. */
+  static int enabled() { return enabled_ > 0; }
+  static void overlay(int on);
+  /** Returns non-zero if the heat-map overlay is shown. */
+  static int overlay() { return overlay_; }
+
+  static void reset();
+  static int count();
+  static const Entry *entry(int i);
+  static const Entry *find(const Fl_Widget *w);
+  /** Returns the number of Fl::flush() calls that drew anything since reset(). */
+  static int frames() { return frames_; }
+  static void print(FILE *out, int max = 20);
+
+  // internal hooks, called by Fl_Group, Fl_Widget and Fl::flush()
+
+  /** \cond DriverDev */
+  static void begin_(const Fl_Widget *w) { if (enabled_) push_(w); }
+  static void end_() { if (enabled_ > 0) pop_(); }
+  static void frame_begin_() { if (enabled_) frame_begin_i_(); }
+  static void window_flushed_(Fl_Window *win) { if (overlay_) draw_overlay_(win); }
+  static void forget_(const Fl_Widget *w) { if (enabled_ >= 0) forget_i_(w); }
+  /** \endcond */
+
+private:
+  static int enabled_;    // 1 = on, 0 = off, -1 = FLTK_DRAW_PROFILER not checked yet
+  static int overlay_;
+  static int frames_;
+  static void push_(const Fl_Widget *w);
+  static void pop_();
+  static void frame_begin_i_();
+  static void draw_overlay_(Fl_Window *win);
+  static void forget_i_(const Fl_Widget *w);
+};
+
+#endif // !Fl_Draw_Profiler_H
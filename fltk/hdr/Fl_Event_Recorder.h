@@ -0,0 +1,84 @@
+//
+// Event recorder header file for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2024 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/** \file
+   Fl_Event_Recorder, event stream capture and replay. */
+
+#ifndef Fl_Event_Recorder_H
+#define Fl_Event_Recorder_H
+
+#include "Fl_Export.h"
+
+class Fl_Window;
+
+/**
+  The Fl_Event_Recorder class captures the user input handed to
+  Fl::handle() and replays it later, measuring how long each event
+  took to handle and to flush. It contains only static methods.
+
+  Recording starts with start() or, without changing the application,
+  by setting the environment variable \c FLTK_RECORD_EVENTS to a file
+  name before the first event arrives. Only input events (mouse, keyboard,
+  focus and enter/leave) are recorded, together with the event state
+  (coordinates, modifiers, key, clicks, text) and the time since the
+  recording started.
+
+  replay() injects the events through Fl::handle(), either at the recorded
+  pace or as fast as possible, and calls Fl::flush() after each one.
+  Since nothing but Fl::handle() is used, a recording made with the X11
+  backend can be replayed with any backend, including test programs that
+  never map their windows.
+
+  \code
+    Fl_Event_Recorder::Stats st;
+    Fl_Event_Recorder::replay("session.fle", &st, 0.0, win);
+    printf("handle p99 %.3f ms, flush p99 %.3f ms\n",
+           st.handle_p99 * 1e3, st.flush_p99 * 1e3);
+  \endcode
+*/
+class FL_EXPORT Fl_Event_Recorder {
+  friend class Fl;
+public:
+  /**
+    Latency statistics of a replay() run, all times in seconds.
+  */
+  struct Stats {
+    int events;           ///< number of replayed events
+    double handle_p50;    ///< median time spent in Fl::handle()
+    double handle_p90;    ///< 90th percentile of Fl::handle() time
+    double handle_p99;    ///< 99th percentile of Fl::handle() time
+    double handle_max;    ///< slowest Fl::handle() call
+    double flush_p50;     ///< median time of the Fl::flush() after each event
+    double flush_p90;     ///< 90th percentile of Fl::flush() time
+    double flush_p99;     ///< 99th percentile of Fl::flush() time
+    double flush_max;     ///< slowest Fl::flush() call
+    double total;         ///< wall clock time of the whole replay
+  };
+
+  static int start(const char *filename);
+  static void stop();
+  /** Returns non-zero while events are being recorded. */
+  static int recording() { return recording_ > 0; }
+
+  static int replay(const char *filename, Stats *stats = 0,
+                    double speed = 0.0, Fl_Window *target = 0);
+
+private:
+  static int recording_;  // 1 = recording, 0 = off, -1 = FLTK_RECORD_EVENTS not checked yet
+  static void record_(int e, Fl_Window *window);
+};
+
+#endif // !Fl_Event_Recorder_H
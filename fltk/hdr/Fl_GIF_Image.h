@@ -31,6 +31,7 @@ class Fl_GIF_Image : public Fl_Pixmap {
 public:
 
   Fl_GIF_Image(const char* filename);
+  Fl_GIF_Image(const char* filename, int W, int H);
   // deprecated constructor w/o length (for backwards compatibility)
   Fl_GIF_Image(const char* imagename, const unsigned char *data);
   // constructor with length (since 1.4.0)
@@ -51,7 +52,7 @@ protected:
   // Protected default constructor needed for Fl_Anim_GIF_Image.
   Fl_GIF_Image();
 
-  void load_gif_(class Fl_Image_Reader &rdr, bool anim=false);
+  void load_gif_(class Fl_Image_Reader &rdr, bool anim=false, int reduce_w=0, int reduce_h=0);
 
   void load(const char* filename, bool anim);
   void load(const char* imagename, const unsigned char *data, const size_t length, bool anim);
@@ -80,7 +81,7 @@ protected:
 
 private:
 
-  void lzw_decode(Fl_Image_Reader &rdr, uchar *Image, int Width, int Height, int CodeSize, int ColorMapSize, int Interlace);
+  void lzw_decode(Fl_Image_Reader &rdr, uchar *Image, int Width, int Height, int CodeSize, int Interlace, class Fl_Image_Reducer *reducer = 0);
 };
 
 #endif
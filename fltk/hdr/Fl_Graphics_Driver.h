@@ -85,6 +85,7 @@ class Fl_Graphics_Driver {
   friend void fl_draw_image(Fl_Draw_Image_Cb cb, void* data, int X,int Y,int W,int H, int D);
   friend void fl_copy_offscreen(int x, int y, int w, int h, Fl_Offscreen pixmap, int srcx, int srcy);
   friend int fl_convert_pixmap(const char*const* cdata, uchar* out, Fl_Color bg);
+  friend int fl_convert_pixmap(const Fl_Pixmap *pxm, uchar *out, Fl_Color bg);
   friend void gl_start();
   /* ============== Implementation note about image drawing =========================
    A graphics driver can implement up to 6 virtual member functions to draw images:
@@ -32,6 +32,11 @@ class Fl_PNM_Image : public Fl_RGB_Image {
   public:
 
   Fl_PNM_Image(const char* filename);
+  Fl_PNM_Image(const char* filename, int W, int H);
+
+  private:
+
+  void load_pnm_(const char *filename, int reduce_w, int reduce_h);
 };
 
 #endif
@@ -43,6 +43,11 @@ struct NSVGimage;
 
  are not rendered.
 
+ Images made from the same file or data share the parsed SVG data, which
+ is kept for a while after the last of them is deleted, so that loading an
+ image again does not parse it again. Icons can also be precompiled into a
+ binary form that loads without parsing, see write_precompiled().
+
  The FLTK library can optionally be built without SVG support; in that case,
  class Fl_SVG_Image is unavailable.
 
@@ -134,10 +139,7 @@ struct NSVGimage;
  */
 class Fl_SVG_Image : public Fl_RGB_Image {
 private:
-  typedef struct {
-    NSVGimage* svg_image;
-    int ref_count;
-  } counted_NSVGimage;
+  struct counted_NSVGimage;
   counted_NSVGimage* counted_svg_image_;
   bool rasterized_;
   int raster_w_, raster_h_;
@@ -168,6 +170,8 @@ public:
   void draw(int X, int Y) { draw(X, Y, w(), h(), 0, 0); }
   Fl_SVG_Image *as_svg_image() FL_OVERRIDE { return this; }
   void normalize() FL_OVERRIDE;
+  size_t precompiled_data(unsigned char *buffer, size_t size) const;
+  int write_precompiled(const char *filename) const;
 };
 
 #endif // FL_SVG_IMAGE_H
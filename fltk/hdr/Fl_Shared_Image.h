@@ -41,6 +41,10 @@
 
   The provided buffer \p header must not be overwritten.
 
+  If Fl_Shared_Image::decode_size() returns a size, the image was requested
+  with FL_DECODE_REDUCED and your handler may load it reduced to that size.
+  Images of another size are resized by Fl_Shared_Image.
+
   If your handler function can identify the file type you must open the
   file and return a valid Fl_Image or derived type, otherwise you must
   return \c NULL.
@@ -72,6 +76,14 @@ typedef Fl_Image *(*Fl_Shared_Handler)(const char *name,
                                        uchar *header,
                                        int headerlen);
 
+/**
+  Decoding hints for Fl_Shared_Image::get(const char*, int, int, int).
+*/
+enum Fl_Decode_Hint {
+  FL_DECODE_FULL = 0,   ///< load the original image and resize a copy of it
+  FL_DECODE_REDUCED = 1 ///< load the image straight at the requested size if the format allows it
+};
+
 /**
   This class supports caching, loading, and drawing of image files.
 
@@ -106,12 +118,16 @@ protected:
   static Fl_Shared_Handler *handlers_;  // Additional format handlers
   static int    num_handlers_;          // Number of format handlers
   static int    alloc_handlers_;        // Allocated format handlers
+  static int    decode_w_;              // Reduced size requested from handlers
+  static int    decode_h_;
 
   const char    *name_;                 // Name of image file
   int           original_;              // Original image?
   int           refcount_;              // Number of times this image has been used
   Fl_Image      *image_;                // The image that is shared
   int           alloc_image_;           // Was the image allocated?
+  long          accounted_;             // Bytes reported to memory accounting
+  int           reduced_;               // Decoded at reduced size, without an original?
 
   static int    compare(Fl_Shared_Image **i0, Fl_Shared_Image **i1);
 
@@ -163,13 +179,22 @@ public:
   void uncache() FL_OVERRIDE;
 
   static Fl_Shared_Image *find(const char *name, int W = 0, int H = 0);
-  static Fl_Shared_Image *get(const char *name, int W = 0, int H = 0);
+  static Fl_Shared_Image *get(const char *name, int W = 0, int H = 0,
+                              int decode_hint = FL_DECODE_FULL);
   static Fl_Shared_Image *get(Fl_RGB_Image *rgb, int own_it = 1);
   static Fl_Shared_Image **images();
   static int            num_images();
   static void           add_handler(Fl_Shared_Handler f);
   static void           remove_handler(Fl_Shared_Handler f);
 
+  /**
+    Returns the size image handlers should decode the image to.
+    This is set while an image requested with FL_DECODE_REDUCED is loaded,
+    otherwise \p W and \p H are 0 and images are loaded at full size.
+    \see Fl_Shared_Handler
+  */
+  static void           decode_size(int &W, int &H) { W = decode_w_; H = decode_h_; }
+
   /**
     Returns a pointer to the internal Fl_Image object.
 
@@ -0,0 +1,166 @@
+//
+// Worker thread pool header file for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2024 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/** \file
+   Fl_Task_Pool, Fl_Task and Fl_Task_Token classes. */
+
+#ifndef Fl_Task_Pool_H
+#define Fl_Task_Pool_H
+
+#include "Fl_Export.h"
+
+class Fl_Task;
+class Fl_Task_Pool;
+struct Fl_Task_Pool_Data;
+
+/** Signature of the work and continuation functions of an Fl_Task. */
+typedef void (*Fl_Task_Func)(Fl_Task *task, void *data);
+
+/** Priorities of an Fl_Task, higher priority tasks are started first. */
+enum Fl_Task_Priority {
+  FL_TASK_LOW = 0,      ///< background work
+  FL_TASK_NORMAL,       ///< the default
+  FL_TASK_HIGH          ///< work the user is waiting for
+};
+
+/**
+  A cancellation flag shared by any number of tasks.
+
+  Tasks whose token is cancelled before they start are not run, their
+  continuation is still called (see Fl_Task::skipped()). Running tasks
+  can poll Fl_Task::cancelled() to stop early.
+
+  The token must live until all tasks using it are done.
+*/
+class FL_EXPORT Fl_Task_Token {
+  volatile int cancelled_;
+public:
+  Fl_Task_Token() : cancelled_(0) {}
+  /** Cancels all tasks using this token. Can be called by any thread. */
+  void cancel() { cancelled_ = 1; __sync_synchronize(); }
+  /** Returns non-zero if cancel() was called. */
+  int cancelled() const { return cancelled_; }
+  /** Clears the cancelled state, for reuse with new tasks. */
+  void reset() { cancelled_ = 0; }
+};
+
+/**
+  A unit of work for an Fl_Task_Pool.
+
+  The work is either a function given to the constructor or the run()
+  method of a derived class, and is called by a worker thread. When
+  then_on_ui() was called, the continuation (done() or the function given
+  to then_on_ui()) is called afterwards by the user interface thread,
+  through Fl::awake(). Continuations of tasks that finish close together
+  are called in one batch.
+
+  Tasks are normally created with \c new and deleted by the pool when
+  they are done, see auto_delete().
+
+  \code
+  static void load(Fl_Task *task, void *data)  { ... }  // worker thread
+  static void loaded(Fl_Task *task, void *data) { ... } // UI thread
+  Fl_Task_Pool::shared()->submit((new Fl_Task(load, doc))->then_on_ui(loaded, doc));
+  \endcode
+*/
+class FL_EXPORT Fl_Task {
+  friend class Fl_Task_Pool;
+  friend struct Fl_Task_Pool_Data;
+  Fl_Task_Func func_;
+  void *data_;
+  Fl_Task_Func then_;
+  void *then_data_;
+  Fl_Task_Token *token_;
+  Fl_Task_Pool_Data *pool_;
+  Fl_Task *next_;               // done list link
+  unsigned char priority_;
+  unsigned char ui_;            // call done() on the UI thread
+  unsigned char auto_delete_;
+  unsigned char skipped_;
+  volatile int finished_;
+protected:
+  virtual void run();
+  virtual void done();
+public:
+  Fl_Task(Fl_Task_Func func = 0, void *data = 0, int priority = FL_TASK_NORMAL);
+  virtual ~Fl_Task();
+
+  Fl_Task *then_on_ui(Fl_Task_Func cb = 0, void *data = 0);
+
+  /** Sets the cancellation token, before the task is submitted. */
+  Fl_Task *token(Fl_Task_Token *t) { token_ = t; return this; }
+  /** Returns the cancellation token or NULL. */
+  Fl_Task_Token *token() const { return token_; }
+  /** Sets the priority, see Fl_Task_Priority. */
+  void priority(int p) { priority_ = (unsigned char)(p < FL_TASK_LOW ? FL_TASK_LOW : p > FL_TASK_HIGH ? FL_TASK_HIGH : p); }
+  /** Returns the priority. */
+  int priority() const { return priority_; }
+  /** Returns non-zero if the task's token was cancelled. */
+  int cancelled() const { return token_ && token_->cancelled(); }
+  /** Returns non-zero if the work was not run because the task was cancelled first. */
+  int skipped() const { return skipped_; }
+  /** Returns non-zero when the work and the continuation are done. */
+  int finished() const { return finished_; }
+  /**
+    Sets whether the pool deletes the task when it is done (the default).
+    Tasks that are not deleted, e.g. on the stack, can be waited for
+    with Fl_Task_Pool::join().
+  */
+  void auto_delete(int v) { auto_delete_ = (unsigned char)(v != 0); }
+  /** Returns whether the pool deletes the task when it is done. */
+  int auto_delete() const { return auto_delete_; }
+};
+
+/**
+  A pool of worker threads running Fl_Task objects.
+
+  Each worker thread has a double-ended queue of tasks per priority:
+  tasks submitted by a task go to the end of its worker's queue and are
+  taken from there in last-in first-out order, idle workers steal tasks
+  from the front of other workers' queues. Tasks submitted by other
+  threads go to a shared first-in first-out queue.
+
+  FLTK uses the shared() pool for its own background work; applications
+  should use it too, rather than starting their own threads, so that
+  everything shares the processor cores. It is drained by Fl::run()
+  before it returns.
+
+  Continuations are delivered through Fl::awake(), so Fl::lock() must have
+  been called once by the user interface thread. submit() does that.
+
+  Without thread support (HAVE_PTHREAD is not set), submit() runs the
+  task and its continuation before it returns.
+*/
+class FL_EXPORT Fl_Task_Pool {
+  Fl_Task_Pool_Data *d_;
+  Fl_Task_Pool(const Fl_Task_Pool&);
+  Fl_Task_Pool& operator=(const Fl_Task_Pool&);
+public:
+  Fl_Task_Pool(int threads = 0);
+  ~Fl_Task_Pool();
+  static Fl_Task_Pool *shared();
+  int threads() const;
+  int pending() const;
+  void submit(Fl_Task *task);
+  void join(Fl_Task *task);
+  void wait();
+  void shutdown();
+  /** \cond DriverDev */
+  static void shutdown_shared_();
+  /** \endcond */
+};
+
+#endif // !Fl_Task_Pool_H
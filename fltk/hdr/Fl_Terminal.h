@@ -467,6 +467,7 @@ protected:
     void bgcolor_xterm(Fl_Color val)    { bgcolor_ = val;                        set_charflag(BG_XTERM); }
     void fgcolor_xterm(uchar val);
     void bgcolor_xterm(uchar val);
+    void color_xterm256(bool fg, int ci);
     //
     void defaultfgcolor(Fl_Color val)   { defaultfgcolor_ = val; }
     void defaultbgcolor(Fl_Color val)   { defaultbgcolor_ = val; }
@@ -584,11 +585,29 @@ protected:
   //
   // Manages ring with indexed row/col and "history" vs. "display" concepts.
   //
+  //    Each row has its own storage, which is allocated and brought to the
+  //    current column count when the row is first accessed. This way creating
+  //    or resizing the ring costs time proportional to the rows that are
+  //    actually shown, not to the size of the history.
+  //
   class RingBuffer {
-    Utf8Char *ring_chars_;    // the ring UTF-8 char buffer
+    struct Row {
+      Utf8Char *chars;        // the row's UTF-8 chars, NULL until first used
+      int cols;               // #columns valid in chars
+      int alloc;              // #columns allocated in chars
+      int gen;                // cols_gen_ when the row was last fitted
+    };
+    struct ColsChange {
+      int gen;                // cols_gen_ after the change
+      int cols;               // new #columns
+    };
+    Row *rows_;               // the ring's rows
+    int cols_gen_;            // incremented when ring_cols_ changes
+    ColsChange *cols_log_;    // changes with increasing gen and cols, see min_cols_since()
+    int cols_log_size_;
+    int cols_log_alloc_;
     int ring_rows_;           // #rows in ring total
     int ring_cols_;           // #columns in ring/hist/disp
-    int nchars_;              // #chars in ring (ring_rows*ring_cols)
     int hist_rows_;           // #rows in history
     int hist_use_;            // #rows in use by history
     int disp_rows_;           // #rows in display
@@ -596,6 +615,10 @@ protected:
 
 private:
     void new_copy(int drows, int dcols, int hrows, const CharStyle& style);
+    Utf8Char *row_chars(int row) const;
+    int min_cols_since(int gen) const;
+    void change_cols(int dcols);
+    void free_row(Row &r);
     //DEBUG    void write_row(FILE *fp, Utf8Char *u8c, int cols) const {
     //DEBUG      cols = (cols != 0) ? cols : ring_cols();
     //DEBUG      for ( int col=0; col<cols; col++, u8c++ ) {
@@ -616,7 +639,7 @@ private:
     //    to all the row accesses, and are clamped to within their bounds.
     //
     //    For 'raw' access to the ring (without the offset concept),
-    //    use the ring_chars() method, and walk from 0 - ring_rows().
+    //    use the u8c_ring_row() method, and walk from 0 - ring_rows().
     //
     //          _____________
     //         |             | <- hist_srow()  <- ring_srow()
@@ -654,8 +677,6 @@ private:
     inline int  hist_use(void)  const       { return hist_use_; }
     inline void hist_use(int val)           { hist_use_ = val; }
     inline int  hist_use_srow(void) const   { return((offset_ + hist_rows_ - hist_use_) % ring_rows_); }
-    inline Utf8Char *ring_chars(void)       { return ring_chars_; }  // access ring buffer directly
-    inline Utf8Char *ring_chars(void) const { return ring_chars_; }  // access ring buffer directly
 
     bool is_hist_ring_row(int grow) const;
     bool is_disp_ring_row(int grow) const;
@@ -732,29 +753,44 @@ private:
   // Handling of parsed sequences is NOT handled in this class,
   // just the parsing of the sequences and managing generic integers.
   //
+  // The parser is the DEC compatible state machine described by Paul Williams
+  // (https://vt100.net/emu/dec_ansi_parser), driven by a table indexed
+  // by state and byte that gives the action and the next state.
+  //
   class EscapeSeq {
   public:
     // EscapeSeq Constants
     // Maximums
-    static const int maxbuff   = 80;  // character buffer
     static const int maxvals   = 20;  // integer value buffer
+    static const int maxval    = 9999;// largest parameter value (prevent DoS attack)
     // Return codes
     static const int success   = 0;   // operation succeeded
     static const int fail      = -1;  // operation failed
     static const int completed = 1;   // multi-step operation completed successfully
+    static const int execute   = 2;   // byte is a control char to execute now
+    // Parser states
+    enum State {
+      GROUND = 0, ESCAPE, ESCAPE_INTERMEDIATE,
+      CSI_ENTRY, CSI_PARAM, CSI_INTERMEDIATE, CSI_IGNORE,
+      DCS_ENTRY, DCS_PARAM, DCS_INTERMEDIATE, DCS_PASSTHROUGH, DCS_IGNORE,
+      OSC_STRING, SOS_PM_APC_STRING,
+      NUM_STATES
+    };
   private:
-    char  esc_mode_;                  // escape parsing mode state
+    uchar state_;                     // parser State
+    char  esc_mode_;                  // final char of the completed sequence
     char  csi_;                       // This is an ESC[.. sequence (Ctrl Seq Introducer)
-    char  buff_[maxbuff];             // escape sequence being parsed
-    char *buffp_;                     // parsing ptr into buff[]
-    char *buffendp_;                  // end of buff[] (ptr to last valid buff char)
-    char *valbuffp_;                  // pointer to first char in buff of integer being parsed
+    char  private_;                   // private marker of a CSI (one of <=>?), 0 if none
+    char  inter_;                     // first intermediate char (0x20-0x2f), 0 if none
     int   vals_[maxvals];             // value array for parsing #'s in ESC[#;#;#..
-    int   vali_;                      // parsing index into vals_[], 0 if none
+    char  sub_[maxvals];              // 1 if vals_[i] followed a ':' (sub-parameter)
+    int   vali_;                      // #vals_[] parsed, 0 if none
     int   save_row_, save_col_;       // used by ESC[s/u for save/restore
 
-    int append_buff(char c);
-    int append_val(void);
+    static uchar table_[NUM_STATES][256];  // (action<<4)|next state, per state and byte
+    static void build_table(void);
+    void clear_vals(void);
+    void param(char c);
 
   public:
     EscapeSeq(void);
@@ -763,6 +799,9 @@ private:
     void esc_mode(char val);
     int  total_vals(void) const;
     int  val(int i) const;
+    bool is_sub(int i) const { return sub_[i] != 0; }
+    char private_mode(void) const { return private_; }
+    char intermediate(void) const { return inter_; }
     int  defvalmax(int dval, int max) const;
     bool parse_in_progress(void) const;
     bool is_csi(void) const;
@@ -1004,6 +1043,7 @@ private:
   bool is_printable(char c);
   bool is_ctrl(char c);
   void handle_SGR(void);
+  int  handle_SGR_color(int i);
   void handle_DECRARA(void);
   void handle_escseq(char c);
   // --
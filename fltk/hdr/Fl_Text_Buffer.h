@@ -186,6 +186,77 @@ typedef void (*Fl_Text_Modify_Cb)(int pos, int nInserted, int nDeleted,
 typedef void (*Fl_Text_Predelete_Cb)(int pos, int nDeleted, void* cbArg);
 
 
+/**
+ Conversions done by Fl_Text_Buffer::outputfile() and
+ Fl_Text_Buffer::savefile_background(). Without any, the UTF-8 text
+ is written unchanged.
+ */
+enum Fl_Text_Save_Flags {
+  FL_TEXT_SAVE_CRLF   = 1,  ///< write line ends as CR LF
+  FL_TEXT_SAVE_LATIN1 = 2   ///< write ISO-8859-1, other characters become '?'
+};
+
+
+/**
+ Called by Fl_Text_Buffer::savefile_background() in the user interface thread.
+ \param done    bytes of the text written so far
+ \param total   bytes of the text to write
+ \param status  -1 while saving, else the result as returned by Fl_Text_Buffer::outputfile()
+ \param data    the user data passed to savefile_background()
+ */
+typedef void (*Fl_Text_Save_Cb)(int done, int total, int status, void *data);
+
+
+/**
+ \brief An immutable view of the text of an Fl_Text_Buffer.
+
+ A snapshot is returned by Fl_Text_Buffer::snapshot(). It shares the text
+ storage with the buffer, so taking it does not copy the text. The buffer
+ copies its storage the first time it has to change bytes that a snapshot
+ still sees; typing at the insert position usually does not.
+
+ All methods of a snapshot may be called from any thread, also while the
+ buffer is being edited. Positions are byte offsets into the text as it was
+ when the snapshot was taken, version() tells which state that was.
+
+ A snapshot is reference counted: it is created with one reference, which
+ the caller must drop with release().
+ */
+class Fl_Text_Snapshot {
+  friend class Fl_Text_Buffer;
+public:
+  /** Adds a reference, for instance before handing the snapshot to another thread. */
+  void retain();
+  /** Drops a reference, the snapshot is deleted when the last one is gone. */
+  void release();
+
+  /** Returns the number of bytes in the snapshot. */
+  int length() const { return mLength; }
+  /** Returns Fl_Text_Buffer::version() at the time the snapshot was taken. */
+  unsigned version() const { return mVersion; }
+
+  char byte_at(int pos) const;
+  unsigned int char_at(int pos) const;
+  int line_start(int pos) const;
+  int line_end(int pos) const;
+  int range(int start, int end, const char **p1, int *n1,
+            const char **p2, int *n2) const;
+  char *text_range(int start, int end) const;
+
+private:
+  Fl_Text_Snapshot() { }
+  ~Fl_Text_Snapshot();
+  // like Fl_Text_Buffer::address()
+  const char *address(int pos) const
+  { return (pos < mGapStart) ? mBuf+pos : mBuf+pos+mGapEnd-mGapStart; }
+
+  char *mBuf;           // shared storage of the buffer
+  int mLength, mGapStart, mGapEnd;
+  unsigned mVersion;
+  int mRefCount;
+};
+
+
 /**
  This class manages Unicode text displayed in one or more Fl_Text_Display widgets.
 
@@ -264,6 +335,15 @@ public:
    */
   char byte_at(int pos) const;
 
+  Fl_Text_Snapshot *snapshot() const;
+
+  /**
+   \brief Returns a number that changes whenever the text changes.
+   Compare it with Fl_Text_Snapshot::version() to find out whether
+   positions in a snapshot still match the buffer.
+   */
+  unsigned version() const { return mVersion; }
+
   /**
    Convert a byte offset in buffer into a memory address.
    \param pos byte offset into buffer
@@ -387,15 +467,28 @@ public:
 
   /**
    Writes the specified portions of the text buffer to a file.
+
+   The text is written to a temporary file in the same directory, which
+   then replaces \p file, so \p file is either updated completely or left
+   as it was. The replacement keeps the mode, owner and group of \p file.
+   Symbolic links, files with several hard links, special files, files
+   whose owner or group cannot be kept and files in directories where the
+   temporary file cannot be created are overwritten in place instead.
+   The text is written straight from the buffer, at most \p buflen bytes
+   per system call.
+
    Returns
     - 0 on success
     - non-zero on error (strerror() contains reason)
     - 1 indicates open for write failed (no data saved)
-    - 2 indicates error occurred while writing data (data was partially saved)
+    - 2 indicates error occurred while writing data (no data saved, or data
+      partially saved if the file was overwritten in place)
 
-   \see savefile(const char *file, int buflen)
+   \param flags  conversions, see Fl_Text_Save_Flags
+   \see savefile(const char *file, int buflen), savefile_background()
    */
-  int outputfile(const char *file, int start, int end, int buflen = 128*1024);
+  int outputfile(const char *file, int start, int end, int buflen = 128*1024,
+                 int flags = 0);
 
   /**
    Saves a text file from the current buffer.
@@ -410,6 +503,9 @@ public:
   int savefile(const char *file, int buflen = 128*1024)
   { return outputfile(file, 0, length(), buflen); }
 
+  void savefile_background(const char *file, Fl_Text_Save_Cb cb, void *data = 0,
+                           int flags = 0);
+
   /**
    Gets the tab width.
 
@@ -822,6 +918,12 @@ protected:
    */
   void reallocate_with_gap(int newGapStart, int newGapLen);
 
+  /**
+   Returns non-zero if writing bytes \p start to \p end of the storage would
+   change the text seen by a snapshot. The storage must be copied first then.
+   */
+  int shared_(int start, int end) const;
+
   char* selection_text_(Fl_Text_Selection* sel) const;
 
   /**
@@ -850,7 +952,9 @@ protected:
   int mLength;                    /**< length of the text in the buffer (the length
                                        of the buffer itself must be calculated:
                                        gapEnd - gapStart + length) */
-  char* mBuf;                     /**< allocated memory where the text is stored */
+  char* mBuf;                     /**< allocated memory where the text is stored,
+                                       shared with snapshots */
+  unsigned mVersion;              /**< incremented on every change of the text */
   int mGapStart;                  /**< points to the first character of the gap */
   int mGapEnd;                    /**< points to the first character after the gap */
   // The hardware tab distance used by all displays for this buffer,
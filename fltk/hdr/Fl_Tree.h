@@ -283,6 +283,8 @@ enum Fl_Tree_Reason {
   FL_TREE_REASON_DRAGGED    = FL_REASON_DRAGGED         ///< an item was dragged into a new place
 };
 
+struct Fl_Tree_Filter;
+
 class Fl_Tree : public Fl_Group {
   friend class Fl_Tree_Item;
   Fl_Tree_Item  *_root;                         // can be null!
@@ -293,6 +295,7 @@ class Fl_Tree : public Fl_Group {
   int            _scrollbar_size;               // size of scrollbar trough
   Fl_Tree_Item  *_lastselect;                   // last selected item
   char           _lastpushed;                   // FL_PUSH occurred on: 0=nothing, 1=open/close, 2=usericon, 3=label
+  Fl_Tree_Filter *_filter;                      // filter() state (can be null)
   void fix_scrollbar_order();
 
 protected:
@@ -377,6 +380,12 @@ public:
   int is_close(Fl_Tree_Item *item) const;
   int is_close(const char *path) const;
 
+  //////////////////////////
+  // Item filter methods
+  //////////////////////////
+  int filter(const char *text, int flags=0);
+  const char *filter() const;
+
   /////////////////////////
   // Item selection methods
   /////////////////////////
@@ -63,6 +63,7 @@
 ///
 class Fl_Tree;
 class Fl_Tree_Item {
+  friend class Fl_Tree;                         // filter() sets VISIBLE directly
   Fl_Tree                *_tree;                // parent tree
   const char             *_label;               // label (memory managed)
   Fl_Font                 _labelfont;           // label's font face
@@ -74,7 +75,8 @@ class Fl_Tree_Item {
     OPEN                = 1<<0,         ///> item is open
     VISIBLE             = 1<<1,         ///> item is visible
     ACTIVE              = 1<<2,         ///> item is active
-    SELECTED            = 1<<3          ///> item is selected
+    SELECTED            = 1<<3,         ///> item is selected
+    FILTERED            = 1<<4          ///> item was hidden by Fl_Tree::filter()
   };
   unsigned short _flags;                // misc flags
   int                     _xywh[4];             // xywh of this widget (if visible)
@@ -476,6 +478,7 @@ protected:
     if ( flag==OPEN || flag==VISIBLE ) {
       recalc_tree();            // may change tree geometry
     }
+    if ( flag==VISIBLE ) _flags &= ~FILTERED;   // no longer up to filter()
     if ( val ) _flags |= flag; else _flags &= ~flag;
   }
   /// See if flag set. Returns 0 or 1.
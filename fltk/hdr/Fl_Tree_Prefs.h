@@ -91,6 +91,17 @@ enum Fl_Tree_Item_Draw_Mode {
   FL_TREE_ITEM_HEIGHT_FROM_WIDGET=2     ///< If widget() defined, widget()'s height controls item's height
 };
 
+/// \enum Fl_Tree_Filter_Flags
+/// Bit flags that control how Fl_Tree::filter() matches item labels.
+///
+enum Fl_Tree_Filter_Flags {
+  FL_TREE_FILTER_SUBSTRING=0,   ///< Label contains the text anywhere, ignoring case (default)
+  FL_TREE_FILTER_PREFIX=1,      ///< Label starts with the text
+  FL_TREE_FILTER_CASE=2,        ///< Compare case sensitive
+  FL_TREE_FILTER_OPEN=4,        ///< Open the parents of matching items
+  FL_TREE_FILTER_INTERRUPT=8    ///< Give up when user input is waiting
+};
+
 class Fl_Tree_Item;
 typedef void (Fl_Tree_Item_Draw_Callback)(Fl_Tree_Item*, void*);
 
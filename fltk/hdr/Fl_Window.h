@@ -605,6 +605,8 @@ public:
   void draw_backdrop();
   int screen_num();
   void screen_num(int screen_num);
+  void frame_rate(double fps);
+  double frame_rate() const;
   static bool is_a_rescale();
   fl_uintptr_t os_id();
 
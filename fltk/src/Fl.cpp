@@ -26,6 +26,9 @@
 #include "Fl_Timeout.h"
 #include "../hdr/Fl_Window.h"
 #include "../hdr/Fl_Tooltip.h"
+#include "../hdr/Fl_Event_Recorder.h"
+#include "../hdr/Fl_Draw_Profiler.h"
+#include "../hdr/Fl_Task_Pool.h"
 #include "../hdr/fl_draw.h"
 
 #include <ctype.h>
@@ -594,7 +597,8 @@ void (*Fl::idle)(); // see Fl::add_idle.cxx for the add/remove functions
 
   If Fl::idle is set (non-NULL) this points at a function that executes
   the first idle callback and appends it to the end of the list of idle
-  callbacks. For details see static function call_idle() in Fl_add_idle.cxx.
+  callbacks, then the budgeted idle callbacks as long as the frame has
+  time left. For details see static function call_idle() in Fl_add_idle.cxx.
 
   If it is NULL then no idle callbacks are active and Fl::run_idle() returns
   immediately.
@@ -639,6 +643,9 @@ double Fl::wait(double time_to_wait) {
   exit directly for these).  A normal program will end main()
   with return Fl::run();.
 
+  Before it returns, the tasks queued in Fl_Task_Pool::shared() are
+  finished and their continuations called, see Fl_Task_Pool::shutdown().
+
   \note Fl::run() and Fl::wait() (but not Fl::wait(double)) both
   return when all FLTK windows are closed. Therefore, a MacOS FLTK
   application possessing Fl_Sys_Menu_Bar items able to create new windows
@@ -648,6 +655,7 @@ double Fl::wait(double time_to_wait) {
 */
 int Fl::run() {
   while (Fl_X::first) wait(FOREVER);
+  Fl_Task_Pool::shutdown_shared_();
   return 0;
 }
 
@@ -796,12 +804,124 @@ void Fl::redraw() {
   for (Fl_X* i = Fl_X::first; i; i = i->next) i->w->redraw();
 }
 
+////////////////////////////////////////////////////////////////
+// Frame scheduling:
+
+static double global_frame_interval = 0.0; // Fl::frame_rate() limit, 0 = none
+static Fl_Frame_Stats frame_stats_;
+
+struct frame_handler_link {
+  Fl_Frame_Handler cb;
+  void *data;
+  frame_handler_link *next;
+};
+static frame_handler_link *frame_handlers = 0;
+
+double Fl_Window_Driver::frame_interval() {
+  return (frame_interval_ < 0) ? global_frame_interval : frame_interval_;
+}
+
+// Only wakes up Fl::wait(), the following Fl::flush() draws postponed windows
+static void frame_due_cb(void *) {}
+
+// Calls all frame handlers once per frame interval (1/60 s if unlimited)
+static void frame_tick_cb(void *) {
+  for (frame_handler_link *l = frame_handlers; l; ) {
+    frame_handler_link *next = l->next; // the handler may remove itself
+    l->cb(l->data);
+    l = next;
+  }
+  if (frame_handlers)
+    Fl::repeat_timeout(global_frame_interval > 0 ? global_frame_interval : 1.0 / 60, frame_tick_cb);
+}
+
+/**
+  Limits how often windows are redrawn.
+
+  By default every Fl::flush(), i.e. every pass of Fl::wait(), draws all
+  damaged windows. With a limit, a window that was drawn less than
+  1/\p fps seconds ago keeps its damage and is drawn when its frame is due,
+  so any number of redraw() calls in between, e.g. from fast timers or data
+  feeds, are merged into one frame.
+
+  A window is always drawn without delay after user input (mouse and
+  keyboard events) to any window of its top-level window, and when only
+  exposed areas have to be repaired, so the limit does not add input
+  latency.
+
+  Fl_Window::frame_rate(double) sets a different limit per window.
+
+  \param[in] fps maximum frames per second, 0 (the default) for no limit
+  \see Fl::add_frame_handler(), Fl::frame_stats()
+*/
+void Fl::frame_rate(double fps) {
+  global_frame_interval = (fps > 0) ? 1.0 / fps : 0.0;
+}
+
+/** Returns the global frame rate limit, 0 if there is none. */
+double Fl::frame_rate() {
+  return (global_frame_interval > 0) ? 1.0 / global_frame_interval : 0.0;
+}
+
+/**
+  Adds a function that is called once per frame.
+
+  Frame handlers are meant for animations: they are called at the global
+  Fl::frame_rate(), or 60 times per second if there is no limit, and
+  usually update some state and call redraw(). All handlers run in the
+  same timeout, so their redraws end up in the same frame.
+
+  Adding the same \p cb and \p data twice has no effect.
+*/
+void Fl::add_frame_handler(Fl_Frame_Handler cb, void *data) {
+  for (frame_handler_link *l = frame_handlers; l; l = l->next)
+    if (l->cb == cb && l->data == data) return;
+  frame_handler_link *l = new frame_handler_link;
+  l->cb = cb;
+  l->data = data;
+  l->next = frame_handlers;
+  if (!frame_handlers)
+    Fl::add_timeout(global_frame_interval > 0 ? global_frame_interval : 1.0 / 60, frame_tick_cb);
+  frame_handlers = l;
+}
+
+/**
+  Removes a frame handler added with Fl::add_frame_handler().
+*/
+void Fl::remove_frame_handler(Fl_Frame_Handler cb, void *data) {
+  for (frame_handler_link **p = &frame_handlers; *p; p = &(*p)->next) {
+    if ((*p)->cb == cb && (*p)->data == data) {
+      frame_handler_link *l = *p;
+      *p = l->next;
+      delete l;
+      break;
+    }
+  }
+  if (!frame_handlers) Fl::remove_timeout(frame_tick_cb);
+}
+
+/**
+  Returns the statistics of the frame scheduler since the program
+  started or the last Fl::reset_frame_stats().
+*/
+void Fl::frame_stats(Fl_Frame_Stats &stats) {
+  stats = frame_stats_;
+}
+
+/** Resets the statistics returned by Fl::frame_stats(). */
+void Fl::reset_frame_stats() {
+  memset(&frame_stats_, 0, sizeof(frame_stats_));
+}
+
 /**
   Causes all the windows that need it to be redrawn and graphics forced
   out through the pipes.
 
   This is what wait() does before looking for events.
 
+  If a frame rate limit is set, windows whose frame is not yet due keep
+  their damage and are drawn by a later call, see Fl::frame_rate(double).
+
   Note: in multi-threaded applications you should only call Fl::flush()
   from the main thread. If a child thread needs to trigger a redraw event,
   it should instead call Fl::awake() to get the main thread to process the
@@ -810,13 +930,38 @@ void Fl::redraw() {
 void Fl::flush() {
   if (damage()) {
     damage_ = 0;
+    Fl_Draw_Profiler::frame_begin_();
+    double next_due = 0.0;
     for (Fl_X* i = Fl_X::first; i; i = i->next) {
       Fl_Window* wi = i->w;
-      if (Fl_Window_Driver::driver(wi)->wait_for_expose_value) {damage_ = 1; continue;}
+      Fl_Window_Driver *d = Fl_Window_Driver::driver(wi);
+      if (d->wait_for_expose_value) {damage_ = 1; continue;}
       if (!wi->visible_r()) continue;
       if (wi->damage()) {
-        Fl_Window_Driver::driver(wi)->flush();
+        // input to any window of a top-level window lifts the limit for all of them
+        Fl_Window *top = wi->top_window();
+        char input = Fl_Window_Driver::driver(top ? top : wi)->input_pending_;
+        double interval = d->frame_interval();
+        if (interval > 0 && !input && wi->damage() != FL_DAMAGE_EXPOSE) {
+          double left = interval - Fl::seconds_since(d->last_frame_);
+          if (left > 0) { // not yet due: keep damage and region for the next frame
+            d->deferred_++;
+            frame_stats_.skipped++;
+            if (next_due <= 0 || left < next_due) next_due = left;
+            damage_ = 1;
+            continue;
+          }
+        }
+        if (d->deferred_) frame_stats_.coalesced++;
+        if (input) frame_stats_.input_frames++;
+        frame_stats_.frames++;
+        d->deferred_ = 0;
+        d->last_frame_ = Fl::now();
+        Fl_Draw_Profiler::begin_(wi);
+        d->flush();
+        Fl_Draw_Profiler::end_();
         wi->clear_damage();
+        Fl_Draw_Profiler::window_flushed_(wi);
       }
       // destroy damage regions for windows that don't use them:
       if (i->region) {
@@ -824,7 +969,11 @@ void Fl::flush() {
         i->region = 0;
       }
     }
+    if (next_due > 0 && !Fl::has_timeout(frame_due_cb))
+      Fl::add_timeout(next_due, frame_due_cb);
   }
+  for (Fl_X* i = Fl_X::first; i; i = i->next)
+    Fl_Window_Driver::driver(i->w)->input_pending_ = 0;
   screen_driver()->flush();
 }
 
@@ -1346,9 +1495,21 @@ Fl_Event_Dispatch Fl::event_dispatch()
 
  \see Fl::add_handler(Fl_Event_Handler)
  \see Fl::event_dispatch(Fl_Event_Dispatch)
+ \see Fl_Event_Recorder
  */
 int Fl::handle(int e, Fl_Window* window)
 {
+  if (Fl_Event_Recorder::recording_)
+    Fl_Event_Recorder::record_(e, window);
+  switch (e) { // redraws caused by user input are not delayed, see Fl::flush()
+    case FL_PUSH: case FL_RELEASE: case FL_DRAG: case FL_MOVE:
+    case FL_MOUSEWHEEL: case FL_KEYBOARD: case FL_KEYUP:
+      if (window) { // recorded on the top-level window, see Fl::flush()
+        Fl_Window *top = window->top_window();
+        Fl_Window_Driver::driver(top ? top : window)->input_pending_ = 1;
+      }
+      break;
+  }
   if (e_dispatch) {
     return e_dispatch(e, window);
   } else {
@@ -342,22 +342,31 @@ void Fl_Anim_GIF_Image::FrameInfo::on_frame_data(Fl_GIF_Image::GIF_FRAME &gf) {
   // we know now everything we need about the frame..
   dispose(frames_size - 1);
 
-  // copy image data to offscreen
-  const uchar *bits = gf.bptr;
+  // copy image data to offscreen, clipped to the canvas
+  uchar pal[256][4];
+  for (int i = 0; i < 256; i++) {
+    pal[i][0] = gf.cpal[i].r;
+    pal[i][1] = gf.cpal[i].g;
+    pal[i][2] = gf.cpal[i].b;
+    pal[i][3] = T_NONE;
+  }
   const uchar *endp = offscreen + canvas_w * canvas_h * 4;
-  for (int y = frame.y; y < frame.y + frame.h; y++) {
-    for (int x = frame.x; x < frame.x + frame.w; x++) {
-      uchar c = *bits++;
-      if (c == gf.trans)
-        continue;
-      uchar *buf = offscreen;
-      buf += (y * canvas_w * 4 + (x * 4));
-      if (buf >= endp)
-        continue;
-      *buf++ = gf.cpal[c].r;
-      *buf++ = gf.cpal[c].g;
-      *buf++ = gf.cpal[c].b;
-      *buf = T_NONE;
+  int x0 = frame.x, x1 = frame.x + frame.w;
+  if (x1 > canvas_w) x1 = canvas_w;
+  int y1 = frame.y + frame.h;
+  if (y1 > canvas_h) y1 = canvas_h;
+  for (int y = frame.y; y < y1; y++) {
+    const uchar *bits = gf.bptr + (y - frame.y) * frame.w;
+    uchar *buf = offscreen + (y * canvas_w + x0) * 4;
+    if (gf.trans < 0) {
+      for (int x = x0; x < x1; x++, buf += 4)
+        memcpy(buf, pal[*bits++], 4);
+    } else {
+      for (int x = x0; x < x1; x++, buf += 4) {
+        uchar c = *bits++;
+        if (c != gf.trans)
+          memcpy(buf, pal[c], 4);
+      }
     }
   }
 
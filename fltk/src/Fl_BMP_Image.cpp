@@ -22,6 +22,7 @@
 
 #include "../hdr/Fl_BMP_Image.h"
 #include "Fl_Image_Reader.h"
+#include "Fl_Image_Reducer.h"
 #include "../hdr/fl_utf8.h"
 #include "../hdr/Fl.h"
 #include <stdio.h>
@@ -65,6 +66,32 @@ Fl_BMP_Image::Fl_BMP_Image(const char *filename) // I - File to read
   }
 }
 
+/**
+  This constructor loads the named BMP image reduced to \p W x \p H pixels.
+
+  The image is shrunk with a box filter while it is read, so that it is
+  never held in memory at full size. If the image is not larger than
+  \p W x \p H it is loaded at its own size, check data_w() and data_h().
+
+  Fl_Shared_Image::get() uses this to load thumbnails when it is called
+  with FL_DECODE_REDUCED.
+
+  \param[in] filename a full path and name pointing to a BMP file.
+  \param[in] W, H     size of the reduced image
+
+  \see Fl_BMP_Image::Fl_BMP_Image(const char *filename)
+*/
+Fl_BMP_Image::Fl_BMP_Image(const char *filename, int W, int H)
+: Fl_RGB_Image(0,0,0)
+{
+  Fl_Image_Reader rdr;
+  if (rdr.open(filename) == -1) {
+    ld(ERR_FILE_ACCESS);
+  } else {
+    load_bmp_(rdr, 0, 0, W, H);
+  }
+}
+
 /**
   This constructor loads a BMP image from memory.
 
@@ -128,8 +155,13 @@ Fl_BMP_Image::Fl_BMP_Image(const char *imagename, const unsigned char *data, con
   This method reads BMP image data and creates an RGB or RGBA image. The BMP
   format supports only 1 bit for alpha. To avoid code duplication, we use
   an Fl_Image_Reader that reads data from either a file or from memory.
+
+  If reduce_w and reduce_h are given, the image is reduced to that size
+  while it is read (see Fl_Image_Reducer), uncompressed rows that don't
+  contribute are skipped in the file.
 */
-void Fl_BMP_Image::load_bmp_(Fl_Image_Reader &rdr, int ico_height, int ico_width)
+void Fl_BMP_Image::load_bmp_(Fl_Image_Reader &rdr, int ico_height, int ico_width,
+                             int reduce_w, int reduce_h)
 {
   int   info_size,        // Size of info header
         width,            // Width of image (pixels)
@@ -154,6 +186,7 @@ void Fl_BMP_Image::load_bmp_(Fl_Image_Reader &rdr, int ico_height, int ico_width
   uchar colormap[256][3]; // Colormap
   uchar havemask;         // Single bit mask follows image data
   int   use_5_6_5;        // Use 5:6:5 for R:G:B channels in 16 bit images
+  Fl_Image_Reducer reducer; // Shrinks the rows while reading, if active
 
   // Implementation notes: Reader is already open at this point.
   // Use local variables (width, height) until image is complete
@@ -277,12 +310,21 @@ void Fl_BMP_Image::load_bmp_(Fl_Image_Reader &rdr, int ico_height, int ico_width
   if (offbits) rdr.seek((unsigned int)offbits);
   CHECK_ERROR
 
-  if (((size_t)width) * height * bDepth > max_size() ) {
+  // The mask follows the image data, so masked images can't be reduced
+  if (havemask || !Fl_Image_Reducer::can_reduce(width, height, reduce_w, reduce_h))
+    reduce_w = reduce_h = 0;
+
+  if (((size_t)(reduce_w ? reduce_w : width)) * (reduce_h ? reduce_h : height) * bDepth > max_size() ) {
     Fl::warning("BMP file \"%s\" is too large!\n", rdr.name());
     ld(ERR_FORMAT);
     return;
   }
-  array = new uchar[width * height * bDepth];
+  if (reduce_w) {
+    array = new uchar[reduce_w * reduce_h * bDepth];
+    reducer.start(width, height, reduce_w, reduce_h, bDepth, (uchar *)array);
+  } else {
+    array = new uchar[width * height * bDepth];
+  }
   alloc_array = 1;
 
   // Read the image data...
@@ -301,7 +343,17 @@ void Fl_BMP_Image::load_bmp_(Fl_Image_Reader &rdr, int ico_height, int ico_width
   }
 
   for (y = start_y; y != end_y; y += row_order) {
-    ptr = (uchar *)array + y * width * bDepth;
+    if (reducer.active()) {
+      // Rows without state can be skipped, RLE and 4-bit rows are decoded
+      if (!reducer.wants_row(y) && depth != 4 && !(depth == 8 && compression == BI_RLE8)) {
+        rdr.skip(((width * depth + 31) / 32) * 4);
+        CHECK_ERROR
+        continue;
+      }
+      ptr = reducer.row();
+    } else {
+      ptr = (uchar *)array + y * width * bDepth;
+    }
 
     switch (depth)
     {
@@ -504,7 +556,9 @@ void Fl_BMP_Image::load_bmp_(Fl_Image_Reader &rdr, int ico_height, int ico_width
         break;
     }
     CHECK_ERROR
+    if (reducer.wants_row(y)) reducer.add_row(y);
   }
+  reducer.finish();
 
   if (havemask) {
     for (y = height - 1; y >= 0; y --) {
@@ -531,8 +585,8 @@ void Fl_BMP_Image::load_bmp_(Fl_Image_Reader &rdr, int ico_height, int ico_width
   // Success: set image attributes and return
   // File is closed when returning...
 
-  w(width);
-  h(height);
+  w(reduce_w ? reduce_w : width);
+  h(reduce_h ? reduce_h : height);
   d(bDepth);
   ld(0);
 
@@ -25,6 +25,7 @@
 #include "../hdr/Fl_Widget.h"
 #include "../hdr/Fl_Menu_Item.h"
 #include "../hdr/Fl_Bitmap.h"
+#include "Fl_Memory.h"
 
 #include <stdlib.h>
 
@@ -106,6 +107,7 @@ Fl_Bitmap::~Fl_Bitmap() {
 
 void Fl_Bitmap::uncache() {
   if (id_) {
+    fl_memory_account(FL_MEMORY_IMAGE_CACHE, -fl_bitmask_bytes(cache_w_, cache_h_));
     fl_graphics_driver->delete_bitmask(id_);
     id_ = 0;
   }
@@ -48,11 +48,174 @@ struct FL_BLINE {       // data is in a linked list of these
   FL_BLINE* next;
   void* data;
   Fl_Image* icon;
+  struct FL_BLINE_Layout* layout; // parsed txt or NULL, see line_layout()
   short length;         // sizeof(txt)-1, may be longer than string
   char flags;           // selected, displayed
   char txt[1];          // start of allocated array
 };
 
+// The @-codes and columns of a line are parsed once, by line_layout(),
+// and kept until the text or any of the browser settings they depend on
+// change. A field is the part of txt drawn in one column.
+
+#define FIELD_COLOR     1       // @C or @N, else textcolor()
+#define FIELD_BGCOLOR   2       // @B
+#define FIELD_ENGRAVED  4       // @-
+#define FIELD_UNDERLINE 8       // @_ or @u
+#define FIELD_ULCOLOR   16      // underline in ulcolor, else in textcolor()
+#define FIELD_PLAIN     32      // no control characters, fl_draw() would not change the text
+#define FIELD_UL_FIRST  64      // @_ before @-, draw the underline first
+
+struct FL_BLINE_Field {
+  int text;             // offset of the text in txt, after the @-codes
+  int end;              // offset of the column_char() or the end of txt
+  double width;         // width of the text, -1 if not measured yet
+  Fl_Font font;
+  Fl_Fontsize size;
+  Fl_Color color, bgcolor, ulcolor;
+  uchar flags;
+  uchar align;          // FL_ALIGN_LEFT, FL_ALIGN_CENTER or FL_ALIGN_RIGHT
+};
+
+struct FL_BLINE_Layout {
+  // browser settings the layout was made with:
+  Fl_Font font;
+  Fl_Fontsize size;
+  char format_char, column_char;
+  short columns;        // non-zero column_widths()
+  short nfields;
+  short max_fields;     // allocated fields
+  int height;           // item_height() without the icon
+  FL_BLINE_Field field[1];
+};
+
+static void free_line(FL_BLINE* l) {
+  free(l->layout);
+  free(l);
+}
+
+// Returns the layout of line l, parsing its text if it was not parsed yet
+// or the browser settings changed since.
+static FL_BLINE_Layout* line_layout(const Fl_Browser* b, FL_BLINE* l) {
+  Fl_Font font = b->textfont();
+  Fl_Fontsize size = b->textsize();
+  char fc = b->format_char(), cc = b->column_char();
+  int columns = 0;
+  if (cc) for (const int* i = b->column_widths(); *i; i++) columns++;
+  FL_BLINE_Layout* lay = l->layout;
+  if (lay && lay->font == font && lay->size == size && lay->format_char == fc &&
+      lay->column_char == cc && lay->columns == columns)
+    return lay;
+
+  // each column_char() can start a field, up to the number of columns:
+  int n = 1;
+  for (const char* s = l->txt; n <= columns && (s = strchr(s, cc)); s++) n++;
+  if (!lay || lay->max_fields < n) {
+    free(lay);
+    lay = (FL_BLINE_Layout*)malloc(sizeof(FL_BLINE_Layout) + (n-1)*sizeof(FL_BLINE_Field));
+    lay->max_fields = (short)n;
+    l->layout = lay;
+  }
+  lay->font = font;
+  lay->size = size;
+  lay->format_char = fc;
+  lay->column_char = cc;
+  lay->columns = (short)columns;
+
+  char* str = l->txt;
+  int k = 0;
+  for (;;) {
+    FL_BLINE_Field& f = lay->field[k++];
+    // find end of field and temporarily replace with 0:
+    char* e = k <= columns ? strchr(str, cc) : 0;
+    if (e) *e = 0;
+    f.width = -1;
+    f.font = font;
+    f.size = size;
+    f.flags = FIELD_PLAIN;
+    f.align = FL_ALIGN_LEFT;
+    // check for all the @-lines recognized by XForms:
+    if (fc) {
+      while (*str == fc && *++str && *str != fc) {
+        switch (*str++) {
+        case 'l': case 'L': f.size = 24; break;
+        case 'm': case 'M': f.size = 18; break;
+        case 's': f.size = 11; break;
+        case 'b': f.font = (Fl_Font)(f.font|FL_BOLD); break;
+        case 'i': f.font = (Fl_Font)(f.font|FL_ITALIC); break;
+        case 'f': case 't': f.font = FL_COURIER; break;
+        case 'c': f.align = FL_ALIGN_CENTER; break;
+        case 'r': f.align = FL_ALIGN_RIGHT; break;
+        case 'B':
+          f.bgcolor = (Fl_Color)strtoul(str, &str, 10);
+          f.flags |= FIELD_BGCOLOR;
+          break;
+        case 'C':
+          f.color = (Fl_Color)strtoul(str, &str, 10);
+          f.flags |= FIELD_COLOR;
+          break;
+        case 'F':
+          f.font = (Fl_Font)strtol(str, &str, 10);
+          break;
+        case 'N':
+          f.color = FL_INACTIVE_COLOR;
+          f.flags |= FIELD_COLOR;
+          break;
+        case 'S':
+          f.size = (int)strtol(str, &str, 10);
+          break;
+        case '-':
+          if (f.flags & FIELD_UNDERLINE) f.flags |= FIELD_UL_FIRST;
+          f.flags |= FIELD_ENGRAVED;
+          break;
+        case 'u':
+        case '_':
+          // underlined in the color set so far
+          f.flags |= FIELD_UNDERLINE;
+          if (f.flags & FIELD_COLOR) {f.ulcolor = f.color; f.flags |= FIELD_ULCOLOR;}
+          else f.flags &= ~FIELD_ULCOLOR;
+          break;
+        case '.':
+          goto BREAK;
+        }
+      }
+    }
+  BREAK:
+    f.text = (int)(str - l->txt);
+    for (; *str; str++)
+      if ((*str & 255) < ' ' || *str == 127) f.flags &= ~FIELD_PLAIN; // drawn as ^X
+    f.end = (int)(str - l->txt);
+    if (!e) break;
+    *e = cc; // put the separator back
+    str = e+1;
+  }
+  lay->nfields = (short)k;
+
+  // do each field separately as they may all set different fonts:
+  int hmax = 2; // use 2 to insure we don't return a zero!
+  int measured = 0;
+  for (k = 0; k < lay->nfields; k++) {
+    const FL_BLINE_Field& f = lay->field[k];
+    if (f.end > f.text || !measured) { // blank lines are exactly 1 line high
+      fl_font(f.font, f.size);
+      int hh = fl_height();
+      if (hh > hmax) hmax = hh;
+      measured = 1;
+    }
+  }
+  lay->height = hmax;
+  return lay;
+}
+
+// Returns the width of the text of field f of line l.
+static double field_width(FL_BLINE* l, FL_BLINE_Field& f) {
+  if (f.width < 0) {
+    fl_font(f.font, f.size);
+    f.width = fl_width(l->txt + f.text, f.end - f.text);
+  }
+  return f.width;
+}
+
 /**
   Returns the very first item in the list.
   Example of use:
@@ -226,7 +389,7 @@ FL_BLINE* Fl_Browser::_remove(int line) {
 */
 void Fl_Browser::remove(int line) {
   if (line < 1 || line > lines) return;
-  free(_remove(line));
+  free_line(_remove(line));
 }
 
 /**
@@ -290,6 +453,7 @@ void Fl_Browser::insert(int line, const char* newtext, void* d) {
   strcpy(t->txt, newtext);
   t->data = d;
   t->icon = 0;
+  t->layout = 0;
   insert(line, t);
 }
 
@@ -326,6 +490,7 @@ void Fl_Browser::text(int line, const char* newtext) {
     cache = n;
     n->data = t->data;
     n->icon = t->icon;
+    n->layout = t->layout;
     n->length = (short)l;
     n->flags = t->flags;
     n->prev = t->prev;
@@ -336,6 +501,7 @@ void Fl_Browser::text(int line, const char* newtext) {
     t = n;
   }
   strcpy(t->txt, newtext);
+  if (t->layout) t->layout->columns = -1; // parse the new text again
   redraw_line(t);
 }
 
@@ -362,48 +528,7 @@ int Fl_Browser::item_height(void *item) const {
   FL_BLINE* l = (FL_BLINE*)item;
   if (l->flags & NOTDISPLAYED) return 0;
 
-  int hmax = 2; // use 2 to insure we don't return a zero!
-
-  if (!l->txt[0]) {
-    // For blank lines set the height to exactly 1 line!
-    fl_font(textfont(), textsize());
-    int hh = fl_height();
-    if (hh > hmax) hmax = hh;
-  } else {
-    const int* i = column_widths();
-    // do each column separately as they may all set different fonts:
-    for (char* str = l->txt; str && *str; str++) {
-      Fl_Font font = textfont(); // default font
-      int tsize = textsize();    // default size
-      if ( format_char() ) {     // can be NULL
-        while (*str==format_char() && *str++ && *str!=format_char()) {
-          switch (*str++) {
-          case 'l': case 'L': tsize = 24; break;
-          case 'm': case 'M': tsize = 18; break;
-          case 's': tsize = 11; break;
-          case 'b': font = (Fl_Font)(font|FL_BOLD); break;
-          case 'i': font = (Fl_Font)(font|FL_ITALIC); break;
-          case 'f': case 't': font = FL_COURIER; break;
-          case 'B':
-          case 'C': while (isdigit(*str & 255)) str++; break; // skip a color number
-          case 'F': font = (Fl_Font)strtol(str,&str,10); break;
-          case 'S': tsize = (int)strtol(str,&str,10); break;
-          case '.': goto END_FORMAT;
-          }
-        }
-      }
-      END_FORMAT:
-      char* ptr = str;
-      if (ptr && *i++) str = strchr(str, column_char());
-      else str = NULL;
-      if((!str && *ptr) || (str && ptr < str) || hmax == 2) {
-        fl_font(font, tsize); int hh = fl_height();
-        if (hh > hmax) hmax = hh;
-      }
-      if (!str || !*str) break;
-    }
-  }
-
+  int hmax = line_layout(this, l)->height;
   if (l->icon && (l->icon->h()+2)>hmax) {
     hmax = l->icon->h() + 2;    // leave 2px above/below
   }
@@ -420,53 +545,16 @@ int Fl_Browser::item_height(void *item) const {
 */
 int Fl_Browser::item_width(void *item) const {
   FL_BLINE* l=(FL_BLINE*)item;
-  char* str = l->txt;
+  FL_BLINE_Layout* lay = line_layout(this, l);
   const int* i = column_widths();
+  int last = lay->nfields - 1;
   int ww = 0;
 
-  while (*i) { // add up all tab-separated fields
-    char* e;
-    e = strchr(str, column_char());
-    if (!e) break; // last one occupied by text
-    str = e+1;
-    ww += *i++;
-  }
-
-  // OK, we gotta parse the string and find the string width...
-  int tsize = textsize();
-  Fl_Font font = textfont();
-  int done = 0;
-
-  if ( format_char() ) {        // can be NULL
-    while (*str == format_char_ && str[1] && str[1] != format_char_) {
-      str ++;
-      switch (*str++) {
-      case 'l': case 'L': tsize = 24; break;
-      case 'm': case 'M': tsize = 18; break;
-      case 's': tsize = 11; break;
-      case 'b': font = (Fl_Font)(font|FL_BOLD); break;
-      case 'i': font = (Fl_Font)(font|FL_ITALIC); break;
-      case 'f': case 't': font = FL_COURIER; break;
-      case 'B':
-      case 'C': while (isdigit(*str & 255)) str++; break; // skip a color number
-      case 'F': font = (Fl_Font)strtol(str, &str, 10); break;
-      case 'S': tsize = (int)strtol(str, &str, 10); break;
-      case '.':
-        done = 1;
-        break;
-      }
-
-    if (done)
-      break;
-    }
-    if (*str == format_char_ && str[1])
-      str ++;
-  }
-
+  for (int k = 0; k < last; k++) ww += i[k]; // add up all tab-separated fields
   if (ww==0 && l->icon) ww = l->icon->w();
 
-  fl_font(font, tsize);
-  return ww + int(fl_width(str)) + 6;
+  // the last one is occupied by text:
+  return ww + int(field_width(l, lay->field[last])) + 6;
 }
 
 /**
@@ -501,91 +589,67 @@ int Fl_Browser::incr_height() const {
 */
 void Fl_Browser::item_draw(void* item, int X, int Y, int W, int H) const {
   FL_BLINE* l = (FL_BLINE*)item;
-  char* str = l->txt;
+  FL_BLINE_Layout* lay = line_layout(this, l);
   const int* i = column_widths();
 
-  bool firstLoop = true;        // for icon
-  while (W > 6) {       // do each tab-separated field
-    int w1 = W; // width for this field
-    char* e = 0; // pointer to end of field or null if none
-    if (*i) { // find end of field and temporarily replace with 0
-      e = strchr(str, column_char());
-      if (e) {*e = 0; w1 = *i++;}
-    }
+  for (int k = 0; k < lay->nfields && W > 6; k++) { // do each tab-separated field
+    FL_BLINE_Field& f = lay->field[k];
+    int last = (k == lay->nfields - 1);
+    int w1 = last ? W : i[k]; // width for this field
     // Icon drawing code
-    if (firstLoop) {
-      firstLoop = false;
-      if (l->icon) {
-        l->icon->draw(X+2,Y+1); // leave 2px left, 1px above
-        int iconw = l->icon->w()+2;
-        X += iconw; W -= iconw; w1 -= iconw;
-      }
+    if (k == 0 && l->icon) {
+      l->icon->draw(X+2,Y+1); // leave 2px left, 1px above
+      int iconw = l->icon->w()+2;
+      X += iconw; W -= iconw; w1 -= iconw;
     }
-    int tsize = textsize();
-    Fl_Font font = textfont();
-    Fl_Color lcol = textcolor();
-    Fl_Align talign = FL_ALIGN_LEFT;
-    // check for all the @-lines recognized by XForms:
-    //#if defined(__GNUC__)
-    //#warning FIXME This maybe needs to be more UTF8 aware now...?
-    //#endif /*__GNUC__*/
-    if ( format_char() ) {      // can be NULL
-      while (*str == format_char() && *++str && *str != format_char()) {
-        switch (*str++) {
-        case 'l': case 'L': tsize = 24; break;
-        case 'm': case 'M': tsize = 18; break;
-        case 's': tsize = 11; break;
-        case 'b': font = (Fl_Font)(font|FL_BOLD); break;
-        case 'i': font = (Fl_Font)(font|FL_ITALIC); break;
-        case 'f': case 't': font = FL_COURIER; break;
-        case 'c': talign = FL_ALIGN_CENTER; break;
-        case 'r': talign = FL_ALIGN_RIGHT; break;
-        case 'B':
-          if (!(l->flags & SELECTED)) {
-            fl_color((Fl_Color)strtoul(str, &str, 10));
-            fl_rectf(X, Y, w1, H);
-          } else while (isdigit(*str & 255)) str++; // skip digits
-          break;
-        case 'C':
-          lcol = (Fl_Color)strtoul(str, &str, 10);
-          break;
-        case 'F':
-          font = (Fl_Font)strtol(str, &str, 10);
-          break;
-        case 'N':
-          lcol = FL_INACTIVE_COLOR;
-          break;
-        case 'S':
-          tsize = (int)strtol(str, &str, 10);
-          break;
-        case '-':
-          fl_color(FL_DARK3);
-          fl_line(X+3, Y+H/2, X+w1-3, Y+H/2);
-          fl_color(FL_LIGHT3);
-          fl_line(X+3, Y+H/2+1, X+w1-3, Y+H/2+1);
-          break;
-        case 'u':
-        case '_':
-          fl_color(lcol);
-          fl_line(X+3, Y+H-1, X+w1-3, Y+H-1);
-          break;
-        case '.':
-          goto BREAK;
-        }
+    if ((f.flags & FIELD_BGCOLOR) && !(l->flags & SELECTED)) {
+      fl_color(f.bgcolor);
+      fl_rectf(X, Y, w1, H);
+    }
+    Fl_Color ulcol = (f.flags & FIELD_ULCOLOR) ? f.ulcolor : textcolor();
+    if (f.flags & FIELD_UL_FIRST) {
+      fl_color(ulcol);
+      fl_line(X+3, Y+H-1, X+w1-3, Y+H-1);
+    }
+    if (f.flags & FIELD_ENGRAVED) {
+      fl_color(FL_DARK3);
+      fl_line(X+3, Y+H/2, X+w1-3, Y+H/2);
+      fl_color(FL_LIGHT3);
+      fl_line(X+3, Y+H/2+1, X+w1-3, Y+H/2+1);
+    }
+    if ((f.flags & FIELD_UNDERLINE) && !(f.flags & FIELD_UL_FIRST)) {
+      fl_color(ulcol);
+      fl_line(X+3, Y+H-1, X+w1-3, Y+H-1);
+    }
+    if (f.end > f.text) {
+      Fl_Color lcol = (f.flags & FIELD_COLOR) ? f.color : textcolor();
+      if (l->flags & SELECTED)
+        lcol = fl_contrast(lcol, selection_color());
+      if (!active_r()) lcol = fl_inactive(lcol);
+      fl_color(lcol);
+      Fl_Align talign = last ? Fl_Align(f.align) : Fl_Align(f.align|FL_ALIGN_CLIP);
+      int tx = X+3, tw = w1-6;
+      char* str = l->txt + f.text;
+      char sep = l->txt[f.end];
+      l->txt[f.end] = 0; // temporarily end the text at the separator
+      if ((f.flags & FIELD_PLAIN) && !fl_draw_shortcut) {
+        // what fl_draw() does with one line of text, with the width measured once:
+        int tw1 = (int)(field_width(l, f) + .5);
+        if (f.align == FL_ALIGN_RIGHT) tx += tw - tw1;
+        else if (f.align == FL_ALIGN_CENTER) tx += (tw - tw1) / 2;
+        fl_font(f.font, f.size);
+        int ty = Y + (H - fl_height()) / 2 + fl_height() - fl_descent();
+        if (talign & FL_ALIGN_CLIP) fl_push_clip(X+3, Y, tw, H);
+        fl_draw(str, f.end - f.text, tx, ty);
+        if (talign & FL_ALIGN_CLIP) fl_pop_clip();
+      } else {
+        fl_font(f.font, f.size);
+        fl_draw(str, tx, Y, tw, H, talign, 0, 0);
       }
+      l->txt[f.end] = sep; // put the separator back
     }
-  BREAK:
-    fl_font(font, tsize);
-    if (l->flags & SELECTED)
-      lcol = fl_contrast(lcol, selection_color());
-    if (!active_r()) lcol = fl_inactive(lcol);
-    fl_color(lcol);
-    fl_draw(str, X+3, Y, w1-6, H, e ? Fl_Align(talign|FL_ALIGN_CLIP) : talign, 0, 0);
-    if (!e) break; // no more fields...
-    *e = column_char(); // put the separator back
     X += w1;
     W -= w1;
-    str = e+1;
   }
 }
 
@@ -681,7 +745,7 @@ void Fl_Browser::textsize(Fl_Fontsize newSize) {
 void Fl_Browser::clear() {
   for (FL_BLINE* l = first; l;) {
     FL_BLINE* n = l->next;
-    free(l);
+    free_line(l);
     l = n;
   }
   full_height_ = 0;
@@ -17,6 +17,7 @@
 #define DISPLAY_SEARCH_BOTH_WAYS_AT_ONCE
 
 #include <stdio.h>
+#include <string.h>
 #include "../hdr/Fl.h"
 #include "../hdr/Fl_Widget.h"
 #include "../hdr/Fl_Browser_.h"
@@ -113,19 +114,32 @@ void Fl_Browser_::resize(int X, int Y, int W, int H) {
         X, scrollbar.align()&FL_ALIGN_TOP ? Y-scrollsize : Y+H,
         W, scrollsize);
   max_width = 0;
+  dirty_count_ = -1;
 }
 
 // Cause minimal update to redraw the given item:
 /**
   This method should be called when the contents of \p item has changed,
   but not its height.
+
+  Any number of lines can be marked this way, draw() repaints only the
+  marked lines. Items that are not displayed are ignored. If the widget
+  was resized since it was last drawn or the item is too far down the
+  list, all lines are redrawn as with redraw_lines().
   \param[in] item The item that needs to be redrawn.
   \see redraw_lines(), redraw_line()
 */
 void Fl_Browser_::redraw_line(void* item) {
-  if (!redraw1 || redraw1 == item) {redraw1 = item; damage(FL_DAMAGE_EXPOSE);}
-  else if (!redraw2 || redraw2 == item) {redraw2 = item; damage(FL_DAMAGE_EXPOSE);}
-  else damage(FL_DAMAGE_SCROLL);
+  if (damage() & (FL_DAMAGE_SCROLL|FL_DAMAGE_ALL)) return; // all lines are redrawn
+  if (dirty_count_ < 0) {redraw_lines(); return;}
+  // find the line among those shown by the last draw():
+  int n = 0;
+  for (void* l = top_; l && n < dirty_count_; l = item_next(l), n++) {
+    if (l != item) continue;
+    if (n >= DIRTY_LINES) redraw_lines();
+    else {dirty_[n/32] |= 1U << (n%32); damage(FL_DAMAGE_EXPOSE);}
+    return;
+  }
 }
 
 // Figure out top() based on position():
@@ -321,6 +335,21 @@ void Fl_Browser_::display(void* item) {
 #endif
 }
 
+// Draw one line, the background is already erased unless it is selected:
+void Fl_Browser_::draw_line(void* l, int X, int Y, int W, int H) {
+  if (item_selected(l)) {
+    fl_color(active_r() ? selection_color() : fl_inactive(selection_color()));
+    fl_rectf(X, Y, W, H);
+  }
+  item_draw(l, X-hposition_, Y, W+hposition_, H);
+  if (l == selection_ && Fl::focus() == this) {
+    draw_box(FL_BORDER_FRAME, X, Y, W, H, color());
+    draw_focus(FL_NO_BOX, X, Y, W+1, H+1);
+  }
+  int ww = item_width(l);
+  if (ww > max_width) {max_width = ww; max_width_item = l;}
+}
+
 // redraw, has side effect of updating top and setting scrollbar:
 /**
   Draws the list within the normal widget bounding box.
@@ -390,42 +419,61 @@ J1:
   bbox(X, Y, W, H);
 
   fl_push_clip(X, Y, W, H);
-  // for each line, draw it if full redraw or scrolled.  Erase background
-  // if not a full redraw or if it is selected:
   void* l = top();
   int yy = -offset_;
-  for (; l && yy < H; l = item_next(l)) {
-    int hh = item_height(l) + linespacing();
-    if (hh <= 0) continue;
-    if ((damage()&(FL_DAMAGE_SCROLL|FL_DAMAGE_ALL)) || l == redraw1 || l == redraw2) {
-      if (item_selected(l)) {
-        fl_color(active_r() ? selection_color() : fl_inactive(selection_color()));
-        fl_rectf(X, yy+Y, W, hh);
-      } else if (!(damage()&FL_DAMAGE_ALL)) {
+  int n = 0; // lines from top_, including hidden ones
+  if (damage()&(FL_DAMAGE_SCROLL|FL_DAMAGE_ALL)) {
+    // for each line, draw it.  Erase background if not a full redraw:
+    for (; l && yy < H; l = item_next(l), n++) {
+      int hh = item_height(l) + linespacing();
+      if (hh <= 0) continue;
+      if (!(damage()&FL_DAMAGE_ALL) && !item_selected(l)) {
         fl_push_clip(X, yy+Y, W, hh);
         draw_box(box() ? box() : FL_DOWN_BOX, x(), y(), w(), h(), color());
         fl_pop_clip();
       }
-      item_draw(l, X-hposition_, yy+Y, W+hposition_, hh);
-      if (l == selection_ && Fl::focus() == this) {
-        draw_box(FL_BORDER_FRAME, X, yy+Y, W, hh, color());
-        draw_focus(FL_NO_BOX, X, yy+Y, W+1, hh+1);
+      draw_line(l, X, yy+Y, W, hh);
+      yy += hh;
+    }
+    // erase the area below last line:
+    if (!(damage()&FL_DAMAGE_ALL) && yy < H) {
+      fl_push_clip(X, yy+Y, W, H-yy);
+      draw_box(box() ? box() : FL_DOWN_BOX, x(), y(), w(), h(), color());
+      fl_pop_clip();
+    }
+  } else {
+    // only draw the lines marked by redraw_line(), adjacent ones are
+    // erased and clipped together:
+    void* run = 0; // first line of the current run of marked lines
+    int run_y = 0;
+    for (;; l = item_next(l), n++) {
+      int shown = l && yy < H;
+      int hh = shown ? item_height(l) + linespacing() : 0;
+      if (shown && hh <= 0) continue; // hidden lines don't end a run
+      int marked = shown && n < DIRTY_LINES && (dirty_[n/32] & (1U << (n%32)));
+      if (marked) {
+        if (!run) {run = l; run_y = yy;}
+      } else if (run) {
+        fl_push_clip(X, run_y+Y, W, yy-run_y);
+        draw_box(box() ? box() : FL_DOWN_BOX, x(), y(), w(), h(), color());
+        for (; run != l; run = item_next(run)) {
+          int rh = item_height(run) + linespacing();
+          if (rh <= 0) continue;
+          draw_line(run, X, run_y+Y, W, rh);
+          run_y += rh;
+        }
+        fl_pop_clip();
+        run = 0;
       }
-      int ww = item_width(l);
-      if (ww > max_width) {max_width = ww; max_width_item = l;}
+      if (!shown) break;
+      yy += hh;
     }
-    yy += hh;
-  }
-  // erase the area below last line:
-  if (!(damage()&FL_DAMAGE_ALL) && yy < H) {
-    fl_push_clip(X, yy+Y, W, H-yy);
-    draw_box(box() ? box() : FL_DOWN_BOX, x(), y(), w(), h(), color());
-    fl_pop_clip();
   }
   fl_pop_clip();
 
   fl_push_clip(x(),y(),w(),h());                // STR# 2886
-  redraw1 = redraw2 = 0;
+  memset(dirty_, 0, sizeof(dirty_));
+  dirty_count_ = n;
   if (!dont_repeat) {
     dont_repeat = 1;
     // see if changes to full_height caused by calls to slow_height
@@ -977,7 +1025,8 @@ Fl_Browser_::Fl_Browser_(int X, int Y, int W, int H, const char* L)
   max_width = 0;
   max_width_item = 0;
   scrollbar_size_ = 0;
-  redraw1 = redraw2 = 0;
+  memset(dirty_, 0, sizeof(dirty_));
+  dirty_count_ = -1;
   end();
 }
 
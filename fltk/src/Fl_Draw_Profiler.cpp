@@ -0,0 +1,289 @@
+//
+// Widget draw profiler for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2024 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include "../hdr/Fl_Draw_Profiler.h"
+#include "../hdr/Fl.h"
+#include "../hdr/Fl_Window.h"
+#include "../hdr/fl_draw.h"
+#include "../hdr/fl_utf8.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int Fl_Draw_Profiler::enabled_ = -1;
+int Fl_Draw_Profiler::overlay_ = 0;
+int Fl_Draw_Profiler::frames_ = 0;
+
+// Entries are kept in a dense array, indexed by an open addressing hash
+// table (linear probing) that maps the widget pointer to the array index.
+
+static Fl_Draw_Profiler::Entry *entries = 0;
+static int nentries = 0, aentries = 0;
+static int *hash = 0;                   // -1 = empty slot
+static int hsize = 0;                   // power of 2
+
+// The stack of draw() calls in progress
+struct Draw_Frame {
+  const Fl_Widget *widget;
+  Fl_Timestamp start;
+  double children;                      // time spent in nested draw() calls
+};
+#define PROFILER_MAX_DEPTH 64
+static Draw_Frame stack[PROFILER_MAX_DEPTH];
+static int depth = 0;
+
+static Fl_Timestamp last_update;
+static int have_update = 0;
+static double max_recent = 0.0;         // most expensive self time of the last second
+
+static unsigned slot_of(const Fl_Widget *w) {
+  return (unsigned)(((fl_uintptr_t)w >> 4) * 2654435761u) & (hsize - 1);
+}
+
+static int find_slot(const Fl_Widget *w) {
+  if (!hsize) return -1;
+  for (unsigned s = slot_of(w); ; s = (s + 1) & (hsize - 1)) {
+    if (hash[s] < 0) return -1;
+    if (entries[hash[s]].widget == w) return s;
+  }
+}
+
+static void rehash(int size) {
+  free(hash);
+  hsize = size;
+  hash = (int*)malloc(hsize * sizeof(int));
+  memset(hash, -1, hsize * sizeof(int));
+  for (int i = 0; i < nentries; i++) {
+    unsigned s = slot_of(entries[i].widget);
+    while (hash[s] >= 0) s = (s + 1) & (hsize - 1);
+    hash[s] = i;
+  }
+}
+
+static Fl_Draw_Profiler::Entry *get_entry(const Fl_Widget *w) {
+  int s = find_slot(w);
+  if (s >= 0) return entries + hash[s];
+  if (nentries == aentries) {
+    aentries = aentries ? 2 * aentries : 64;
+    entries = (Fl_Draw_Profiler::Entry*)realloc(entries, aentries * sizeof(Fl_Draw_Profiler::Entry));
+  }
+  if ((nentries + 1) * 2 > hsize) rehash(hsize ? 2 * hsize : 128);
+  Fl_Draw_Profiler::Entry *e = entries + nentries;
+  memset(e, 0, sizeof(*e));
+  e->widget = w;
+  unsigned u = slot_of(w);
+  while (hash[u] >= 0) u = (u + 1) & (hsize - 1);
+  hash[u] = nentries++;
+  return e;
+}
+
+static int profiler_shortcut(int event) {
+  if (event == FL_SHORTCUT && Fl::event_key() == FL_F + 12 &&
+      Fl::event_state(FL_CTRL | FL_SHIFT) == (FL_CTRL | FL_SHIFT)) {
+    Fl_Draw_Profiler::overlay(!Fl_Draw_Profiler::overlay());
+    return 1;
+  }
+  return 0;
+}
+
+// Evaluate FLTK_DRAW_PROFILER the first time the profiler is asked to work.
+static int check_env() {
+  const char *v = fl_getenv("FLTK_DRAW_PROFILER");
+  if (!v || !*v || !strcmp(v, "0")) {
+    Fl_Draw_Profiler::enable(0);
+    return 0;
+  }
+  if (!strcmp(v, "overlay")) Fl_Draw_Profiler::overlay(1);
+  else Fl_Draw_Profiler::enable(1);
+  return 1;
+}
+
+/**
+  Enables or disables collecting draw times.
+
+  Collected data is kept when the profiler is disabled, see reset().
+  Disabling the profiler also turns the overlay off.
+*/
+void Fl_Draw_Profiler::enable(int on) {
+  if (enabled_ > 0 && !on) Fl::remove_handler(profiler_shortcut);
+  if (enabled_ <= 0 && on) Fl::add_handler(profiler_shortcut);
+  enabled_ = on ? 1 : 0;
+  if (!on) overlay_ = 0;
+  depth = 0;
+}
+
+/**
+  Shows or hides the heat-map overlay.
+
+  Showing the overlay enables the profiler. All windows are redrawn.
+*/
+void Fl_Draw_Profiler::overlay(int on) {
+  if (on && enabled_ <= 0) enable(1);
+  overlay_ = on ? 1 : 0;
+  for (Fl_Window *w = Fl::first_window(); w; w = Fl::next_window(w))
+    w->redraw();
+}
+
+/**
+  Discards all collected data.
+*/
+void Fl_Draw_Profiler::reset() {
+  nentries = 0;
+  if (hash) memset(hash, -1, hsize * sizeof(int));
+  frames_ = 0;
+  depth = 0;
+  have_update = 0;
+  max_recent = 0.0;
+}
+
+/** Returns the number of profiled widgets. */
+int Fl_Draw_Profiler::count() {
+  return nentries;
+}
+
+/**
+  Returns the profile data of widget \p i, 0 <= i < count().
+  The order is arbitrary and changes when widgets are deleted.
+*/
+const Fl_Draw_Profiler::Entry *Fl_Draw_Profiler::entry(int i) {
+  return (i >= 0 && i < nentries) ? entries + i : 0;
+}
+
+/** Returns the profile data of widget \p w or NULL if it was never drawn. */
+const Fl_Draw_Profiler::Entry *Fl_Draw_Profiler::find(const Fl_Widget *w) {
+  int s = find_slot(w);
+  return (s >= 0) ? entries + hash[s] : 0;
+}
+
+static int cmp_self(const void *a, const void *b) {
+  double x = (*(const Fl_Draw_Profiler::Entry**)a)->self;
+  double y = (*(const Fl_Draw_Profiler::Entry**)b)->self;
+  return (x > y) ? -1 : (x < y) ? 1 : 0;
+}
+
+/**
+  Prints the \p max widgets with the highest self time to \p out.
+*/
+void Fl_Draw_Profiler::print(FILE *out, int max) {
+  if (!nentries) return;
+  const Entry **list = (const Entry**)malloc(nentries * sizeof(Entry*));
+  for (int i = 0; i < nentries; i++) list[i] = entries + i;
+  qsort(list, nentries, sizeof(Entry*), cmp_self);
+  fprintf(out, "%d frames\n%-18s %-24s %8s %10s %10s %10s %8s\n", frames_,
+          "widget", "label", "calls", "self ms", "total ms", "kpix/call", "draws/s");
+  for (int i = 0; i < nentries && i < max; i++) {
+    const Entry *e = list[i];
+    const char *l = e->widget->label();
+    fprintf(out, "%-18p %-24.24s %8d %10.3f %10.3f %10.1f %8.1f\n", (void*)e->widget,
+            l ? l : "", e->calls, e->self * 1e3, e->total * 1e3,
+            e->calls ? e->area / e->calls / 1e3 : 0.0, e->rate);
+  }
+  free(list);
+}
+
+void Fl_Draw_Profiler::push_(const Fl_Widget *w) {
+  if (enabled_ < 0 && !check_env()) return;
+  if (depth >= PROFILER_MAX_DEPTH) { depth++; return; }
+  Draw_Frame &f = stack[depth++];
+  f.widget = w;
+  f.children = 0.0;
+  f.start = Fl::now();
+}
+
+void Fl_Draw_Profiler::pop_() {
+  if (depth <= 0) return;
+  if (depth-- > PROFILER_MAX_DEPTH) return;
+  Draw_Frame &f = stack[depth];
+  double t = Fl::seconds_since(f.start);
+  double self = t - f.children;
+  if (depth > 0) stack[depth - 1].children += t;
+  Entry *e = get_entry(f.widget);
+  e->calls++;
+  e->total += t;
+  e->self += self;
+  e->area += (double)f.widget->w() * f.widget->h();
+  e->recent_calls++;
+  e->recent_self += self;
+}
+
+// Called by Fl::flush() before windows are drawn: counts frames and
+// updates the per second rates.
+void Fl_Draw_Profiler::frame_begin_i_() {
+  if (enabled_ < 0 && !check_env()) return;
+  frames_++;
+  if (!have_update) {
+    last_update = Fl::now();
+    have_update = 1;
+    return;
+  }
+  double dt = Fl::seconds_since(last_update);
+  if (dt < 1.0) return;
+  last_update = Fl::now();
+  max_recent = 0.0;
+  for (int i = 0; i < nentries; i++) {
+    Entry &e = entries[i];
+    e.rate = e.recent_calls / dt;
+    e.recent = e.recent_self;
+    e.recent_calls = 0;
+    e.recent_self = 0.0;
+    if (e.recent > max_recent) max_recent = e.recent;
+  }
+}
+
+// Frames all profiled widgets of a window in their heat color.
+void Fl_Draw_Profiler::draw_overlay_(Fl_Window *win) {
+  if (!win->shown()) return;
+  win->make_current();
+  fl_font(FL_HELVETICA, 9);
+  fl_line_style(FL_SOLID, 2);
+  for (int i = 0; i < nentries; i++) {
+    const Entry &e = entries[i];
+    const Fl_Widget *w = e.widget;
+    if (w == win || w->window() != win || !w->visible_r()) continue;
+    if (!e.rate && !e.recent) continue;
+    float heat = max_recent > 0.0 ? float(e.recent / max_recent) : 0.0f;
+    fl_color(fl_color_average(FL_RED, FL_GREEN, heat));
+    fl_rect(w->x(), w->y(), w->w(), w->h());
+    if (e.rate >= 1.0) {
+      char buf[32];
+      snprintf(buf, sizeof(buf), "%.0f/s", e.rate);
+      fl_draw(buf, w->x() + 2, w->y() + fl_height() - fl_descent() + 1);
+    }
+  }
+  fl_line_style(0);
+}
+
+void Fl_Draw_Profiler::forget_i_(const Fl_Widget *w) {
+  int s = find_slot(w);
+  if (s < 0) return;
+  int idx = hash[s];
+  // backward shift deletion keeps the probe sequences intact
+  unsigned hole = s;
+  for (unsigned j = (hole + 1) & (hsize - 1); hash[j] >= 0; j = (j + 1) & (hsize - 1)) {
+    unsigned home = slot_of(entries[hash[j]].widget);
+    if (((j - home) & (hsize - 1)) >= ((j - hole) & (hsize - 1))) {
+      hash[hole] = hash[j];
+      hole = j;
+    }
+  }
+  hash[hole] = -1;
+  // move the last entry into the gap
+  int last = --nentries;
+  if (idx != last) {
+    entries[idx] = entries[last];
+    hash[find_slot(entries[idx].widget)] = idx;
+  }
+}
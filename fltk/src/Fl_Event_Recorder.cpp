@@ -0,0 +1,256 @@
+//
+// Event recorder for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2024 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include "../hdr/Fl_Event_Recorder.h"
+#include "../hdr/Fl.h"
+#include "../hdr/Fl_Window.h"
+#include "../hdr/fl_utf8.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// File format: a header line followed by one line per event,
+//
+//   FLTK-EVENTS 1
+//   <usec> <event> <x> <y> <x_root> <y_root> <dx> <dy> <state> <keysym>
+//     <original_keysym> <clicks> <is_click> <len>:<window label> <len>:<text>
+//
+// <usec> is the time since start(). The two strings are length-prefixed
+// so they can hold any byte, including newlines.
+
+#define RECORDER_MAGIC "FLTK-EVENTS 1\n"
+
+int Fl_Event_Recorder::recording_ = -1;
+
+static FILE *rec_file = 0;
+static Fl_Timestamp rec_start;
+
+// Only real input is recorded: everything else (FL_SHOW, FL_SHORTCUT from
+// FL_KEYBOARD, selection and DnD events, ..) is derived from it by FLTK.
+static int is_input_event(int e) {
+  switch (e) {
+    case FL_PUSH:
+    case FL_RELEASE:
+    case FL_ENTER:
+    case FL_LEAVE:
+    case FL_DRAG:
+    case FL_MOVE:
+    case FL_MOUSEWHEEL:
+    case FL_KEYBOARD:
+    case FL_KEYUP:
+    case FL_FOCUS:
+    case FL_UNFOCUS:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+static void write_string(FILE *f, const char *s, int len) {
+  fprintf(f, " %d:", len);
+  if (len) fwrite(s, 1, len, f);
+}
+
+// Returns a malloc'ed, nul-terminated string or 0 on error.
+static char *read_string(FILE *f, int *len) {
+  if (fscanf(f, " %d:", len) != 1 || *len < 0) return 0;
+  char *s = (char*)malloc(*len + 1);
+  if ((int)fread(s, 1, *len, f) != *len) {
+    free(s);
+    return 0;
+  }
+  s[*len] = 0;
+  return s;
+}
+
+/**
+  Starts recording events to \p filename.
+
+  A running recording is stopped first.
+
+  \return 0 on success, -1 if the file could not be created
+*/
+int Fl_Event_Recorder::start(const char *filename) {
+  stop();
+  rec_file = fl_fopen(filename, "wb");
+  if (!rec_file) return -1;
+  fputs(RECORDER_MAGIC, rec_file);
+  rec_start = Fl::now();
+  recording_ = 1;
+  return 0;
+}
+
+/**
+  Stops recording and closes the file.
+*/
+void Fl_Event_Recorder::stop() {
+  if (rec_file) fclose(rec_file);
+  rec_file = 0;
+  recording_ = 0;
+}
+
+// Called by Fl::handle() for every event while recording_ is non-zero.
+void Fl_Event_Recorder::record_(int e, Fl_Window *window) {
+  if (recording_ < 0) {
+    const char *name = fl_getenv("FLTK_RECORD_EVENTS");
+    if (!name || !*name || start(name) < 0) {
+      recording_ = 0;
+      return;
+    }
+  }
+  if (!is_input_event(e)) return;
+  long usec = (long)(Fl::seconds_since(rec_start) * 1e6);
+  fprintf(rec_file, "%ld %d %d %d %d %d %d %d %d %d %d %d %d",
+          usec, e, Fl::e_x, Fl::e_y, Fl::e_x_root, Fl::e_y_root, Fl::e_dx, Fl::e_dy,
+          Fl::e_state, Fl::e_keysym, Fl::e_original_keysym, Fl::e_clicks, Fl::e_is_click);
+  const char *label = (window && window->label()) ? window->label() : "";
+  write_string(rec_file, label, (int)strlen(label));
+  int tlen = (Fl::e_text && (e == FL_KEYBOARD || e == FL_KEYUP)) ? Fl::e_length : 0;
+  write_string(rec_file, Fl::e_text, tlen);
+  fputc('\n', rec_file);
+}
+
+// Find the window an event was recorded for: same label, else the fallback.
+static Fl_Window *find_window(const char *label, Fl_Window *fallback) {
+  for (Fl_Window *w = Fl::first_window(); w; w = Fl::next_window(w)) {
+    const char *l = w->label() ? w->label() : "";
+    if (!strcmp(l, label)) return w;
+  }
+  if (fallback) return fallback;
+  return Fl::first_window();
+}
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(const double*)a, y = *(const double*)b;
+  return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+// p-th percentile of n sorted values
+static double percentile(const double *v, int n, double p) {
+  if (n <= 0) return 0.0;
+  int i = (int)(p * (n - 1) + 0.5);
+  return v[i];
+}
+
+/**
+  Replays the events recorded in \p filename.
+
+  Each event is sent through Fl::handle() to the shown window with the
+  recorded label, or to \p target (or the first window) if there is none.
+  After each event Fl::flush() is called, the time spent in both calls is
+  collected and summarized in \p stats.
+
+  With \p speed > 0 the recorded pace is kept, scaled by \p speed (2.0
+  replays twice as fast), and Fl::wait() runs timeouts and other pending
+  work between events. With \p speed <= 0 the events are sent back to back
+  and nothing else runs in between.
+
+  Recording is stopped before the replay starts.
+
+  \param[in]  filename  file written by start()
+  \param[out] stats     latency statistics, may be NULL
+  \param[in]  speed     replay speed factor, 0 for as fast as possible
+  \param[in]  target    window for events whose window can't be found
+  \return number of replayed events, or -1 if the file can't be read
+*/
+int Fl_Event_Recorder::replay(const char *filename, Stats *stats,
+                              double speed, Fl_Window *target) {
+  stop();
+  FILE *f = fl_fopen(filename, "rb");
+  if (!f) return -1;
+  char magic[sizeof(RECORDER_MAGIC)];
+  if (!fgets(magic, sizeof(magic), f) || strcmp(magic, RECORDER_MAGIC)) {
+    fclose(f);
+    return -1;
+  }
+
+  int alloc = 0, n = 0;
+  double *handle_t = 0, *flush_t = 0;
+  Fl_Timestamp start = Fl::now();
+
+  for (;;) {
+    long usec;
+    int e, x, y, xr, yr, dx, dy, state, keysym, okeysym, clicks, is_click;
+    if (fscanf(f, "%ld %d %d %d %d %d %d %d %d %d %d %d %d", &usec, &e, &x, &y,
+               &xr, &yr, &dx, &dy, &state, &keysym, &okeysym, &clicks, &is_click) != 13)
+      break;
+    int llen, tlen;
+    char *label = read_string(f, &llen);
+    char *text = label ? read_string(f, &tlen) : 0;
+    if (!text) {
+      free(label);
+      break;
+    }
+
+    if (speed > 0.0) {
+      double due = usec * 1e-6 / speed;
+      double left;
+      while ((left = due - Fl::seconds_since(start)) > 0.0)
+        Fl::wait(left);
+    }
+
+    Fl::e_x = x; Fl::e_y = y;
+    Fl::e_x_root = xr; Fl::e_y_root = yr;
+    Fl::e_dx = dx; Fl::e_dy = dy;
+    Fl::e_state = state;
+    Fl::e_keysym = keysym;
+    Fl::e_original_keysym = okeysym;
+    Fl::e_clicks = clicks;
+    Fl::e_is_click = is_click;
+    Fl::e_text = text;
+    Fl::e_length = tlen;
+
+    if (n == alloc) {
+      alloc = alloc ? 2 * alloc : 256;
+      handle_t = (double*)realloc(handle_t, alloc * sizeof(double));
+      flush_t = (double*)realloc(flush_t, alloc * sizeof(double));
+    }
+    Fl_Window *win = find_window(label, target);
+    Fl_Timestamp t0 = Fl::now();
+    if (win) Fl::handle(e, win);
+    Fl_Timestamp t1 = Fl::now();
+    Fl::flush();
+    handle_t[n] = Fl::seconds_between(t1, t0);
+    flush_t[n] = Fl::seconds_since(t1);
+    n++;
+
+    static char empty[1] = "";
+    Fl::e_text = empty;
+    Fl::e_length = 0;
+    free(label);
+    free(text);
+  }
+  fclose(f);
+
+  if (stats) {
+    qsort(handle_t, n, sizeof(double), cmp_double);
+    qsort(flush_t, n, sizeof(double), cmp_double);
+    stats->events = n;
+    stats->handle_p50 = percentile(handle_t, n, 0.50);
+    stats->handle_p90 = percentile(handle_t, n, 0.90);
+    stats->handle_p99 = percentile(handle_t, n, 0.99);
+    stats->handle_max = n ? handle_t[n-1] : 0.0;
+    stats->flush_p50 = percentile(flush_t, n, 0.50);
+    stats->flush_p90 = percentile(flush_t, n, 0.90);
+    stats->flush_p99 = percentile(flush_t, n, 0.99);
+    stats->flush_max = n ? flush_t[n-1] : 0.0;
+    stats->total = Fl::seconds_since(start);
+  }
+  free(handle_t);
+  free(flush_t);
+  return n;
+}
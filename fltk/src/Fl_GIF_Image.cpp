@@ -31,6 +31,7 @@
 #include "../hdr/Fl.h"
 #include "../hdr/Fl_GIF_Image.h"
 #include "Fl_Image_Reader.h"
+#include "Fl_Image_Reducer.h"
 #include "../hdr/fl_utf8.h"
 #include "flstring.h"
 
@@ -142,6 +143,36 @@ Fl_GIF_Image::Fl_GIF_Image(const char *filename) :
   }
 }
 
+/**
+  This constructor loads a GIF image from the given file, reduced to
+  \p W x \p H pixels.
+
+  The pixels are sampled while the image is decoded, so that it is never
+  held in memory at full size. Since GIF pixels are color indices they are
+  not averaged, the pixel nearest to the center of each box is used. If the
+  image is not larger than \p W x \p H it is loaded at its own size, check
+  data_w() and data_h(). Only the first frame of an animation is loaded.
+
+  Fl_Shared_Image::get() uses this to load thumbnails when it is called
+  with FL_DECODE_REDUCED.
+
+  \param[in] filename a full path and name pointing to a GIF image file.
+  \param[in] W, H     size of the reduced image
+
+  \see Fl_GIF_Image::Fl_GIF_Image(const char *filename)
+*/
+Fl_GIF_Image::Fl_GIF_Image(const char *filename, int W, int H) :
+  Fl_Pixmap((char *const*)0)
+{
+  Fl_Image_Reader rdr;
+  if (rdr.open(filename) == -1) {
+    Fl::error("Fl_GIF_Image: Unable to open %s!", filename);
+    ld(ERR_FILE_ACCESS);
+  } else {
+    load_gif_(rdr, false, W, H);
+  }
+}
+
 /**
   This constructor loads a GIF image from memory.
 
@@ -252,138 +283,189 @@ Fl_GIF_Image::Fl_GIF_Image() :
   Internally used method to read from the LZW compressed data
   stream 'rdr' and decode it to 'Image' buffer.
 
+  The data sub-blocks are first collected into one buffer, so that codes
+  are taken from 32-bit windows instead of being assembled byte by byte.
+  For each dictionary entry the length of its string, its first byte and
+  where it was last written are stored, so the pixels of a code are copied
+  from the image decoded so far rather than reversed out of the prefix
+  chain. Interlaced images are decoded in stream order and then have their
+  rows moved into place.
+
+  If 'reducer' is active, each row is decoded into reducer->row() and
+  'Image' is the reducer's output buffer. Since the full image is not
+  kept in this case, strings are built by walking the prefix chain.
+
   NOTE: This methode has been extracted from load_gif_()
         in order to make the code more read/hand-able.
 
 */
 void Fl_GIF_Image::lzw_decode(Fl_Image_Reader &rdr, uchar *Image,
-  int Width, int Height, int CodeSize, int ColorMapSize, int Interlace) {
-  int YC = 0, Pass = 0; /* Used to de-interlace the picture */
-  uchar *p = Image;
-  uchar *eol = p+Width;
+  int Width, int Height, int CodeSize, int Interlace,
+  Fl_Image_Reducer *reducer) {
+  if (reducer && !reducer->active()) reducer = 0;
+
+  // Collect the data sub-blocks, padded for the 32-bit reads below
+  uchar *Data = 0;
+  size_t DataLen = 0, DataSize = 0;
+  for (;;) {
+    int blocklen = rdr.read_byte();
+    if (blocklen <= 0) break;
+    if (DataLen + blocklen + 4 > DataSize) {
+      DataSize = DataSize ? 2 * DataSize : 16384;
+      uchar *temp = new uchar[DataSize];
+      if (DataLen) memcpy(temp, Data, DataLen);
+      delete[] Data;
+      Data = temp;
+    }
+    if (rdr.read(Data + DataLen, blocklen) < (size_t)blocklen) break;
+    DataLen += blocklen;
+  }
+  if (rdr.error()) delete[] Data;
+  CHECK_ERROR
+  if (!Data) return;
+  memset(Data + DataLen, 0, 4);
+
+  // Rows in the order they are stored
+  int *Rows = 0;
+  if (Interlace) {
+    static const int start[4] = { 0, 4, 2, 1 }, step[4] = { 8, 8, 4, 2 };
+    Rows = new int[Height];
+    int n = 0;
+    for (int pass = 0; pass < 4; pass++)
+      for (int y = start[pass]; y < Height; y += step[pass]) Rows[n++] = y;
+  }
+
+  // Decoded pixels in stream order, unless reducing
+  const size_t Total = (size_t)Width * Height;
+  uchar *Out = reducer ? 0 : Interlace ? new uchar[Total] : Image;
+  size_t Pos = 0;                       // pixels decoded
+  size_t Prev = 0;                      // where the previous string starts in Out
+  int RowY = 0, RowX = 0;               // reducer: current row and column
 
   int InitCodeSize = CodeSize;
   int ClearCode = (1 << (CodeSize-1));
   int EOFCode = ClearCode + 1;
   int FirstFree = ClearCode + 2;
-  int FinChar = 0;
   int ReadMask = (1<<CodeSize) - 1;
   int FreeCode = FirstFree;
-  int OldCode = ClearCode;
-
-  // tables used by LZW decompressor:
-  short int Prefix[4096];
-  uchar Suffix[4096];
+  int OldCode = -1;                     // none since the last clear code
+
+  // the dictionary
+  struct Entry {
+    unsigned int where;                 // position of the string in Out
+    unsigned short length;              // length of the string
+    short prefix;                       // string without the last byte
+    uchar first, last;                  // first and last byte of the string
+  } Dict[4096];
+  uchar Str[4096];                      // reducer: string of the current code
+  for (int i = 0; i < ClearCode; i++) {
+    Dict[i].length = 1;
+    Dict[i].first = Dict[i].last = (uchar)i;
+    Dict[i].prefix = -1;
+  }
 
-  int blocklen = rdr.read_byte();
-  uchar thisbyte = rdr.read_byte(); blocklen--;
-  CHECK_ERROR
-  int frombit = 0;
+  const size_t Bits = DataLen * 8;
+  size_t BitPos = 0;
 
   // loop to read LZW compressed image data
 
-  for (;;) {
-
-    /* Fetch the next code from the raster data stream.  The codes can be
-    * any length from 3 to 12 bits, packed into 8-bit bytes, so we have to
-    * maintain our location as a pointer and a bit offset.
-    * In addition, GIF adds totally useless and annoying block counts
-    * that must be correctly skipped over. */
-    int CurCode = thisbyte;
-    if (frombit+CodeSize > 7) {
-      if (blocklen <= 0) {
-        blocklen = rdr.read_byte();
-        CHECK_ERROR
-        if (blocklen <= 0) break;
-      }
-      thisbyte = rdr.read_byte(); blocklen--;
-      CHECK_ERROR
-      CurCode |= thisbyte<<8;
-    }
-    if (frombit+CodeSize > 15) {
-      if (blocklen <= 0) {
-        blocklen = rdr.read_byte();
-        CHECK_ERROR
-        if (blocklen <= 0) break;
-      }
-      thisbyte = rdr.read_byte(); blocklen--;
-      CHECK_ERROR
-      CurCode |= thisbyte<<16;
-    }
-    CurCode = (CurCode>>frombit)&ReadMask;
-    frombit = (frombit+CodeSize)%8;
+  while (BitPos + CodeSize <= Bits) {
+    const uchar *b = Data + (BitPos >> 3);
+    unsigned int window = b[0] | (b[1] << 8) | (b[2] << 16) | ((unsigned int)b[3] << 24);
+    int CurCode = (int)(window >> (BitPos & 7)) & ReadMask;
+    BitPos += CodeSize;
 
     if (CurCode == ClearCode) {
       CodeSize = InitCodeSize;
       ReadMask = (1<<CodeSize) - 1;
       FreeCode = FirstFree;
-      OldCode = ClearCode;
+      OldCode = -1;
       continue;
     }
 
-    if (CurCode == EOFCode) {
-      rdr.skip(blocklen);
-      blocklen = rdr.read_byte(); // Block-Terminator must follow!
+    if (CurCode == EOFCode)
       break;
-    }
 
-    uchar OutCode[4097]; // temporary array for reversing codes
-    uchar *tp = OutCode;
-    int i;
-    if (CurCode < FreeCode) {
-      i = CurCode;
-    } else if (CurCode == FreeCode) {
-      *tp++ = (uchar)FinChar;
-      i = OldCode;
-    } else {
+    if (CurCode > FreeCode || (CurCode == FreeCode && OldCode < 0) ||
+        (CurCode >= ClearCode && OldCode < 0)) {
       Fl::error("Fl_GIF_Image: %s - LZW Barf at offset %ld", rdr.name(), rdr.tell());
       break;
     }
 
-    while (i >= ColorMapSize) {
-      if (i < FreeCode) {
-        *tp++ = Suffix[i];
-        i = Prefix[i];
-      } else { // FIXME - should never happen (?)
-        Fl::error("Fl_GIF_Image: %s - i(%d) >= FreeCode (%d) at offset %ld",
-                  rdr.name(), i, FreeCode, rdr.tell());
-        // NOTREACHED
-        i = FreeCode - 1; // fix broken index ???
-        break;
+    // Add the previous string plus the first byte of this one, first,
+    // since this code may be the new entry
+    if (OldCode >= 0 && FreeCode < 4096) {
+      Entry &e = Dict[FreeCode];
+      const Entry &o = Dict[OldCode];
+      e.where = (unsigned int)Prev;
+      e.length = (unsigned short)(o.length + 1);
+      e.prefix = (short)OldCode;
+      e.first = o.first;
+      e.last = CurCode == FreeCode ? o.first : Dict[CurCode].first;
+      FreeCode++;
+      if (FreeCode > ReadMask && CodeSize < 12) {
+        CodeSize++;
+        ReadMask = (1 << CodeSize) - 1;
       }
     }
-    *tp++ = FinChar = i;
-    do {
-      *p++ = *--tp;
-      if (p >= eol) {
-        if (!Interlace) YC++;
-        else switch (Pass) {
-          case 0: YC += 8; if (YC >= Height) {Pass++; YC = 4;} break;
-          case 1: YC += 8; if (YC >= Height) {Pass++; YC = 2;} break;
-          case 2: YC += 4; if (YC >= Height) {Pass++; YC = 1;} break;
-          case 3: YC += 2; break;
+    OldCode = CurCode;
+
+    int n = Dict[CurCode].length;
+    if (Out) {
+      if (n > (int)(Total - Pos)) n = (int)(Total - Pos);
+      uchar *d = Out + Pos;
+      if (CurCode < ClearCode) {
+        *d = (uchar)CurCode;
+      } else {
+        const uchar *s = Out + Dict[CurCode].where;
+        if (s + n > d) {              // string ends with its own first byte
+          for (int i = 0; i < n; i++) d[i] = s[i];
+        } else if (n <= 8 && Pos + 8 <= Total) {
+          unsigned char t[8];         // most strings are short, copy 8 bytes
+          memcpy(t, s, 8);
+          memcpy(d, t, 8);
+        } else {
+          memcpy(d, s, n);
         }
-        if (YC>=Height) YC=0; /* cheap bug fix when excess data */
-        p = Image + YC*Width;
-        eol = p+Width;
       }
-    } while (tp > OutCode);
-
-    if (OldCode != ClearCode) {
-      if (FreeCode < 4096) {
-        Prefix[FreeCode] = (short)OldCode;
-        Suffix[FreeCode] = FinChar;
-        FreeCode++;
+      Prev = Pos;
+      Pos += n;
+      if (Pos >= Total) break;
+    } else {
+      uchar *e = Str + n;
+      int c = CurCode;
+      while (c >= ClearCode) {
+        *--e = Dict[c].last;
+        c = Dict[c].prefix;
       }
-      if (FreeCode > ReadMask) {
-        if (CodeSize < 12) {
-          CodeSize++;
-          ReadMask = (1 << CodeSize) - 1;
+      *--e = (uchar)c;
+      while (n > 0) {
+        int k = Width - RowX < n ? Width - RowX : n;
+        memcpy(reducer->row() + RowX, e, k);
+        e += k;
+        n -= k;
+        RowX += k;
+        if (RowX == Width) {
+          int y = Rows ? Rows[RowY] : RowY;
+          if (reducer->wants_row(y)) reducer->add_row(y);
+          RowX = 0;
+          if (++RowY >= Height) break;
         }
       }
+      if (RowY >= Height) break;
     }
-    OldCode = CurCode;
   }
+
+  if (Out) {
+    if (Pos < Total) memset(Out + Pos, 0, Total - Pos); // truncated image
+    if (Interlace) {
+      for (int i = 0; i < Height; i++)
+        memcpy(Image + (size_t)Rows[i] * Width, Out + (size_t)i * Width, Width);
+      delete[] Out;
+    }
+  }
+  delete[] Rows;
+  delete[] Data;
 }
 
 
@@ -398,15 +480,14 @@ void Fl_GIF_Image::lzw_decode(Fl_Image_Reader &rdr, uchar *Image,
 static char ** convert_to_xpm(uchar *Image, int Width, int Height, ColorMap &CMap, int ColorMapSize, int transparent_pixel) {
   // allocate line pointer arrays:
   char **new_data = new char*[Height+2];
+  int i;
 
-  // transparent pixel must be zero, swap if it isn't:
+  // transparent pixel must be zero, swap it with index 0 if it isn't:
+  uchar swap[256];
+  for (i = 0; i < 256; i++) swap[i] = (uchar)i;
   if (transparent_pixel > 0) {
-    // swap transparent pixel with zero
-    uchar *p = Image+Width*Height;
-    while (p-- > Image) {
-      if (*p==transparent_pixel) *p = 0;
-      else if (!*p) *p = transparent_pixel;
-    }
+    swap[0] = (uchar)transparent_pixel;
+    swap[transparent_pixel] = 0;
     uchar t;
     t                             = CMap.Red[0];
     CMap.Red[0]                   = CMap.Red[transparent_pixel];
@@ -421,12 +502,13 @@ static char ** convert_to_xpm(uchar *Image, int Width, int Height, ColorMap &CMa
     CMap.Blue[transparent_pixel]  = t;
   }
 
-  // find out what colors are actually used:
+  // find out what colors are actually used (after the swap):
   uchar used[256]; uchar remap[256];
-  int i;
-  for (i = 0; i < ColorMapSize; i++) used[i] = 0;
+  memset(used, 0, sizeof(used));
   uchar *p = Image+Width*Height;
   while (p-- > Image) used[*p] = 1;
+  for (i = 0; i < 256; i++) remap[i] = used[swap[i]];
+  memcpy(used, remap, sizeof(used));
 
   // remap them to start with printing characters:
   int base = transparent_pixel >= 0 && used[0] ? ' ' : ' '+1;
@@ -436,12 +518,12 @@ static char ** convert_to_xpm(uchar *Image, int Width, int Height, ColorMap &CMa
     numcolors++;
   }
 
-  // write the first line of xpm data (use suffix as temp array):
-  uchar Suffix[4096];
-  int length = snprintf((char*)(Suffix), sizeof(Suffix),
+  // write the first line of xpm data:
+  char line[64];
+  int length = snprintf(line, sizeof(line),
                        "%d %d %d %d",Width,Height,-numcolors,1);
   new_data[0] = new char[length+1];
-  strcpy(new_data[0], (char*)Suffix);
+  strcpy(new_data[0], line);
 
   // write the colormap
   new_data[1] = (char*)(p = new uchar[4*numcolors]);
@@ -452,15 +534,16 @@ static char ** convert_to_xpm(uchar *Image, int Width, int Height, ColorMap &CMa
     *p++ = CMap.Blue[i];
   }
 
-  // remap the image data:
-  p = Image+Width*Height;
-  while (p-- > Image) *p = remap[*p];
+  // map the image data from the original indices in one pass:
+  uchar map[256];
+  for (i = 0; i < 256; i++) map[i] = remap[swap[i]];
 
   // split the image data into lines:
   for (i=0; i<Height; i++) {
-    new_data[i+2] = new char[Width+1];
-    memcpy(new_data[i + 2], (char*)(Image + i*Width), Width);
-    new_data[i + 2][Width] = 0;
+    char *d = new_data[i+2] = new char[Width+1];
+    const uchar *s = Image + i*Width;
+    for (int x = 0; x < Width; x++) d[x] = (char)map[s[x]];
+    d[Width] = 0;
   }
 
   return new_data;
@@ -484,7 +567,8 @@ static char ** convert_to_xpm(uchar *Image, int Width, int Height, ColorMap &CMa
   All subsequent images are only decoded (and not converted to XPM) and passed
   to Fl_Anim_GIF_Image, which stores them on its own (in RGBA format).
 */
-void Fl_GIF_Image::load_gif_(Fl_Image_Reader &rdr, bool anim/*=false*/)
+void Fl_GIF_Image::load_gif_(Fl_Image_Reader &rdr, bool anim/*=false*/,
+                             int reduce_w/*=0*/, int reduce_h/*=0*/)
 {
   uchar *Image = 0L;    // internal temporary image data array
   int frame = 0;
@@ -685,8 +769,18 @@ void Fl_GIF_Image::load_gif_(Fl_Image_Reader &rdr, bool anim/*=false*/)
 
       // now read the LZW compressed image data
 
-      Image = new uchar[Width*Height];
-      lzw_decode(rdr, Image, Width, Height, CodeSize, ColorMapSize, Interlace);
+      // Animations and later frames are always decoded at full size
+      Fl_Image_Reducer reducer;
+      if (!anim && Fl_Image_Reducer::can_reduce(Width, Height, reduce_w, reduce_h)) {
+        Image = new uchar[reduce_w*reduce_h];
+        reducer.start(Width, Height, reduce_w, reduce_h, 1, Image, 1);
+        lzw_decode(rdr, Image, Width, Height, CodeSize, Interlace, &reducer);
+        Width = reduce_w;
+        Height = reduce_h;
+      } else {
+        Image = new uchar[Width*Height];
+        lzw_decode(rdr, Image, Width, Height, CodeSize, Interlace);
+      }
       if (ld()) return; // CHECK_ERROR aborted already
 
       // Notify derived class on loaded image data
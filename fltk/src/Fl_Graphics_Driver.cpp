@@ -29,6 +29,7 @@ Fl_Graphics_Driver *fl_graphics_driver;
  */
 
 #include "Fl_Screen_Driver.h"
+#include "Fl_Memory.h"
 #include "../hdr/Fl_Image_Surface.h"
 #include "../hdr/mymath.h" // for fabs(), sqrt()
 #include "../hdr/platform.h" // for fl_open_display()
@@ -248,6 +249,9 @@ void Fl_Graphics_Driver::draw_pixmap(Fl_Pixmap *pxm, int XP, int YP, int WP, int
       *mask(pxm2) = 0;
       delete pxm2;
     } else cache(pxm);
+    if (*id(pxm))
+      fl_memory_account(FL_MEMORY_IMAGE_CACHE, fl_offscreen_bytes(*pw, *ph) +
+                        (*mask(pxm) ? fl_bitmask_bytes(*pw, *ph) : 0));
   }
   // draw pxm using its scaled id_ & pixmap_
   draw_fixed(pxm, X, Y, W, H, cx, cy);
@@ -279,6 +283,7 @@ void Fl_Graphics_Driver::draw_bitmap(Fl_Bitmap *bm, int XP, int YP, int WP, int
       *pw = w2; *ph = h2; // memorize size of cached form of bitmap
       delete bm2;
     } else cache(bm);
+    if (*id(bm)) fl_memory_account(FL_MEMORY_IMAGE_CACHE, fl_bitmask_bytes(*pw, *ph));
   }
   // draw bm using its scaled id_
   draw_fixed(bm, X, Y, W, H, cx, cy);
@@ -326,9 +331,13 @@ void Fl_Graphics_Driver::draw_rgb(Fl_RGB_Image *img, int XP, int YP, int WP, int
     *pw = w2;
     *ph = h2;
     delete img2;
+    if (*id(img)) fl_memory_account(FL_MEMORY_IMAGE_CACHE, fl_offscreen_bytes(w2, h2));
   }
   else { // draw img using its scaled id_
-    if (!*id(img)) cache(img);
+    if (!*id(img)) {
+      cache(img);
+      if (*id(img)) fl_memory_account(FL_MEMORY_IMAGE_CACHE, fl_offscreen_bytes(*pw, *ph));
+    }
     draw_fixed(img, XP, YP, WP, HP, cx, cy);
   }
 }
@@ -855,6 +864,13 @@ void Fl_Scalable_Graphics_Driver::polygon(int x0, int y0, int x1, int y1, int x2
 }
 
 void Fl_Scalable_Graphics_Driver::circle(double x, double y, double r) {
+  // ellipse_unscaled() draws axis-aligned ellipses only: the circle's
+  // image is one if the rows of the matrix are orthogonal
+  double skew = m.a*m.b + m.c*m.d;
+  if (skew != 0 && fabs(skew) > 1e-9 * (m.a*m.a + m.b*m.b + m.c*m.c + m.d*m.d)) {
+    arc(x, y, r, 0, 360);
+    return;
+  }
   double xt = transform_x(x,y);
   double yt = transform_y(x,y);
   double rx = r * (m.c ? sqrt(m.a*m.a+m.c*m.c) : fabs(m.a));
@@ -23,6 +23,7 @@
 #include "../hdr/Fl_Group.h"
 #include "Fl_Window_Driver.h"
 #include "../hdr/Fl_Rect.h"
+#include "../hdr/Fl_Draw_Profiler.h"
 #include "../hdr/fl_draw.h"
 
 #include <stdlib.h> // malloc etc.
@@ -957,7 +958,9 @@ void Fl_Group::draw() {
 void Fl_Group::update_child(Fl_Widget& widget) const {
   if (widget.damage() && widget.visible() && widget.type() < FL_WINDOW &&
       fl_not_clipped(widget.x(), widget.y(), widget.w(), widget.h())) {
+    Fl_Draw_Profiler::begin_(&widget);
     widget.draw();
+    Fl_Draw_Profiler::end_();
     widget.clear_damage();
   }
 }
@@ -973,7 +976,9 @@ void Fl_Group::draw_child(Fl_Widget& widget) const {
       fl_not_clipped(widget.x(), widget.y(), widget.w(), widget.h())) {
     // The following call clears all damage flags and then *sets* FL_DAMAGE_ALL
     widget.clear_damage(FL_DAMAGE_ALL);
+    Fl_Draw_Profiler::begin_(&widget);
     widget.draw();
+    Fl_Draw_Profiler::end_();
     widget.clear_damage();
   }
 }
@@ -21,6 +21,7 @@
 #include "../hdr/Fl_Menu_Item.h"
 #include "../hdr/Fl_Image.h"
 #include "flstring.h"
+#include "Fl_Memory.h"
 
 #include <stdlib.h>
 
@@ -330,7 +331,7 @@ bool Fl_Image::register_images_done = false;
 //
 size_t Fl_RGB_Image::max_size_ = ~((size_t)0);
 
-int fl_convert_pixmap(const char*const* cdata, uchar* out, Fl_Color bg);
+int fl_convert_pixmap(const Fl_Pixmap *pxm, uchar *out, Fl_Color bg); // in fl_draw_pixmap.cxx
 
 
 /**
@@ -440,7 +441,7 @@ Fl_RGB_Image::Fl_RGB_Image(const Fl_Pixmap *pxm, Fl_Color bg):
   if (pxm && pxm->data_w() > 0 && pxm->data_h() > 0) {
     array = new uchar[data_w() * data_h() * d()];
     alloc_array = 1;
-    fl_convert_pixmap(pxm->data(), (uchar*)array, bg);
+    fl_convert_pixmap(pxm, (uchar*)array, bg);
   }
   data((const char **)&array, 1);
   scale(pxm->w(), pxm->h(), 0, 1);
@@ -457,6 +458,7 @@ Fl_RGB_Image::~Fl_RGB_Image() {
 }
 
 void Fl_RGB_Image::uncache() {
+  if (id_) fl_memory_account(FL_MEMORY_IMAGE_CACHE, -fl_offscreen_bytes(cache_w_, cache_h_));
   Fl_Graphics_Driver::default_driver().uncache(this, id_, mask_);
 }
 
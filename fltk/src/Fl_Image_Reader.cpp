@@ -136,6 +136,30 @@ unsigned int Fl_Image_Reader::read_dword() {
   return ((((((b3 << 8) | b2) << 8) | b1) << 8) | b0);
 }
 
+// Read n bytes into buf, returns the number of bytes read.
+// Sets the error flag if fewer bytes are available.
+size_t Fl_Image_Reader::read(unsigned char *buf, size_t n) {
+  if (error()) // don't read after read error or EOF
+    return 0;
+  if (is_file_) {
+    size_t ret = fread(buf, 1, n, file_);
+    if (ret < n)
+      error_ = feof(file_) ? 1 : 2;
+    return ret;
+  } else if (is_data_) {
+    size_t avail = (size_t)(end_ - data_);
+    if (avail < n) {
+      n = avail;
+      error_ = 1; // EOF
+    }
+    memcpy(buf, data_, n);
+    data_ += n;
+    return n;
+  }
+  error_ = 3; // undefined mode
+  return 0;
+}
+
 // Move the current read position to a byte offset from the beginning
 // of the file or the original start address in memory.
 // This method clears the error flag if the position is valid.
@@ -66,6 +66,9 @@ public:
   // Read a 32-bit signed integer, LSB-first
   int read_long() { return (int)read_dword(); }
 
+  // Read n bytes into buf, returns the number of bytes read
+  size_t read(unsigned char *buf, size_t n);
+
   // Move the current read position to a byte offset from the beginning
   // of the file or the original start address in memory
   void seek(unsigned int n);
@@ -0,0 +1,139 @@
+//
+// Internal image reducer class for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2024 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+//
+// Include necessary header files...
+//
+
+#include "Fl_Image_Reducer.h"
+
+#include <string.h>
+
+// See Fl_Image_Reducer.h for a description of this class.
+
+// Create an inactive reducer.
+Fl_Image_Reducer::Fl_Image_Reducer()
+  : src_w_(0), src_h_(0), dst_w_(0), dst_h_(0), depth_(0), nearest_(0)
+  , out_(0), row_(0), xmap_(0), xcount_(0), acc_(0)
+  , acc_row_(-1), acc_taps_(0) {
+}
+
+// Free the row buffers.
+Fl_Image_Reducer::~Fl_Image_Reducer() {
+  delete[] row_;
+  delete[] xmap_;
+  delete[] xcount_;
+  delete[] acc_;
+}
+
+int Fl_Image_Reducer::can_reduce(int src_w, int src_h, int dst_w, int dst_h) {
+  return dst_w > 0 && dst_h > 0 && dst_w <= src_w && dst_h <= src_h &&
+         (dst_w < src_w || dst_h < src_h);
+}
+
+int Fl_Image_Reducer::start(int src_w, int src_h, int dst_w, int dst_h, int depth,
+                            unsigned char *out, int nearest) {
+  if (!can_reduce(src_w, src_h, dst_w, dst_h) || depth < 1) return 0;
+  src_w_ = src_w; src_h_ = src_h;
+  dst_w_ = dst_w; dst_h_ = dst_h;
+  depth_ = depth;
+  nearest_ = nearest;
+  out_ = out;
+  memset(out_, 0, (size_t)dst_w * dst_h * depth);
+  row_ = new unsigned char[(size_t)src_w * depth];
+  if (nearest) {
+    // sample the center column of each box
+    xmap_ = new int[dst_w];
+    for (int dx = 0; dx < dst_w; dx++)
+      xmap_[dx] = (int)(((long long)(2 * dx + 1) * src_w) / (2 * dst_w));
+  } else {
+    xmap_ = new int[src_w];
+    xcount_ = new int[dst_w];
+    memset(xcount_, 0, dst_w * sizeof(int));
+    for (int sx = 0; sx < src_w; sx++) {
+      xmap_[sx] = (int)(((long long)sx * dst_w) / src_w);
+      xcount_[xmap_[sx]]++;
+    }
+    acc_ = new unsigned int[(size_t)dst_w * depth];
+    memset(acc_, 0, (size_t)dst_w * depth * sizeof(unsigned int));
+  }
+  acc_row_ = -1;
+  acc_taps_ = 0;
+  return 1;
+}
+
+int Fl_Image_Reducer::dst_row(int y) const {
+  return (int)(((long long)y * dst_h_) / src_h_);
+}
+
+int Fl_Image_Reducer::box_top(int dy) const {
+  return (int)(((long long)dy * src_h_ + dst_h_ - 1) / dst_h_);
+}
+
+int Fl_Image_Reducer::taps(int dy) const {
+  if (nearest_) return 1;
+  int n = box_top(dy + 1) - box_top(dy);
+  return n < MAX_TAPS ? n : MAX_TAPS;
+}
+
+int Fl_Image_Reducer::wants_row(int y) const {
+  if (!out_ || y < 0 || y >= src_h_) return 0;
+  int dy = dst_row(y);
+  int top = box_top(dy);
+  int n = box_top(dy + 1) - top;
+  int t = taps(dy);
+  for (int k = 0; k < t; k++)
+    if (y == top + ((2 * k + 1) * n) / (2 * t)) return 1;
+  return 0;
+}
+
+void Fl_Image_Reducer::add_row(int y) {
+  if (!out_ || y < 0 || y >= src_h_) return;
+  int dy = dst_row(y);
+  const int d = depth_;
+  if (nearest_) {
+    unsigned char *o = out_ + (size_t)dy * dst_w_ * d;
+    for (int dx = 0; dx < dst_w_; dx++, o += d)
+      memcpy(o, row_ + (size_t)xmap_[dx] * d, d);
+    return;
+  }
+  if (acc_taps_ && acc_row_ != dy) emit(); // rows of the last box are missing
+  acc_row_ = dy;
+  const unsigned char *s = row_;
+  for (int sx = 0; sx < src_w_; sx++) {
+    unsigned int *a = acc_ + xmap_[sx] * d;
+    for (int c = 0; c < d; c++) a[c] += *s++;
+  }
+  if (++acc_taps_ >= taps(dy)) emit();
+}
+
+void Fl_Image_Reducer::emit() {
+  const int d = depth_;
+  unsigned char *o = out_ + (size_t)acc_row_ * dst_w_ * d;
+  unsigned int *a = acc_;
+  for (int dx = 0; dx < dst_w_; dx++) {
+    unsigned int n = (unsigned int)(xcount_[dx] * acc_taps_);
+    for (int c = 0; c < d; c++, a++) {
+      *o++ = (unsigned char)((*a + n / 2) / n);
+      *a = 0;
+    }
+  }
+  acc_taps_ = 0;
+}
+
+void Fl_Image_Reducer::finish() {
+  if (out_ && acc_taps_) emit();
+}
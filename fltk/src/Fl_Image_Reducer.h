@@ -0,0 +1,91 @@
+//
+// Internal image reducer class for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2024 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/*
+  This internal (undocumented) class shrinks an image while it is being
+  decoded, one source row at a time, so that image loaders can produce a
+  thumbnail without ever holding the image at full size.
+
+  The loader decodes each row it needs into row() and passes it to
+  add_row(). Rows for which wants_row() returns 0 don't contribute and
+  can be skipped in the file, if the format allows it.
+
+  Each destination pixel is the average of the box of source pixels it
+  covers. Of the source rows in a box at most MAX_TAPS, evenly spaced,
+  are used. In nearest mode (for palette indices, which can't be
+  averaged) the pixel at the center of the box is used.
+
+  This class is used in Fl_BMP_Image, Fl_PNM_Image and Fl_GIF_Image.
+*/
+
+#ifndef FL_IMAGE_REDUCER_H
+#define FL_IMAGE_REDUCER_H
+
+class Fl_Image_Reducer {
+public:
+  // Create an inactive reducer.
+  Fl_Image_Reducer();
+
+  // Free the row buffers.
+  ~Fl_Image_Reducer();
+
+  // Returns 1 if an image of src_w x src_h pixels can be reduced to dst_w
+  // x dst_h pixels, i.e. the destination is smaller and not larger in
+  // either direction.
+  static int can_reduce(int src_w, int src_h, int dst_w, int dst_h);
+
+  // Start reducing an image of src_w x src_h pixels with depth bytes per
+  // pixel into out, which holds dst_w x dst_h pixels. Returns 0 and stays
+  // inactive if can_reduce() is false.
+  int start(int src_w, int src_h, int dst_w, int dst_h, int depth,
+            unsigned char *out, int nearest = 0);
+
+  // Returns 1 between start() and finish()
+  int active() const { return out_ != 0; }
+
+  // Buffer for one source row, filled by the loader before add_row()
+  unsigned char *row() { return row_; }
+
+  // Returns 1 if source row y is used
+  int wants_row(int y) const;
+
+  // Add the contents of row() as source row y. The rows of one destination
+  // row must be added together, top-down or bottom-up.
+  void add_row(int y);
+
+  // Write a partially added destination row, e.g. of a truncated file
+  void finish();
+
+  enum { MAX_TAPS = 4 };
+
+private:
+  int dst_row(int y) const;         // destination row of source row y
+  int box_top(int dy) const;        // first source row of destination row dy
+  int taps(int dy) const;           // number of rows used for destination row dy
+  void emit();
+
+  int src_w_, src_h_, dst_w_, dst_h_, depth_, nearest_;
+  unsigned char *out_;
+  unsigned char *row_;
+  int *xmap_;                       // destination column of each source column,
+                                    // in nearest mode source column of each destination column
+  int *xcount_;                     // source columns of each destination column
+  unsigned int *acc_;               // sums of the current destination row
+  int acc_row_;                     // current destination row or -1
+  int acc_taps_;                    // rows added to acc_
+};
+
+#endif // FL_IMAGE_REDUCER_H
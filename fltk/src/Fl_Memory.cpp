@@ -0,0 +1,132 @@
+//
+// Memory accounting for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2024 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include "Fl_Memory.h"
+#include "../hdr/Fl_Shared_Image.h"
+#include "../hdr/fl_utf8.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int fl_memory_accounting_ = -1;
+
+static Fl_Memory_Stats stats_;
+
+#define MAX_TRIM_HANDLERS 16
+static Fl_Memory_Trim_Handler trim_handlers[MAX_TRIM_HANDLERS];
+static int num_trim_handlers = 0;
+
+void fl_memory_account_(Fl_Memory_Category c, long delta) {
+  if (fl_memory_accounting_ < 0) {
+    const char *v = fl_getenv("FLTK_MEMORY_STATS");
+    fl_memory_accounting_ = (v && *v && strcmp(v, "0")) ? 1 : 0;
+    if (!fl_memory_accounting_) return;
+  }
+  size_t &live = stats_.live[c];
+  if (delta < 0) {
+    // memory allocated before accounting was turned on is not known
+    size_t d = (size_t)(-delta);
+    if (d > live) d = live;
+    live -= d;
+    stats_.total -= d;
+    return;
+  }
+  live += (size_t)delta;
+  stats_.total += (size_t)delta;
+  if (live > stats_.peak[c]) stats_.peak[c] = live;
+  if (stats_.total > stats_.total_peak) stats_.total_peak = stats_.total;
+}
+
+void fl_memory_trim_handler(Fl_Memory_Trim_Handler h) {
+  for (int i = 0; i < num_trim_handlers; i++)
+    if (trim_handlers[i] == h) return;
+  if (num_trim_handlers < MAX_TRIM_HANDLERS)
+    trim_handlers[num_trim_handlers++] = h;
+}
+
+// Bytes of pixel data held by an image: depth 0 is a bitmap,
+// a negative depth a pixmap with at least one character per pixel.
+long fl_image_bytes(const Fl_Image *img) {
+  if (!img) return 0;
+  int W = img->data_w(), H = img->data_h();
+  if (W <= 0 || H <= 0) return 0;
+  if (img->d() == 0) return fl_bitmask_bytes(W, H);
+  if (img->d() < 0) return (long)W * H;
+  long line = img->ld() ? img->ld() : (long)W * img->d();
+  return line * H;
+}
+
+/**
+  Turns memory accounting on or off.
+
+  While accounting is on, FLTK counts the memory held by its major owners:
+  shared image pixel data and cached image forms, text buffers and their
+  undo data, terminal ring buffers, fonts, tree items, offscreen buffers
+  and image drawing scratch buffers. See Fl_Memory_Category.
+
+  Only allocations and releases done while accounting is on are counted,
+  so turn it on before creating the objects you want to measure, or set
+  the environment variable \c FLTK_MEMORY_STATS to \c 1 to have it on from
+  the start.
+
+  \see memory_stats(), memory_trim()
+*/
+void Fl::memory_accounting(int on) {
+  fl_memory_accounting_ = on ? 1 : 0;
+}
+
+/** Returns non-zero if memory accounting is on. */
+int Fl::memory_accounting() {
+  if (fl_memory_accounting_ < 0) fl_memory_account_(FL_MEMORY_IMAGES, 0);
+  return fl_memory_accounting_;
+}
+
+/**
+  Returns the bytes currently held and the peak values per category.
+  All values are zero if memory accounting was never turned on.
+  \see memory_accounting()
+*/
+void Fl::memory_stats(Fl_Memory_Stats &stats) {
+  stats = stats_;
+}
+
+/** Sets the peak values to the current live values. */
+void Fl::reset_memory_peaks() {
+  for (int i = 0; i < FL_MEMORY_CATEGORIES; i++)
+    stats_.peak[i] = stats_.live[i];
+  stats_.total_peak = stats_.total;
+}
+
+/**
+  Releases memory that FLTK can rebuild when it is needed again.
+
+  This drops the cached forms of all shared images, which are recreated
+  the next time an image is drawn, and frees the scratch buffers of the
+  image drawing code. Call it when the system is short of memory, for
+  instance after closing a large document or when the application is
+  iconified.
+
+  \return bytes released, as counted by memory accounting (0 if it is off)
+*/
+size_t Fl::memory_trim() {
+  size_t before = stats_.total;
+  Fl_Shared_Image **images = Fl_Shared_Image::images();
+  for (int i = 0; i < Fl_Shared_Image::num_images(); i++)
+    images[i]->uncache();
+  for (int i = 0; i < num_trim_handlers; i++)
+    trim_handlers[i]();
+  return before > stats_.total ? before - stats_.total : 0;
+}
@@ -0,0 +1,52 @@
+//
+// Header for memory accounting support functions for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2024 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#ifndef _src_Fl_Memory_h_
+#define _src_Fl_Memory_h_
+
+#include "../hdr/Fl.h"
+
+class Fl_Image;
+
+/*
+  Internal interface of Fl::memory_stats().
+
+  Owners of large allocations report every size change with
+  fl_memory_account(). While accounting is off this is a test of a
+  static flag.
+
+  Owners of memory that can be rebuilt on demand register a trim handler
+  with fl_memory_trim_handler(); Fl::memory_trim() calls all of them.
+*/
+
+// 1 = on, 0 = off, -1 = FLTK_MEMORY_STATS not checked yet
+extern FL_EXPORT int fl_memory_accounting_;
+FL_EXPORT void fl_memory_account_(Fl_Memory_Category c, long delta);
+
+inline void fl_memory_account(Fl_Memory_Category c, long delta) {
+  if (fl_memory_accounting_ && delta) fl_memory_account_(c, delta);
+}
+
+typedef void (*Fl_Memory_Trim_Handler)();
+FL_EXPORT void fl_memory_trim_handler(Fl_Memory_Trim_Handler h);
+
+// size estimates of memory that lives in the display server
+inline long fl_offscreen_bytes(int w, int h) { return 4L * w * h; }
+inline long fl_bitmask_bytes(int w, int h) { return (long)((w + 7) / 8) * h; }
+
+FL_EXPORT long fl_image_bytes(const Fl_Image *img);
+
+#endif // !_src_Fl_Memory_h_
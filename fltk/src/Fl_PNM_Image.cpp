@@ -29,6 +29,7 @@
 #include <stdlib.h>
 #include "../hdr/fl_utf8.h"
 #include "flstring.h"
+#include "Fl_Image_Reducer.h"
 
 
 //
@@ -51,6 +52,30 @@
  */
 Fl_PNM_Image::Fl_PNM_Image(const char *filename)        // I - File to read
   : Fl_RGB_Image(0,0,0) {
+  load_pnm_(filename, 0, 0);
+}
+
+/**
+ This constructor loads the named PNM image reduced to \p W x \p H pixels.
+
+ The image is shrunk with a box filter while it is read, so that it is
+ never held in memory at full size. Rows of binary files that don't
+ contribute are skipped. If the image is not larger than \p W x \p H it
+ is loaded at its own size, check data_w() and data_h().
+
+ Fl_Shared_Image::get() uses this to load thumbnails when it is called
+ with FL_DECODE_REDUCED.
+
+ \param[in] filename a full path and name pointing to a valid PNM file.
+ \param[in] W, H     size of the reduced image
+ */
+Fl_PNM_Image::Fl_PNM_Image(const char *filename, int W, int H)
+  : Fl_RGB_Image(0,0,0) {
+  load_pnm_(filename, W, H);
+}
+
+// Reads the file, reduced to reduce_w x reduce_h pixels if these are not 0
+void Fl_PNM_Image::load_pnm_(const char *filename, int reduce_w, int reduce_h) {
   FILE          *fp;            // File pointer
   int           x, y;           // Looping vars
   char          line[1024],     // Input line
@@ -61,6 +86,7 @@ Fl_PNM_Image::Fl_PNM_Image(const char *filename)        // I - File to read
   int           format,         // Format of PNM file
                 val,            // Pixel value
                 maxval;         // Maximum pixel value
+  Fl_Image_Reducer reducer;     // Shrinks the rows while reading, if active
 
 
   if ((fp = fl_fopen(filename, "rb")) == NULL) {
@@ -130,18 +156,40 @@ Fl_PNM_Image::Fl_PNM_Image(const char *filename)        // I - File to read
 
 //  printf("%s = %dx%dx%d\n", filename, w(), h(), d());
 
-  if (((size_t)w()) * h() * d() > max_size() ) {
+  if (!Fl_Image_Reducer::can_reduce(w(), h(), reduce_w, reduce_h))
+    reduce_w = reduce_h = 0;
+
+  if (((size_t)(reduce_w ? reduce_w : w())) * (reduce_h ? reduce_h : h()) * d() > max_size() ) {
     Fl::warning("PNM file \"%s\" is too large!\n", filename);
     fclose(fp);
     w(0); h(0); d(0); ld(ERR_FORMAT);
     return;
   }
-  array       = new uchar[w() * h() * d()];
+  if (reduce_w) {
+    array = new uchar[reduce_w * reduce_h * d()];
+    reducer.start(w(), h(), reduce_w, reduce_h, d(), (uchar *)array);
+  } else {
+    array = new uchar[w() * h() * d()];
+  }
   alloc_array = 1;
 
+  // Size of a row in binary files, which can be skipped when reducing
+  long rowbytes = 0;
+  if (format == 4) rowbytes = (w() + 7) / 8;
+  else if (format == 5 || format == 6) rowbytes = (long)w() * d() * (maxval < 256 ? 1 : 2);
+  else if (format == 7) rowbytes = w();
+
   // Read the image file...
   for (y = 0; y < h(); y ++) {
-    ptr = (uchar *)array + y * w() * d();
+    if (reducer.active()) {
+      if (rowbytes && !reducer.wants_row(y)) {
+        fseek(fp, rowbytes, SEEK_CUR);
+        continue;
+      }
+      ptr = reducer.row();
+    } else {
+      ptr = (uchar *)array + y * w() * d();
+    }
 
     switch (format) {
       case 1 :
@@ -198,7 +246,14 @@ Fl_PNM_Image::Fl_PNM_Image(const char *filename)        // I - File to read
         }
         break;
     }
+    if (reducer.wants_row(y)) reducer.add_row(y);
   }
 
   fclose(fp);
+
+  if (reducer.active()) {
+    reducer.finish();
+    w(reduce_w);
+    h(reduce_h);
+  }
 }
@@ -30,8 +30,11 @@
 
 #include <stdio.h>
 #include "flstring.h"
+#include "Fl_Memory.h"
 #include <ctype.h>
 
+void fl_forget_decoded_pixmap(const Fl_Pixmap *pxm); // in fl_draw_pixmap.cxx
+
 void Fl_Pixmap::measure() {
   int W, H;
 
@@ -53,11 +56,14 @@ void Fl_Pixmap::draw(int XP, int YP, int WP, int HP, int cx, int cy) {
 */
 Fl_Pixmap::~Fl_Pixmap() {
   uncache();
+  fl_forget_decoded_pixmap(this);
   delete_data();
 }
 
 void Fl_Pixmap::uncache() {
   if (id_) {
+    fl_memory_account(FL_MEMORY_IMAGE_CACHE, -(fl_offscreen_bytes(cache_w_, cache_h_) +
+                      (mask_ ? fl_bitmask_bytes(cache_w_, cache_h_) : 0)));
     Fl_Graphics_Driver::default_driver().uncache_pixmap(id_);
     id_ = 0;
   }
@@ -228,6 +234,7 @@ Fl_Image *Fl_Pixmap::copy(int W, int H) const {
 void Fl_Pixmap::color_average(Fl_Color c, float i) {
   // Delete any existing pixmap/mask objects...
   uncache();
+  fl_forget_decoded_pixmap(this);
 
   // Allocate memory as needed...
   copy_data();
@@ -322,6 +329,7 @@ void Fl_Pixmap::set_data(const char * const * p) {
 void Fl_Pixmap::desaturate() {
   // Delete any existing pixmap/mask objects...
   uncache();
+  fl_forget_decoded_pixmap(this);
 
   // Allocate memory as needed...
   copy_data();
@@ -25,8 +25,10 @@
 #include "../hdr/fl_string_functions.h"
 #include "Fl_Screen_Driver.h"
 #include "Fl_System_Driver.h"
+#include "Fl_Memory.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 
 #include "nanosvg/nanosvg.h"
 #include "nanosvg/nanosvgrast.h"
@@ -36,6 +38,137 @@
 #endif
 
 
+/*
+  Parsed images, shared by all Fl_SVG_Image objects made from the same
+  file or data.
+
+  Parsing is by far the slowest part of loading an SVG image. A parsed
+  image made from a file is found again by the file name, modification
+  time and size, one made from data in memory by the length and a hash
+  of the data. Images that are no longer used by any Fl_SVG_Image stay in
+  the list, most recently used first, up to PARSED_BUDGET bytes, so that
+  an icon theme that is loaded again is not parsed again.
+  Fl::memory_trim() frees them.
+*/
+
+#define PARSED_BUDGET (8 * 1024 * 1024)
+
+struct Fl_SVG_Image::counted_NSVGimage {
+  NSVGimage* svg_image;
+  int ref_count;
+  char *filename;               // the file, NULL for data in memory
+  time_t mtime;                 // modification time of the file
+  size_t length;                // length of the file or data, 0 if not in the list
+  unsigned long long hash;      // hash of the data in memory or of the file name
+  long bytes;                   // memory used by svg_image
+  counted_NSVGimage *prev, *next;
+
+  static counted_NSVGimage *first, *last;
+  static long unused_bytes;     // of the images in the list with ref_count 0
+
+  counted_NSVGimage(NSVGimage *img);
+  static counted_NSVGimage *find(const char *filename, time_t mtime, size_t length,
+                                 unsigned long long hash);
+  void add(const char *filename, time_t mtime, size_t length, unsigned long long hash);
+  void release();
+  void destroy();
+  void link_first();
+  void unlink();
+  static void shrink(long budget);
+  static void trim() { shrink(0); }
+};
+
+Fl_SVG_Image::counted_NSVGimage *Fl_SVG_Image::counted_NSVGimage::first = 0;
+Fl_SVG_Image::counted_NSVGimage *Fl_SVG_Image::counted_NSVGimage::last = 0;
+long Fl_SVG_Image::counted_NSVGimage::unused_bytes = 0;
+
+Fl_SVG_Image::counted_NSVGimage::counted_NSVGimage(NSVGimage *img)
+  : svg_image(img), ref_count(1), filename(0), mtime(0), length(0), hash(0)
+  , bytes((long)nsvgImageSize(img)), prev(0), next(0) {
+  fl_memory_account(FL_MEMORY_IMAGE_CACHE, bytes);
+}
+
+void Fl_SVG_Image::counted_NSVGimage::link_first() {
+  prev = 0;
+  next = first;
+  if (first) first->prev = this; else last = this;
+  first = this;
+}
+
+void Fl_SVG_Image::counted_NSVGimage::unlink() {
+  if (prev) prev->next = next; else first = next;
+  if (next) next->prev = prev; else last = prev;
+}
+
+// Returns the parsed image of a file or data with a new reference, or NULL
+Fl_SVG_Image::counted_NSVGimage *Fl_SVG_Image::counted_NSVGimage::find(
+    const char *filename, time_t mtime, size_t length, unsigned long long hash) {
+  for (counted_NSVGimage *c = first; c; c = c->next) {
+    if (c->length != length || c->hash != hash) continue;
+    if (filename ? !c->filename || c->mtime != mtime || strcmp(c->filename, filename)
+                 : c->filename != 0)
+      continue;
+    if (c->ref_count++ == 0) unused_bytes -= c->bytes;
+    c->unlink();
+    c->link_first();
+    return c;
+  }
+  return 0;
+}
+
+// Puts the image in the list, so that it is found by find()
+void Fl_SVG_Image::counted_NSVGimage::add(const char *name, time_t time, size_t len,
+                                          unsigned long long h) {
+  filename = name ? fl_strdup(name) : 0;
+  mtime = time;
+  length = len;
+  hash = h;
+  link_first();
+  fl_memory_trim_handler(trim);
+}
+
+void Fl_SVG_Image::counted_NSVGimage::release() {
+  if (--ref_count > 0) return;
+  if (!length) {
+    destroy();
+    return;
+  }
+  unused_bytes += bytes;
+  shrink(PARSED_BUDGET);
+}
+
+void Fl_SVG_Image::counted_NSVGimage::destroy() {
+  if (length) unlink();
+  fl_memory_account(FL_MEMORY_IMAGE_CACHE, -bytes);
+  nsvgDelete(svg_image);
+  free(filename);
+  delete this;
+}
+
+// Frees the least recently used unused images down to budget bytes
+void Fl_SVG_Image::counted_NSVGimage::shrink(long budget) {
+  counted_NSVGimage *c = last;
+  while (c && unused_bytes > budget) {
+    counted_NSVGimage *p = c->prev;
+    if (c->ref_count <= 0) {
+      unused_bytes -= c->bytes;
+      c->destroy();
+    }
+    c = p;
+  }
+}
+
+// 64-bit FNV-1a hash
+static unsigned long long svg_hash(const unsigned char *data, size_t length) {
+  unsigned long long h = 14695981039346656037ULL;
+  for (size_t i = 0; i < length; i++) {
+    h ^= data[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+
 /** Load an SVG image from a file.
 
  This constructor loads the SVG image from a .svg or .svgz file. The reader
@@ -110,10 +243,7 @@ Fl_SVG_Image::Fl_SVG_Image(const Fl_SVG_Image *source) :
 
 /** The destructor frees all memory and server resources that are used by the SVG image. */
 Fl_SVG_Image::~Fl_SVG_Image() {
-  if ( --counted_svg_image_->ref_count <= 0) {
-    nsvgDelete(counted_svg_image_->svg_image);
-    delete counted_svg_image_;
-  }
+  if (counted_svg_image_) counted_svg_image_->release();
 }
 
 
@@ -209,27 +339,11 @@ static int svg_inflate(uchar *src, size_t src_length, uchar *&dst, size_t &dst_l
 #endif // defined(HAVE_LIBZ)
 
 
-void Fl_SVG_Image::init_(const char *name, const unsigned char *in_data, size_t length) {
-  counted_svg_image_ = new counted_NSVGimage;
-  counted_svg_image_->svg_image = NULL;
-  counted_svg_image_->ref_count = 1;
-  to_desaturate_ = false;
-  average_weight_ = 1;
-  proportional = true;
-
+// Reads and parses an SVG file or data, or reads a precompiled image.
+static NSVGimage *svg_load(const char *filename, const unsigned char *in_data, size_t length) {
   // yes, this is a const cast to avoid duplicating user supplied data
   uchar *data = const_cast<uchar*>(in_data); // 🤨 careful with this, don't overwrite user supplied data in nsvgParse()
 
-  // this is to make it clear what we are doing
-  const char *sharedname = data ? name : NULL;
-  const char *filename = data ? NULL : name;
-
-  // prepare with error data, so we can just return if an error occurs
-  d(-1);
-  ld(ERR_FORMAT);
-  rasterized_ = false;
-  raster_w_ = raster_h_ = 0;
-
   // if we are reading from a file, just read the entire file into a memory block
   if (!data) {
     FILE *f = fl_fopen(filename, "rb");
@@ -248,7 +362,7 @@ void Fl_SVG_Image::init_(const char *name, const unsigned char *in_data, size_t
       }
       fclose(f);
     }
-    if (!data) return;
+    if (!data) return NULL;
   }
 
   // now if our data is compressed, we use zlib to infalte it
@@ -267,31 +381,83 @@ void Fl_SVG_Image::init_(const char *name, const unsigned char *in_data, size_t
         data[length] = 0;
       } else {
         if (in_data != data) free(data);
-        return;
+        return NULL;
       }
 #else
       if (in_data != data) free(data);
-      return;
+      return NULL;
 #endif // HAVE_LIBZ
     }
   }
 
-  // now our SVG data should be in text format in `data`, terminated by a NUL
-  // nsvgParse is destructive, so if in_data was set, we must duplicate the data first!
-  if (in_data == data) {
-    if (length) {
-      data = (uchar*)malloc(length+1);
-      memcpy(data, in_data, length);
-      data[length] = 0;
-    } else {
-      data = (uchar*)fl_strdup((char*)in_data);
+  NSVGimage *svg_image;
+  if (length > sizeof(NSVG_SERIAL_MAGIC) &&
+      memcmp(data, NSVG_SERIAL_MAGIC, sizeof(NSVG_SERIAL_MAGIC) - 1) == 0) {
+    // a precompiled image, see Fl_SVG_Image::write_precompiled()
+    svg_image = nsvgDeserialize(data, length);
+  } else {
+    // now our SVG data should be in text format in `data`, terminated by a NUL
+    // nsvgParse is destructive, so if in_data was set, we must duplicate the data first!
+    if (in_data == data) {
+      if (length) {
+        data = (uchar*)malloc(length+1);
+        memcpy(data, in_data, length);
+        data[length] = 0;
+      } else {
+        data = (uchar*)fl_strdup((char*)in_data);
+      }
     }
+    svg_image = nsvgParse((char*)data, "px", 96);
   }
-  counted_svg_image_->svg_image = nsvgParse((char*)data, "px", 96);
   if (in_data != data) free(data);
-  if (counted_svg_image_->svg_image->width != 0 && counted_svg_image_->svg_image->height != 0) {
-    w(int(counted_svg_image_->svg_image->width + 0.5));
-    h(int(counted_svg_image_->svg_image->height + 0.5));
+  return svg_image;
+}
+
+
+void Fl_SVG_Image::init_(const char *name, const unsigned char *in_data, size_t length) {
+  to_desaturate_ = false;
+  average_weight_ = 1;
+  proportional = true;
+
+  // this is to make it clear what we are doing
+  const char *sharedname = in_data ? name : NULL;
+  const char *filename = in_data ? NULL : name;
+
+  // prepare with error data, so we can just return if an error occurs
+  d(-1);
+  ld(ERR_FORMAT);
+  rasterized_ = false;
+  raster_w_ = raster_h_ = 0;
+
+  // look for the image parsed before from the same file or data
+  time_t mtime = 0;
+  size_t key_length = 0; // 0 if the image is not shared
+  unsigned long long hash = 0;
+  if (!in_data) {
+    struct stat st;
+    if (filename && fl_stat(filename, &st) == 0 && st.st_size > 0) {
+      mtime = st.st_mtime;
+      key_length = (size_t)st.st_size;
+    }
+  } else if (length) {
+    key_length = length;
+  } else if (in_data[0] != 0x1f || in_data[1] != 0x8b) { // not compressed data of unknown length
+    key_length = strlen((const char*)in_data);
+  }
+  if (key_length) hash = in_data ? svg_hash(in_data, key_length)
+                                 : svg_hash((const uchar*)filename, strlen(filename));
+  counted_svg_image_ = key_length ? counted_NSVGimage::find(filename, mtime, key_length, hash) : NULL;
+
+  if (!counted_svg_image_) {
+    NSVGimage *svg_image = svg_load(filename, in_data, length);
+    counted_svg_image_ = new counted_NSVGimage(svg_image);
+    if (svg_image && key_length) counted_svg_image_->add(filename, mtime, key_length, hash);
+  }
+
+  NSVGimage *svg_image = counted_svg_image_->svg_image;
+  if (svg_image && svg_image->width != 0 && svg_image->height != 0) {
+    w(int(svg_image->width + 0.5));
+    h(int(svg_image->height + 0.5));
     d(4);
     ld(0);
   }
@@ -412,4 +578,46 @@ void Fl_SVG_Image::normalize() {
   if (!array) resize(w(), h());
 }
 
+/** Writes the parsed image in a compact binary form.
+ The binary form can be loaded like SVG data, by all constructors and by
+ Fl_Shared_Image::get(), without parsing. The length must be given when it
+ is loaded from memory. It is independent of the byte order of the
+ machine, but may change with new FLTK versions.
+
+ Applications with many icons can use this to precompile them when they
+ are built or installed, see write_precompiled().
+
+ \param buffer receives the binary form if it holds \p size bytes or more
+ \param size the size of \p buffer
+ \return the length of the binary form, or 0 if the image failed to load
+ */
+size_t Fl_SVG_Image::precompiled_data(unsigned char *buffer, size_t size) const {
+  if (!counted_svg_image_->svg_image) return 0;
+  return nsvgSerialize(counted_svg_image_->svg_image, buffer, size);
+}
+
+/** Writes the parsed image in a compact binary form to a file.
+ \see precompiled_data()
+ \param filename the file to write
+ \return     success (0) or error code: negative values are errors
+ \retval      0        success, file has been written
+ \retval     -1        the image failed to load
+ \retval     -2        file open or write error
+ */
+int Fl_SVG_Image::write_precompiled(const char *filename) const {
+  size_t length = precompiled_data(NULL, 0);
+  if (!length) return -1;
+  uchar *buffer = (uchar*)malloc(length);
+  if (!buffer) return -2;
+  precompiled_data(buffer, length);
+  FILE *f = fl_fopen(filename, "wb");
+  int ret = -2;
+  if (f) {
+    if (fwrite(buffer, 1, length, f) == length) ret = 0;
+    if (fclose(f) != 0) ret = -2;
+  }
+  free(buffer);
+  return ret;
+}
+
 #endif // FLTK_USE_SVG
@@ -18,6 +18,7 @@
 #include <stdlib.h>
 #include "../hdr/fl_utf8.h"
 #include "flstring.h"
+#include "Fl_Memory.h"
 
 #include "../hdr/Fl.h"
 #include "../hdr/Fl_Shared_Image.h"
@@ -37,6 +38,8 @@ int     Fl_Shared_Image::alloc_images_ = 0;     // Allocated shared images
 Fl_Shared_Handler *Fl_Shared_Image::handlers_ = 0;// Additional format handlers
 int     Fl_Shared_Image::num_handlers_ = 0;     // Number of format handlers
 int     Fl_Shared_Image::alloc_handlers_ = 0;   // Allocated format handlers
+int     Fl_Shared_Image::decode_w_ = 0;         // Reduced size requested from handlers
+int     Fl_Shared_Image::decode_h_ = 0;
 
 
 //
@@ -117,6 +120,8 @@ Fl_Shared_Image::Fl_Shared_Image() : Fl_Image(0,0,0) {
   original_    = 0;
   image_       = 0;
   alloc_image_ = 0;
+  accounted_   = 0;
+  reduced_     = 0;
 }
 
 
@@ -140,6 +145,8 @@ Fl_Shared_Image::Fl_Shared_Image(const char *n,
   image_       = img;
   alloc_image_ = !img;
   original_    = 1;
+  accounted_   = 0;
+  reduced_     = 0;
 
   if (!img) reload();
   else update();
@@ -196,6 +203,9 @@ Fl_Shared_Image::update() {
     d(image_->d());
     data(image_->data(), image_->count());
     if (W && H) scale(W, H, 0, 1);
+    long bytes = fl_image_bytes(image_);
+    fl_memory_account(FL_MEMORY_IMAGES, bytes - accounted_);
+    accounted_ = bytes;
   }
 }
 
@@ -209,6 +219,7 @@ Fl_Shared_Image::update() {
 Fl_Shared_Image::~Fl_Shared_Image() {
   if (name_) delete[] (char *)name_;
   if (alloc_image_) delete image_;
+  fl_memory_account(FL_MEMORY_IMAGES, -accounted_);
 }
 
 /**
@@ -232,7 +243,8 @@ void Fl_Shared_Image::release() {
 
   // If this image is not the original, find the original image and make sure
   // to delete its reference counter as well at the end of this method.
-  if (!original()) {
+  // Reduced images were loaded without the original and hold no reference.
+  if (!original() && !reduced_) {
     Fl_Shared_Image *o = find(name());
     if (o) {
       if (o->original() && o!=this && o->refcount_>1)
@@ -293,6 +305,12 @@ void Fl_Shared_Image::reload() {
     return;
   }
 
+  // Reduced images are decoded at their own size if the handler can
+  if (reduced_) {
+    decode_w_ = data_w();
+    decode_h_ = data_h();
+  }
+
   // Load the image as appropriate...
   if (count >= 7 && memcmp(header, "#define", 7) == 0) // XBM file
     img = new Fl_XBM_Image(name_);
@@ -306,6 +324,15 @@ void Fl_Shared_Image::reload() {
     }
   }
 
+  // The pool is sorted by data size, see compare()
+  if (img && reduced_ && img->data_w() > 0 && img->data_h() > 0 &&
+      (img->data_w() != decode_w_ || img->data_h() != decode_h_)) {
+    Fl_Image *temp = img->copy(decode_w_, decode_h_);
+    delete img;
+    img = temp;
+  }
+  decode_w_ = decode_h_ = 0;
+
   if (img) {
     if (alloc_image_) delete image_;
 
@@ -561,6 +588,14 @@ Fl_Shared_Image* Fl_Shared_Image::find(const char *name, int W, int H) {
         If you request the same image with another size later, then the
         \b original image will be found, copied, resized, and returned.
 
+  With \p decode_hint FL_DECODE_REDUCED and if the original image is not
+  in the pool, only the image of the requested size is created. BMP, PNM
+  and GIF files are reduced while they are read, so that they never exist
+  in memory at full size, which is much cheaper for thumbnails of large
+  images. Other formats are loaded and resized, and the original is not
+  kept. Such a reduced image is found by later requests of the same size,
+  a request of another size loads the file again.
+
   Shared JPEG and PNG images can also be created from memory by using their
   named memory access constructor.
 
@@ -568,6 +603,7 @@ Fl_Shared_Image* Fl_Shared_Image::find(const char *name, int W, int H) {
 
   \param name name of the image
   \param W, H desired size
+  \param decode_hint FL_DECODE_FULL (default) or FL_DECODE_REDUCED
   \return the image at the requested size, or NULL if the image could not be
         found or generated
 
@@ -576,7 +612,7 @@ Fl_Shared_Image* Fl_Shared_Image::find(const char *name, int W, int H) {
   \see Fl_JPEG_Image::Fl_JPEG_Image(const char *name, const unsigned char *data)
   \see Fl_PNG_Image::Fl_PNG_Image (const char *name_png, const unsigned char *buffer, int maxsize)
 */
-Fl_Shared_Image* Fl_Shared_Image::get(const char *name, int W, int H) {
+Fl_Shared_Image* Fl_Shared_Image::get(const char *name, int W, int H, int decode_hint) {
   Fl_Shared_Image *temp;
   bool temp_referenced = false;
 
@@ -589,6 +625,21 @@ Fl_Shared_Image* Fl_Shared_Image::get(const char *name, int W, int H) {
   temp = find(name);
   if (temp) {
     temp_referenced = true;
+  } else if (decode_hint == FL_DECODE_REDUCED && W > 0 && H > 0) {
+    // Load only the requested size, see reload()
+    temp = new Fl_Shared_Image();
+    temp->name_ = new char[strlen(name) + 1];
+    strcpy((char *)temp->name_, name);
+    temp->reduced_ = 1;
+    temp->w(W);
+    temp->h(H);
+    temp->reload();
+    if (!temp->image_) {
+      delete temp;
+      return NULL;
+    }
+    temp->add();
+    return temp;
   } else {
     // No original found, so we generate it by loading the file
     temp = new Fl_Shared_Image(name);
@@ -0,0 +1,522 @@
+//
+// Worker thread pool for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2024 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include "../hdr/config.h"
+#include "../hdr/Fl_Task_Pool.h"
+#include "../hdr/Fl.h"
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+#  include <sched.h>
+#  include <unistd.h>
+#endif
+
+#define POOL_MAX_THREADS 64
+#define POOL_PRIORITIES (FL_TASK_HIGH + 1)
+
+/**
+  Creates a task running \p func with \p data.
+  Without a function, derive a class and override run().
+*/
+Fl_Task::Fl_Task(Fl_Task_Func func, void *data, int prio) {
+  func_ = func;
+  data_ = data;
+  then_ = 0;
+  then_data_ = 0;
+  token_ = 0;
+  pool_ = 0;
+  next_ = 0;
+  priority(prio);
+  ui_ = 0;
+  auto_delete_ = 1;
+  skipped_ = 0;
+  finished_ = 0;
+}
+
+Fl_Task::~Fl_Task() {
+}
+
+/**
+  Requests a continuation on the user interface thread.
+
+  When the work is done, or was skipped because the task was cancelled,
+  done() is called by the user interface thread. By default it calls
+  \p cb with \p data, if \p cb is not NULL.
+
+  Call this before the task is submitted.
+  \return the task, to allow submit((new Fl_Task(...))->then_on_ui(...))
+*/
+Fl_Task *Fl_Task::then_on_ui(Fl_Task_Func cb, void *data) {
+  ui_ = 1;
+  then_ = cb;
+  then_data_ = data;
+  return this;
+}
+
+/** The work of the task, called by a worker thread. Calls the function
+    given to the constructor. */
+void Fl_Task::run() {
+  if (func_) func_(this, data_);
+}
+
+/** The continuation of the task, called by the user interface thread
+    if then_on_ui() was called. Calls the function given to then_on_ui(). */
+void Fl_Task::done() {
+  if (then_) then_(this, then_data_);
+}
+
+#ifdef HAVE_PTHREAD
+
+// A growable ring of tasks, used as a double-ended queue
+struct Task_Ring {
+  Fl_Task **buf;
+  int head, count, size;        // size is a power of 2
+  void push_back(Fl_Task *t) {
+    if (count == size) {
+      int nsize = size ? 2 * size : 64;
+      Fl_Task **nbuf = (Fl_Task**)malloc(nsize * sizeof(Fl_Task*));
+      for (int i = 0; i < count; i++) nbuf[i] = buf[(head + i) & (size - 1)];
+      free(buf);
+      buf = nbuf; head = 0; size = nsize;
+    }
+    buf[(head + count++) & (size - 1)] = t;
+  }
+  Fl_Task *pop_back() {
+    return count ? buf[(head + --count) & (size - 1)] : 0;
+  }
+  Fl_Task *pop_front() {
+    if (!count) return 0;
+    Fl_Task *t = buf[head];
+    head = (head + 1) & (size - 1);
+    count--;
+    return t;
+  }
+  // removes t, returns 0 if it is not queued here
+  int remove(Fl_Task *t) {
+    int i;
+    for (i = 0; i < count && buf[(head + i) & (size - 1)] != t; i++) {}
+    if (i == count) return 0;
+    for (count--; i < count; i++)
+      buf[(head + i) & (size - 1)] = buf[(head + i + 1) & (size - 1)];
+    return 1;
+  }
+};
+
+struct Task_Worker {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  Task_Ring queue[POOL_PRIORITIES];
+  Fl_Task_Pool_Data *pool;
+};
+
+struct Fl_Task_Pool_Data {
+  Fl_Task_Pool *pool;
+  int nthreads;                 // requested
+  int running;                  // started worker threads, protected by lock
+  Task_Worker *workers;
+  pthread_mutex_t lock;         // protects inject[], stop, idle waits
+  pthread_cond_t work;          // signalled when tasks are queued
+  Task_Ring inject[POOL_PRIORITIES]; // tasks submitted by other threads
+  volatile int queued;          // tasks in all queues
+  volatile int outstanding;     // submitted tasks that are not finished
+  int stop;
+
+  Fl_Task *take(Task_Worker *self);
+  int claim(Fl_Task *task);
+  void execute(Fl_Task *task);
+  static void finish_locked(Fl_Task *task);
+  static void deliver_done(void *);
+  static void queue_done(Fl_Task *task);
+};
+
+// Finished tasks of all pools waiting for their continuation on the UI
+// thread, and the condition joins and waits sleep on.
+static pthread_mutex_t done_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+static Fl_Task *done_head = 0, *done_tail = 0;
+static int done_awake = 0;      // an Fl::awake() delivery is queued
+static int done_waiters = 0;
+static int done_deliverers = 0; // waiters in wait(), which call continuations
+
+static pthread_key_t worker_key;
+static pthread_once_t worker_key_once = PTHREAD_ONCE_INIT;
+static void make_worker_key() { pthread_key_create(&worker_key, 0); }
+
+// Marks a task without continuation finished, or deletes it.
+// Called with done_lock held.
+void Fl_Task_Pool_Data::finish_locked(Fl_Task *task) {
+  Fl_Task_Pool_Data *d = task->pool_;
+  if (task->auto_delete_) delete task;
+  else task->finished_ = 1;
+  if (d) __sync_sub_and_fetch(&d->outstanding, 1);
+  if (done_waiters) pthread_cond_broadcast(&done_cond);
+}
+
+// Calls the continuations of all finished tasks, on the UI thread.
+// 'from_awake' is NULL when called by wait(), which leaves the queued
+// Fl::awake() entry in place.
+void Fl_Task_Pool_Data::deliver_done(void *from_awake) {
+  pthread_mutex_lock(&done_lock);
+  Fl_Task *list = done_head;
+  done_head = done_tail = 0;
+  if (from_awake) done_awake = 0;
+  pthread_mutex_unlock(&done_lock);
+  while (list) {
+    Fl_Task *task = list;
+    list = task->next_;
+    task->done();
+    pthread_mutex_lock(&done_lock);
+    finish_locked(task);
+    pthread_mutex_unlock(&done_lock);
+  }
+}
+
+// Queues a task for its continuation; one Fl::awake() per batch
+void Fl_Task_Pool_Data::queue_done(Fl_Task *task) {
+  int need_awake;
+  pthread_mutex_lock(&done_lock);
+  task->next_ = 0;
+  if (done_tail) done_tail->next_ = task;
+  else done_head = task;
+  done_tail = task;
+  need_awake = !done_awake;
+  done_awake = 1;
+  if (done_waiters) pthread_cond_broadcast(&done_cond);
+  pthread_mutex_unlock(&done_lock);
+  if (!need_awake) return;
+  // The awake queue may be full: the UI thread will empty it, unless it is
+  // in wait() and delivers the continuations itself. Joins don't deliver
+  // them, so they are no reason to give up.
+  static char from_awake;
+  while (Fl::awake(deliver_done, &from_awake) < 0) {
+    pthread_mutex_lock(&done_lock);
+    int delivering = done_deliverers;
+    if (delivering) {
+      done_awake = 0;
+      pthread_cond_broadcast(&done_cond);
+    }
+    pthread_mutex_unlock(&done_lock);
+    if (delivering) return;
+    usleep(1000);
+  }
+}
+
+void Fl_Task_Pool_Data::execute(Fl_Task *task) {
+  if (task->cancelled()) task->skipped_ = 1;
+  else task->run();
+  if (task->ui_) {
+    queue_done(task);
+  } else {
+    pthread_mutex_lock(&done_lock);
+    finish_locked(task);
+    pthread_mutex_unlock(&done_lock);
+  }
+}
+
+// Takes the highest priority task: from the own queue (newest first),
+// the shared queue, or the front of another worker's queue (oldest first).
+Fl_Task *Fl_Task_Pool_Data::take(Task_Worker *self) {
+  if (!queued) return 0;
+  for (int p = POOL_PRIORITIES - 1; p >= 0; p--) {
+    Fl_Task *t = 0;
+    if (self->queue[p].count) {
+      pthread_mutex_lock(&self->lock);
+      t = self->queue[p].pop_back();
+      pthread_mutex_unlock(&self->lock);
+    }
+    if (!t && inject[p].count) {
+      pthread_mutex_lock(&lock);
+      t = inject[p].pop_front();
+      pthread_mutex_unlock(&lock);
+    }
+    if (!t) {
+      int start = (int)(self - workers) + 1;
+      for (int i = 0; i < running && !t; i++) {
+        Task_Worker *w = workers + (start + i) % running;
+        if (w == self || !w->queue[p].count) continue;
+        pthread_mutex_lock(&w->lock);
+        t = w->queue[p].pop_front();
+        pthread_mutex_unlock(&w->lock);
+      }
+    }
+    if (t) {
+      __sync_sub_and_fetch(&queued, 1);
+      return t;
+    }
+  }
+  return 0;
+}
+
+// Takes task out of the queues if no worker has started it yet.
+int Fl_Task_Pool_Data::claim(Fl_Task *task) {
+  pthread_mutex_lock(&done_lock);
+  int finished = task->finished_;
+  pthread_mutex_unlock(&done_lock);
+  if (finished) return 0;
+  int p = task->priority_, found, n;
+  pthread_mutex_lock(&lock);
+  n = running;
+  found = inject[p].remove(task);
+  pthread_mutex_unlock(&lock);
+  for (int i = 0; i < n && !found; i++) {
+    pthread_mutex_lock(&workers[i].lock);
+    found = workers[i].queue[p].remove(task);
+    pthread_mutex_unlock(&workers[i].lock);
+  }
+  if (found) __sync_sub_and_fetch(&queued, 1);
+  return found;
+}
+
+static void *worker_main(void *arg) {
+  Task_Worker *self = (Task_Worker*)arg;
+  Fl_Task_Pool_Data *d = self->pool;
+  pthread_setspecific(worker_key, self);
+  for (;;) {
+    Fl_Task *task = d->take(self);
+    if (task) {
+      d->execute(task);
+      continue;
+    }
+    pthread_mutex_lock(&d->lock);
+    if (!d->queued) {
+      if (d->stop) {
+        pthread_mutex_unlock(&d->lock);
+        break;
+      }
+      pthread_cond_wait(&d->work, &d->lock);
+    }
+    pthread_mutex_unlock(&d->lock);
+    if (d->queued) sched_yield();   // a task is being pushed by another thread
+  }
+  return 0;
+}
+
+static void start_workers(Fl_Task_Pool_Data *d) {
+  for (int i = 0; i < d->nthreads; i++) {
+    Task_Worker *w = d->workers + i;
+    if (pthread_create(&w->thread, 0, worker_main, w) != 0) break;
+    d->running++;
+  }
+}
+
+/**
+  Creates a pool with \p threads worker threads, the number of
+  processors if 0. The threads are started by the first submit().
+*/
+Fl_Task_Pool::Fl_Task_Pool(int threads) {
+  d_ = new Fl_Task_Pool_Data;
+  memset(d_, 0, sizeof(Fl_Task_Pool_Data));
+  d_->pool = this;
+  if (threads <= 0) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = ncpu < 1 ? 1 : (int)ncpu;
+  }
+  d_->nthreads = threads > POOL_MAX_THREADS ? POOL_MAX_THREADS : threads;
+  d_->workers = (Task_Worker*)calloc(d_->nthreads, sizeof(Task_Worker));
+  for (int i = 0; i < d_->nthreads; i++) {
+    pthread_mutex_init(&d_->workers[i].lock, 0);
+    d_->workers[i].pool = d_;
+  }
+  pthread_mutex_init(&d_->lock, 0);
+  pthread_cond_init(&d_->work, 0);
+}
+
+/**
+  Destroys the pool after shutdown().
+*/
+Fl_Task_Pool::~Fl_Task_Pool() {
+  shutdown();
+  for (int i = 0; i < d_->nthreads; i++) {
+    for (int p = 0; p < POOL_PRIORITIES; p++) free(d_->workers[i].queue[p].buf);
+    pthread_mutex_destroy(&d_->workers[i].lock);
+  }
+  for (int p = 0; p < POOL_PRIORITIES; p++) free(d_->inject[p].buf);
+  free(d_->workers);
+  pthread_mutex_destroy(&d_->lock);
+  pthread_cond_destroy(&d_->work);
+  delete d_;
+}
+
+/** Returns the number of worker threads. */
+int Fl_Task_Pool::threads() const {
+  return d_->nthreads;
+}
+
+/** Returns the number of submitted tasks that are not finished. */
+int Fl_Task_Pool::pending() const {
+  return d_->outstanding;
+}
+
+/**
+  Queues \p task to be run by a worker thread.
+
+  Tasks submitted by a running task are queued by its worker thread and
+  usually run by it, the others are queued in a shared queue.
+*/
+void Fl_Task_Pool::submit(Fl_Task *task) {
+  Fl_Task_Pool_Data *d = d_;
+  task->pool_ = d;
+  task->skipped_ = 0;
+  task->finished_ = 0;
+  pthread_once(&worker_key_once, make_worker_key);
+  Task_Worker *self = (Task_Worker*)pthread_getspecific(worker_key);
+  if (task->ui_ && !self) {             // initialize thread support for Fl::awake()
+    Fl::lock();
+    Fl::unlock();
+  }
+  __sync_add_and_fetch(&d->outstanding, 1);
+  pthread_mutex_lock(&d->lock);
+  if (!d->running) start_workers(d);
+  if (!d->running) {                    // no threads: run it here
+    pthread_mutex_unlock(&d->lock);
+    d->execute(task);
+    return;
+  }
+  int p = task->priority_;
+  if (self && self->pool == d) {
+    pthread_mutex_unlock(&d->lock);
+    pthread_mutex_lock(&self->lock);
+    self->queue[p].push_back(task);
+    pthread_mutex_unlock(&self->lock);
+    __sync_add_and_fetch(&d->queued, 1);
+    pthread_mutex_lock(&d->lock);
+  } else {
+    d->inject[p].push_back(task);
+    __sync_add_and_fetch(&d->queued, 1);
+  }
+  pthread_cond_signal(&d->work);
+  pthread_mutex_unlock(&d->lock);
+}
+
+/**
+  Waits until \p task is finished.
+
+  If no worker thread has started the task yet, it is run by the calling
+  thread, so that joining doesn't wait behind long tasks that occupy the
+  workers.
+
+  The task must not be deleted by the pool (see Fl_Task::auto_delete())
+  and must not have a continuation if this is called by the user
+  interface thread.
+*/
+void Fl_Task_Pool::join(Fl_Task *task) {
+  if (task->pool_ == d_ && d_->claim(task)) {
+    d_->execute(task);
+    return;
+  }
+  pthread_mutex_lock(&done_lock);
+  done_waiters++;
+  while (!task->finished_) pthread_cond_wait(&done_cond, &done_lock);
+  done_waiters--;
+  pthread_mutex_unlock(&done_lock);
+}
+
+/**
+  Waits until all submitted tasks are finished, calling the continuations
+  that are due. Call this only on the user interface thread.
+*/
+void Fl_Task_Pool::wait() {
+  for (;;) {
+    Fl_Task_Pool_Data::deliver_done(0);
+    pthread_mutex_lock(&done_lock);
+    if (!d_->outstanding) {
+      pthread_mutex_unlock(&done_lock);
+      return;
+    }
+    done_waiters++;
+    done_deliverers++;
+    if (!done_head) pthread_cond_wait(&done_cond, &done_lock);
+    done_deliverers--;
+    done_waiters--;
+    pthread_mutex_unlock(&done_lock);
+  }
+}
+
+/**
+  Drains the pool: waits until all submitted tasks are finished, like
+  wait(), then stops the worker threads. A later submit() starts them
+  again. Call this only on the user interface thread.
+*/
+void Fl_Task_Pool::shutdown() {
+  wait();
+  pthread_mutex_lock(&d_->lock);
+  d_->stop = 1;
+  pthread_cond_broadcast(&d_->work);
+  pthread_mutex_unlock(&d_->lock);
+  for (int i = 0; i < d_->running; i++)
+    pthread_join(d_->workers[i].thread, 0);
+  pthread_mutex_lock(&d_->lock);
+  d_->running = 0;
+  d_->stop = 0;
+  pthread_mutex_unlock(&d_->lock);
+}
+
+#else // !HAVE_PTHREAD
+
+struct Fl_Task_Pool_Data {
+  int outstanding;
+};
+
+Fl_Task_Pool::Fl_Task_Pool(int) {
+  d_ = new Fl_Task_Pool_Data;
+  d_->outstanding = 0;
+}
+
+Fl_Task_Pool::~Fl_Task_Pool() {
+  delete d_;
+}
+
+int Fl_Task_Pool::threads() const { return 0; }
+
+int Fl_Task_Pool::pending() const { return 0; }
+
+void Fl_Task_Pool::submit(Fl_Task *task) {
+  task->pool_ = d_;
+  task->skipped_ = 0;
+  if (task->cancelled()) task->skipped_ = 1;
+  else task->run();
+  if (task->ui_) task->done();
+  if (task->auto_delete_) delete task;
+  else task->finished_ = 1;
+}
+
+void Fl_Task_Pool::join(Fl_Task *) {}
+
+void Fl_Task_Pool::wait() {}
+
+void Fl_Task_Pool::shutdown() {}
+
+#endif // HAVE_PTHREAD
+
+static Fl_Task_Pool *shared_pool = 0;
+
+/**
+  Returns FLTK's pool, with one thread per processor.
+  It is created on the first call.
+*/
+Fl_Task_Pool *Fl_Task_Pool::shared() {
+  if (!shared_pool) shared_pool = new Fl_Task_Pool(0);
+  return shared_pool;
+}
+
+/** \cond DriverDev */
+// Called by Fl::run() before it returns
+void Fl_Task_Pool::shutdown_shared_() {
+  if (shared_pool) shared_pool->shutdown();
+}
+/** \endcond */
@@ -29,6 +29,7 @@
 #include <string.h>     // strlen
 #include <stdarg.h>     // vprintf, va_list
 #include <assert.h>
+#include <limits.h>     // INT_MAX
 
 #include "../hdr/Fl.h"
 #include "../hdr/Fl_Terminal.h"
@@ -36,6 +37,7 @@
 #include "../hdr/fl_draw.h"
 #include "../hdr/fl_string_functions.h"
 #include "Fl_String.h"
+#include "Fl_Memory.h"
 
 /////////////////////////////////
 ////// Static Class Data ////////
@@ -271,40 +273,133 @@ void Fl_Terminal::Selection::scroll(int nrows) {
 ////// EscapeSeq Class Methods ////////
 ///////////////////////////////////////
 
-// Append char to buff[] safely (with bounds checking)
-//    Returns:
-//      success - ok
-//      fail    - buffer full/overflow
+// Parser actions, see EscapeSeq::parse()
+enum {
+  VT_IGNORE = 0,      // drop the byte
+  VT_EXECUTE,         // C0 control: caller executes it
+  VT_CLEAR,           // start of a new sequence: clear private/intermediate/params
+  VT_COLLECT,         // private marker or intermediate char
+  VT_PARAM,           // digit, ';' or ':' of a parameter list
+  VT_ESC_DISPATCH,    // final char of an ESC sequence
+  VT_CSI_DISPATCH,    // final char of a CSI sequence
+  VT_END,             // end of a sequence that is ignored (OSC, DCS, invalid CSI..)
+  VT_PRINT            // printable char in ground state (caller prints these)
+};
+
+// The state/action table: (action << 4) | next_state for each state and byte
+uchar Fl_Terminal::EscapeSeq::table_[Fl_Terminal::EscapeSeq::NUM_STATES][256];
+
+static void vt_range(uchar (*table)[256], int state, int lo, int hi, int action, int next) {
+  for (int c=lo; c<=hi; c++) table[state][c] = uchar((action << 4) | next);
+}
+
+// C0 controls other than CAN, SUB and ESC (these go "anywhere")
+static void vt_c0(uchar (*table)[256], int state, int action) {
+  vt_range(table, state, 0x00, 0x17, action, state);
+  vt_range(table, state, 0x19, 0x19, action, state);
+  vt_range(table, state, 0x1c, 0x1f, action, state);
+}
+
+// Build table_[] after the state diagram of the DEC ANSI parser
+//    Bytes 0x80-0xff are UTF-8 and never part of a sequence; in ground
+//    state the caller prints them, otherwise they're ignored.
 //
-int Fl_Terminal::EscapeSeq::append_buff(char c) {
-  if (buffp_ >= buffendp_) return fail;   // end of buffer reached?
-  *buffp_++ = c;
-  *buffp_   = 0;                          // keep buff[] null terminated
-  return success;
-}
-
-// Append whatever integer string is at valbuffp into vals_[] safely w/bounds checking
-//    Assumes valbuffp points to a null terminated string.
-//    Returns:
-//       success - parsed ok
-//       fail    - error occurred (non-integer, or vals_[] full)
+void Fl_Terminal::EscapeSeq::build_table(void) {
+  typedef Fl_Terminal::EscapeSeq E;
+  uchar (*t)[256] = table_;
+  static bool built = false;
+  if (built) return;
+  built = true;
+  for (int st=0; st<E::NUM_STATES; st++) {
+    vt_range(t, st, 0x00, 0xff, VT_IGNORE, st);
+    vt_range(t, st, 0x18, 0x18, VT_EXECUTE, E::GROUND);       // CAN, SUB: cancel sequence
+    vt_range(t, st, 0x1a, 0x1a, VT_EXECUTE, E::GROUND);
+    vt_range(t, st, 0x1b, 0x1b, VT_CLEAR, E::ESCAPE);         // ESC: start over
+  }
+  // GROUND
+  vt_c0(t, E::GROUND, VT_EXECUTE);
+  vt_range(t, E::GROUND, 0x20, 0x7e, VT_PRINT, E::GROUND);
+  // ESCAPE
+  vt_c0(t, E::ESCAPE, VT_EXECUTE);
+  vt_range(t, E::ESCAPE, 0x20, 0x2f, VT_COLLECT, E::ESCAPE_INTERMEDIATE);
+  vt_range(t, E::ESCAPE, 0x30, 0x7e, VT_ESC_DISPATCH, E::GROUND);
+  vt_range(t, E::ESCAPE, 'P', 'P', VT_CLEAR, E::DCS_ENTRY);
+  vt_range(t, E::ESCAPE, 'X', 'X', VT_IGNORE, E::SOS_PM_APC_STRING);
+  vt_range(t, E::ESCAPE, '[', '[', VT_CLEAR, E::CSI_ENTRY);
+  vt_range(t, E::ESCAPE, ']', ']', VT_IGNORE, E::OSC_STRING);
+  vt_range(t, E::ESCAPE, '^', '_', VT_IGNORE, E::SOS_PM_APC_STRING);
+  // ESCAPE_INTERMEDIATE
+  vt_c0(t, E::ESCAPE_INTERMEDIATE, VT_EXECUTE);
+  vt_range(t, E::ESCAPE_INTERMEDIATE, 0x20, 0x2f, VT_COLLECT, E::ESCAPE_INTERMEDIATE);
+  vt_range(t, E::ESCAPE_INTERMEDIATE, 0x30, 0x7e, VT_ESC_DISPATCH, E::GROUND);
+  // CSI_ENTRY
+  vt_c0(t, E::CSI_ENTRY, VT_EXECUTE);
+  vt_range(t, E::CSI_ENTRY, 0x20, 0x2f, VT_COLLECT, E::CSI_INTERMEDIATE);
+  vt_range(t, E::CSI_ENTRY, 0x30, 0x3b, VT_PARAM, E::CSI_PARAM);
+  vt_range(t, E::CSI_ENTRY, 0x3c, 0x3f, VT_COLLECT, E::CSI_PARAM);
+  vt_range(t, E::CSI_ENTRY, 0x40, 0x7e, VT_CSI_DISPATCH, E::GROUND);
+  // CSI_PARAM
+  vt_c0(t, E::CSI_PARAM, VT_EXECUTE);
+  vt_range(t, E::CSI_PARAM, 0x20, 0x2f, VT_COLLECT, E::CSI_INTERMEDIATE);
+  vt_range(t, E::CSI_PARAM, 0x30, 0x3b, VT_PARAM, E::CSI_PARAM);
+  vt_range(t, E::CSI_PARAM, 0x3c, 0x3f, VT_IGNORE, E::CSI_IGNORE);
+  vt_range(t, E::CSI_PARAM, 0x40, 0x7e, VT_CSI_DISPATCH, E::GROUND);
+  // CSI_INTERMEDIATE
+  vt_c0(t, E::CSI_INTERMEDIATE, VT_EXECUTE);
+  vt_range(t, E::CSI_INTERMEDIATE, 0x20, 0x2f, VT_COLLECT, E::CSI_INTERMEDIATE);
+  vt_range(t, E::CSI_INTERMEDIATE, 0x30, 0x3f, VT_IGNORE, E::CSI_IGNORE);
+  vt_range(t, E::CSI_INTERMEDIATE, 0x40, 0x7e, VT_CSI_DISPATCH, E::GROUND);
+  // CSI_IGNORE
+  vt_c0(t, E::CSI_IGNORE, VT_EXECUTE);
+  vt_range(t, E::CSI_IGNORE, 0x40, 0x7e, VT_END, E::GROUND);
+  // DCS_ENTRY, DCS_PARAM, DCS_INTERMEDIATE: parsed, but device control
+  // strings are not supported, so the passthrough data is ignored
+  vt_range(t, E::DCS_ENTRY, 0x20, 0x2f, VT_COLLECT, E::DCS_INTERMEDIATE);
+  vt_range(t, E::DCS_ENTRY, 0x30, 0x3b, VT_PARAM, E::DCS_PARAM);
+  vt_range(t, E::DCS_ENTRY, 0x3c, 0x3f, VT_COLLECT, E::DCS_PARAM);
+  vt_range(t, E::DCS_ENTRY, 0x40, 0x7e, VT_IGNORE, E::DCS_PASSTHROUGH);
+  vt_range(t, E::DCS_PARAM, 0x20, 0x2f, VT_COLLECT, E::DCS_INTERMEDIATE);
+  vt_range(t, E::DCS_PARAM, 0x30, 0x3b, VT_PARAM, E::DCS_PARAM);
+  vt_range(t, E::DCS_PARAM, 0x3c, 0x3f, VT_IGNORE, E::DCS_IGNORE);
+  vt_range(t, E::DCS_PARAM, 0x40, 0x7e, VT_IGNORE, E::DCS_PASSTHROUGH);
+  vt_range(t, E::DCS_INTERMEDIATE, 0x20, 0x2f, VT_COLLECT, E::DCS_INTERMEDIATE);
+  vt_range(t, E::DCS_INTERMEDIATE, 0x30, 0x3f, VT_IGNORE, E::DCS_IGNORE);
+  vt_range(t, E::DCS_INTERMEDIATE, 0x40, 0x7e, VT_IGNORE, E::DCS_PASSTHROUGH);
+  // OSC_STRING: xterm also ends it with BEL; ESC \ (ST) goes thru ESCAPE
+  vt_range(t, E::OSC_STRING, 0x07, 0x07, VT_END, E::GROUND);
+  // DCS_PASSTHROUGH, DCS_IGNORE, SOS_PM_APC_STRING: all ignored until ST
+}
+
+// Clear the private marker, intermediate and parameters
+void Fl_Terminal::EscapeSeq::clear_vals(void) {
+  esc_mode_ = 0;
+  csi_      = false;
+  private_  = 0;
+  inter_    = 0;
+  vali_     = 0;
+  vals_[0]  = 0;
+  sub_[0]   = 0;
+}
+
+// Parse a parameter char: digit, ';' (next parameter) or ':' (next sub-parameter)
+//    Parameters beyond maxvals are dropped, values are limited to maxval.
 //
-int Fl_Terminal::EscapeSeq::append_val(void) {
-  if (vali_ >= maxvals)                            // vals_[] full?
-    { vali_ = maxvals-1; return fail; }            // clamp index, fail
-  if (!valbuffp_ || (*valbuffp_ == 0))             // no integer to parse? e.g. ESC[m, ESC[;m
-    { vals_[vali_] = 0; return success; }          // zero in array, do not inc vali
-  if (sscanf(valbuffp_, "%d", &vals_[vali_]) != 1) // Parse integer into vals_[]
-    { return fail; }                               // fail if parsed a non-integer
-  vals_[vali_] &= 0x3ff;                           // sanity: enforce int in range 0 ~ 1023 (prevent DoS attack)
-  if (++vali_ >= maxvals)                          // advance val index, fail if too many vals
-    { vali_ = maxvals-1; return fail; }            // clamp + fail
-  valbuffp_ = 0;                                   // parsed val ok, reset valbuffp to NULL
-  return success;
+void Fl_Terminal::EscapeSeq::param(char c) {
+  if (vali_ == 0)                                // first param char? start first value
+    { vals_[0] = 0; sub_[0] = 0; vali_ = 1; }
+  if (c == ';' || c == ':') {
+    if (vali_ < maxvals) { vals_[vali_] = 0; sub_[vali_] = (c == ':'); }
+    if (vali_ <= maxvals) ++vali_;               // maxvals+1: overflowed, drop the rest
+  } else if (vali_ <= maxvals) {
+    int &v = vals_[vali_-1];
+    v = v * 10 + (c - '0');
+    if (v > maxval) v = maxval;
+  }
 }
 
 // Ctor
 Fl_Terminal::EscapeSeq::EscapeSeq(void) {
+  build_table();
   reset();
   save_row_  = -1;  // only in ctor
   save_col_  = -1;
@@ -314,19 +409,13 @@ Fl_Terminal::EscapeSeq::EscapeSeq(void) {
 //    Named reset to not be confused with clear() screen/line/etc
 //
 void Fl_Terminal::EscapeSeq::reset(void) {
-  esc_mode_  = 0;                          // disable ESC mode, so parse_in_progress() returns false
-  csi_       = false;                      // CSI off until '[' received
-  buffp_     = buff_;                      // point to beginning of buffer
-  buffendp_  = buff_ + (maxbuff - 1);      // point to end of buffer
-  valbuffp_  = 0;                          // disable val ptr (no vals parsed yet)
-  vali_      = 0;                          // zero val index
-  buff_[0]   = 0;                          // null terminate buffer
-  vals_[0]   = 0;                          // first val[] 0
-  memset(vals_, 0, sizeof(vals_));
+  state_ = GROUND;                         // not parsing, so parse_in_progress() returns false
+  clear_vals();
 }
 
 // Return current escape mode.
-//    This is really only valid after parse() returns 'completed'.
+//    This is really only valid after parse() returns 'completed',
+//    it's the final char of the sequence, e.g. 'm' for ESC[1m.
 //    After a reset() this will return 0.
 //
 char Fl_Terminal::EscapeSeq::esc_mode(void) const { return esc_mode_; }
@@ -336,8 +425,9 @@ void Fl_Terminal::EscapeSeq::esc_mode(char val) { esc_mode_ = val; }
 
 // Return the total vals parsed.
 //    This is really only valid after parse() returns 'completed'.
+//    Empty parameters count as 0, e.g. ESC[;5H has two vals: 0 and 5.
 //
-int Fl_Terminal::EscapeSeq::total_vals(void) const { return vali_; }
+int Fl_Terminal::EscapeSeq::total_vals(void) const { return MIN(vali_, maxvals); }
 
 // Return the value at index i.
 //    i is not range checked; it's assumed 0 <= i < total_vals().
@@ -347,7 +437,7 @@ int Fl_Terminal::EscapeSeq::val(int i) const { return vals_[i]; }
 
 // See if we're in the middle of parsing an ESC sequence
 bool Fl_Terminal::EscapeSeq::parse_in_progress(void) const {
-  return (esc_mode_ == 0) ? false : true;
+  return state_ != GROUND;
 }
 
 // See if we're in the middle of parsing an ESC sequence
@@ -375,83 +465,51 @@ void Fl_Terminal::EscapeSeq::restore_cursor(int &row, int &col) {
 }
 
 // Handle parsing an escape sequence.
-//    Call this only if parse_in_progress() is true.
-//    Passing ESC does a reset() and sets esc_mode() to ESC.
+//    Call this with ESC to start a sequence, then with every byte
+//    while parse_in_progress() is true.
 //    When a full escape sequence has been parsed, 'completed' is returned (see below).
 //
 // Returns:
-//   fail      - error occurred: escape sequence invalid, class is reset()
+//   fail      - sequence ended without anything to do (ignored or invalid), class is reset
 //   success   - parsing ESC sequence OK so far, still in progress/not done yet
+//   execute   - 'c' is a C0 control char (e.g. \n) embedded in the sequence,
+//               the caller should execute it; parsing continues after it
 //   completed - complete ESC sequence was parsed, esc_mode() will be the operation, e.g.
 //                  'm' - <ESC>[1m -- is_csi() will be true, val() has value(s) parsed
-//                  'A' - <ESC>A   -- is_csi() will be false (no vals)
+//                  'D' - <ESC>D   -- is_csi() will be false (no vals)
+//               private_mode() and intermediate() return the extra chars, e.g.
+//                  '?' for <ESC>[?25h, '(' for <ESC>(B
 //
 int Fl_Terminal::EscapeSeq::parse(char c) {
-  // NOTE: During parsing esc_mode() will be:
-  //             0 - reset/not parsing
-  //          0x1b - ESC received, expecting next one of A/B/C/D or '['
-  //           '[' - actively parsing CSI sequence, e.g. ESC[
-  //
-  //       At the /end/ of parsing, after 'completed' is returned,
-  //       esc_mode() will be the mode setting char, e.g. 'm' for 'ESC[0m', etc.
-  //
-  if (c == 0) {                             // NULL? (caller should really never send us this)
-    return success;                         // do nothing -- leave state unchanged, return 'success'
-  } else if (c == 0x1b) {                   // ESC at ANY time resets class/begins new ESC sequence
-    reset();
-    esc_mode(0x1b);
-    if (append_buff(c) < 0) goto pfail;     // save ESC in buf
-    return success;
-  } else if (c < ' ' || c >= 0x7f) {        // any other control or binary characters?
-    goto pfail;                             // reset + fail out of esc sequence parsing
-  }
-  // Whatever the character is, handle it depending on esc_mode..
-  if (esc_mode() == 0x1b) {                 // in ESC mode?
-    if (c == '[') {                         // <ESC>[? CSI (Ctrl Seq Introducer)
-      esc_mode(c);                          // switch to parsing mode for ESC[#;#;#..
-      csi_      = true;                     // this is now a CSI sequence
-      vali_     = 0;                        // zero vals_[] index
-      valbuffp_ = 0;                        // valbuffp NULL (no vals yet)
-      if (append_buff(c) < 0) goto pfail;   // save '[' in buf
-      return success;                       // success
-    } else if ((c >= '@' && c <= 'Z') ||    // C1 control code (e.g. <ESC>D, <ESC>c, etc)
-               (c >= 'a' && c <= 'z')) {
-      esc_mode(c);                          // save op in esc_mode() for caller to see
-      csi_      = false;                    // NOT a CSI sequence
-      vali_     = 0;
-      valbuffp_ = 0;                        // valbuffp NULL (no vals yet)
-      if (append_buff(c) < 0) goto pfail;   // save op in buf
-      return completed;                     // completed sequence
-    } else {                                // ESCx?
-      goto pfail;                           // not supported
-    }
-  } else if (esc_mode() == '[') {           // '[' mode? e.g. ESC[... aka. is_csi()
-    if (c == ';') {                         // ';' indicates end of a value, e.g. ESC[0;2..
-      if (append_val()   < 0) goto pfail;   // append value parsed so far, vali gets inc'ed
-      if (append_buff(c) < 0) goto pfail;   // save ';' in buf
+  uchar t = table_[state_][(uchar)c];
+  state_ = t & 0x0f;
+  switch (t >> 4) {
+    case VT_IGNORE:
       return success;
-    }
-    if (isdigit(c)) {                       // parsing an integer?
-      if (!valbuffp_)                       // valbuffp not set yet?
-        { valbuffp_ = buffp_; }             // point to first char in integer string
-      if (append_buff(c) < 0) goto pfail;   // add value to buffer
+    case VT_EXECUTE:
+      return execute;
+    case VT_CLEAR:
+      clear_vals();
       return success;
-    }
-    // Not a ; or digit? fall thru to [A-Z,a-z] check
-  } else {                                  // all other esc_mode() chars are fail/unknown
-    goto pfail;
-  }
-  if (( c >= '@' && c<= 'Z') ||             // ESC#X or ESC[...X, where X is [A-Z,a-z]?
-      ( c >= 'a' && c<= 'z')) {
-    if (append_val() < 0 ) goto pfail;      // append any trailing vals just before letter
-    if (append_buff(c) < 0 ) goto pfail;    // save letter in buffer
-    esc_mode(c);                            // change mode to the mode setting char
-    return completed;                       // completed/done
+    case VT_COLLECT:
+      if (c >= 0x3c && c <= 0x3f) { if (!private_) private_ = c; }   // private marker
+      else if (!inter_) inter_ = c;                                  // intermediate
+      return success;
+    case VT_PARAM:
+      param(c);
+      return success;
+    case VT_ESC_DISPATCH:
+      esc_mode_ = c;
+      csi_      = false;
+      return completed;
+    case VT_CSI_DISPATCH:
+      esc_mode_ = c;
+      csi_      = true;
+      return completed;
+    default:                                  // VT_END, VT_PRINT
+      reset();
+      return fail;
   }
-  // Any other chars? reset+fail
-pfail:
-  reset();
-  return fail;
 }
 
 //////////////////////////////////////
@@ -732,46 +790,123 @@ void Fl_Terminal::RingBuffer::offset_adjust(int rows) {
 //                                     |_____________|  _v_
 //
 void Fl_Terminal::RingBuffer::new_copy(int drows, int dcols, int hrows, const CharStyle& style) {
-  (void)style;                                              // currently unused - need parameterized ctor (†)
-  // Create new buffer
+  (void)style;                                              // currently unused
+  // Create new row array
   int addhist       = disp_rows() - drows;                  // adjust history use
   int new_ring_rows = (drows+hrows);
   int new_hist_use  = clamp(hist_use_ + addhist, 0, hrows); // clamp incase new_hist_rows smaller than old
-  int new_nchars    = (new_ring_rows * dcols);
-  Utf8Char *new_ring_chars = new Utf8Char[new_nchars];      // Create new ring buffer (†)
-  // Preserve old contents in new buffer
-  int dst_cols      = dcols;
+  Row *new_rows     = new Row[new_ring_rows];
+  memset((void*)new_rows, 0, new_ring_rows * sizeof(Row));  // rows are allocated when first used
+  // Preserve old contents in new buffer: rows are moved, not copied
   int src_stop_row  = hist_use_srow();
-  int tcols         = MIN(ring_cols(), dcols);
   int src_row       = hist_use_srow() + hist_use_ + disp_rows_ - 1; // use row#s relative to hist_use_srow()
   int dst_row       = new_ring_rows - 1;
-  // Copy rows: working up from bottom of disp, stop at top of hist
+  // Move rows: working up from bottom of disp, stop at top of hist
   while ((src_row >= src_stop_row) && (dst_row >= 0)) {
-    Utf8Char *src = u8c_ring_row(src_row);
-    Utf8Char *dst = new_ring_chars + (dst_row*dst_cols);
-    for (int col=0; col<tcols; col++ ) *dst++ = *src++;
+    Row &src = rows_[normalize(src_row, ring_rows_)];
+    new_rows[dst_row] = src;
+    src.chars = 0;
+    src.cols = src.alloc = 0;
     --src_row;
     --dst_row;
   }
-  // Install new buffer: dump old, install new, adjust internals
-  if (ring_chars_) delete[] ring_chars_;
-  ring_chars_ = new_ring_chars;
+  // Install new rows: dump old, install new, adjust internals
+  for (int row=0; row<ring_rows_; row++) free_row(rows_[row]);
+  if (rows_) delete[] rows_;
+  fl_memory_account(FL_MEMORY_TERMINAL, (long)(new_ring_rows - ring_rows_) * (long)sizeof(Row));
+  rows_       = new_rows;
   ring_rows_  = new_ring_rows;
-  ring_cols_  = dcols;
-  nchars_     = new_nchars;
+  if (dcols != ring_cols_) change_cols(dcols);
   hist_rows_  = hrows;
   hist_use_   = new_hist_use;
   disp_rows_  = drows;
   offset_     = 0;        // for new buffer, we used a zero offset
 }
 
+// Free the storage of a row
+void Fl_Terminal::RingBuffer::free_row(Row &r) {
+  if (r.chars) {
+    delete[] r.chars;
+    fl_memory_account(FL_MEMORY_TERMINAL, -(long)r.alloc * (long)sizeof(Utf8Char));
+  }
+  r.chars = 0;
+  r.cols = r.alloc = 0;
+}
+
+// Change the number of columns without touching the rows.
+//    The change is logged so that rows fitted later lose the columns
+//    that an immediate fit would have dropped.
+//
+void Fl_Terminal::RingBuffer::change_cols(int dcols) {
+  ++cols_gen_;
+  // a narrower change hides all wider ones before it
+  while (cols_log_size_ > 0 && cols_log_[cols_log_size_-1].cols >= dcols) --cols_log_size_;
+  if (cols_log_size_ == cols_log_alloc_) {
+    cols_log_alloc_ = cols_log_alloc_ ? cols_log_alloc_ * 2 : 16;
+    cols_log_ = (ColsChange*)realloc((void*)cols_log_, cols_log_alloc_ * sizeof(ColsChange));
+  }
+  cols_log_[cols_log_size_].gen  = cols_gen_;
+  cols_log_[cols_log_size_].cols = dcols;
+  ++cols_log_size_;
+  ring_cols_ = dcols;
+}
+
+// Return the smallest #columns the ring had after generation 'gen',
+// or INT_MAX if the columns were not changed since.
+//    The log is sorted by gen and by cols, so this is the first entry after 'gen'.
+//
+int Fl_Terminal::RingBuffer::min_cols_since(int gen) const {
+  int lo = 0, hi = cols_log_size_;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (cols_log_[mid].gen > gen) hi = mid; else lo = mid + 1;
+  }
+  return (lo < cols_log_size_) ? cols_log_[lo].cols : INT_MAX;
+}
+
+// Return the chars of ring row 'row', fitting the row to the current
+// number of columns first: it's allocated or enlarged as needed, columns
+// that were dropped by a narrower size since the last fit are blanked.
+// The result is the same as if every row was fitted on every resize.
+//
+//    Rows are only fitted when used, which keeps create() and resize()
+//    independent of the history size.
+//
+Fl_Terminal::Utf8Char* Fl_Terminal::RingBuffer::row_chars(int row) const {
+  Row &r = rows_[row];
+  if (r.gen != cols_gen_) {
+    r.cols = MIN(r.cols, min_cols_since(r.gen));
+    r.gen  = cols_gen_;
+  }
+  if (r.cols != ring_cols_) {
+    if (r.alloc < ring_cols_) {                   // enlarge? copy into new storage
+      Utf8Char *chars = new Utf8Char[ring_cols_];
+      for (int col=0; col<r.cols; col++) chars[col] = r.chars[col];
+      if (r.chars) delete[] r.chars;
+      fl_memory_account(FL_MEMORY_TERMINAL, (long)(ring_cols_ - r.alloc) * (long)sizeof(Utf8Char));
+      r.chars = chars;
+      r.alloc = ring_cols_;
+    } else {                                      // fits? blank new columns, if any
+      static const Utf8Char blank;
+      for (int col=r.cols; col<ring_cols_; col++) r.chars[col] = blank;
+    }
+    r.cols = ring_cols_;
+  }
+  return r.chars;
+}
+
 // Clear the class, delete previous ring if any
 void Fl_Terminal::RingBuffer::clear(void) {
-  if (ring_chars_) delete[] ring_chars_; // dump our ring
-  ring_chars_ = 0;
+  if (rows_) {                            // dump our ring
+    for (int row=0; row<ring_rows_; row++) free_row(rows_[row]);
+    delete[] rows_;
+    fl_memory_account(FL_MEMORY_TERMINAL, -(long)ring_rows_ * (long)sizeof(Row));
+  }
+  rows_       = 0;
+  cols_gen_   = 0;
+  cols_log_size_ = 0;
   ring_rows_  = 0;
   ring_cols_  = 0;
-  nchars_     = 0;
   hist_rows_  = 0;
   hist_use_   = 0;
   disp_rows_  = 0;
@@ -785,14 +920,18 @@ void Fl_Terminal::RingBuffer::clear_hist(void) {
 
 // Default ctor
 Fl_Terminal::RingBuffer::RingBuffer(void) {
-  ring_chars_ = 0;
+  rows_ = 0;
+  cols_log_ = 0;
+  cols_log_alloc_ = 0;
   clear();
 }
 
 // Ctor with specific sizes
 Fl_Terminal::RingBuffer::RingBuffer(int drows, int dcols, int hrows) {
   // Start with cleared buffer first..
-  ring_chars_ = 0;
+  rows_ = 0;
+  cols_log_ = 0;
+  cols_log_alloc_ = 0;
   clear();
   // ..then create.
   create(drows, dcols, hrows);
@@ -800,8 +939,8 @@ Fl_Terminal::RingBuffer::RingBuffer(int drows, int dcols, int hrows) {
 
 // Dtor
 Fl_Terminal::RingBuffer::~RingBuffer(void) {
-  if (ring_chars_) delete[] ring_chars_;
-  ring_chars_ = NULL;
+  clear();
+  free((void*)cols_log_);
 }
 
 // See if 'grow' is within the history buffer
@@ -924,7 +1063,7 @@ void Fl_Terminal::RingBuffer::scroll(int rows, const CharStyle& style) {
 const Fl_Terminal::Utf8Char* Fl_Terminal::RingBuffer::u8c_ring_row(int row) const {
   row = normalize(row, ring_rows());
   assert(row >= 0 && row < ring_rows_);
-  return &ring_chars_[row * ring_cols()];
+  return row_chars(row);
 }
 
 // Return UTF-8 char for beginning of 'row' in the history buffer.
@@ -939,7 +1078,7 @@ const Fl_Terminal::Utf8Char* Fl_Terminal::RingBuffer::u8c_hist_row(int hrow) con
   int rowi = normalize(hrow, hist_rows());
   rowi = (rowi + offset_) % ring_rows_;
   assert(rowi >= 0 && rowi <= ring_rows_);
-  return &ring_chars_[rowi * ring_cols()];
+  return row_chars(rowi);
 }
 
 // Special case to walk the "in use" rows of the history
@@ -954,9 +1093,9 @@ const Fl_Terminal::Utf8Char* Fl_Terminal::RingBuffer::u8c_hist_use_row(int hurow
   if (hist_use_ == 0) return 0;             // history is empty! (caller is dumb to ask)
   hurow = hurow % hist_use_;                // normalize indexing within history in use
   hurow = hist_rows_ - hist_use_ + hurow;   // index hist_use rows from end history
-  hurow = (hurow + offset_) % ring_rows_;   // convert to absolute index in ring_chars_[]
+  hurow = (hurow + offset_) % ring_rows_;   // convert to absolute index in rows_[]
   assert(hurow >= 0 && hurow <= hist_use());
-  return &ring_chars_[hurow * ring_cols()];
+  return row_chars(hurow);
 }
 
 // Return UTF-8 char for beginning of 'row' in the display buffer
@@ -971,7 +1110,7 @@ const Fl_Terminal::Utf8Char* Fl_Terminal::RingBuffer::u8c_disp_row(int drow) con
   int rowi = normalize(drow, disp_rows());
   rowi = (hist_rows_ + rowi + offset_) % ring_rows_; // display starts at end of history
   assert(rowi >= 0 && rowi <= ring_rows_);
-  return &ring_chars_[rowi * ring_cols()];
+  return row_chars(rowi);
 }
 
 // non-const versions of the above ////////////////////////////////////////////////
@@ -1017,11 +1156,12 @@ void Fl_Terminal::RingBuffer::create(int drows, int dcols, int hrows) {
   hist_use_   = 0;
   // Display
   disp_rows_  = drows;
-  // Ring buffer
+  // Ring buffer: rows are allocated when first used
   ring_rows_  = hist_rows_ + disp_rows_;
   ring_cols_  = dcols;
-  nchars_     = ring_rows_ * ring_cols_;
-  ring_chars_ = new Utf8Char[nchars_];
+  rows_       = new Row[ring_rows_];
+  memset((void*)rows_, 0, ring_rows_ * sizeof(Row));
+  fl_memory_account(FL_MEMORY_TERMINAL, (long)ring_rows_ * (long)sizeof(Row));
 }
 
 // Resize the buffer, preserve previous contents as much as possible
@@ -1030,10 +1170,17 @@ void Fl_Terminal::RingBuffer::resize(int drows, int dcols, int hrows, const Char
   int  old_rows     = disp_rows() + hist_rows();  // new display + history rows
   bool cols_changed = (dcols != disp_cols());     // was there a change in total #columns?
   bool rows_changed = (new_rows != old_rows);     // was there a change in total #rows?
-  // If rows or cols changed, make a NEW buffer and copy old contents.
-  // New copy will have disp/hist_rows/cols and nchars adjusted.
-  if (cols_changed || rows_changed) {             // rows or cols changed?
+  // If rows changed, make a NEW row array and move old rows into it.
+  // New copy will have disp/hist_rows/cols adjusted.
+  // If only cols changed, rows are fitted to the new width when next used.
+  if (rows_changed) {                             // rows changed?
     new_copy(drows, dcols, hrows, style);         // rebuild ring buffer, preserving contents
+  } else if (cols_changed) {                      // cols changed?
+    change_cols(dcols);
+    int addhist = disp_rows() - drows;
+    hist_rows_  = hrows;
+    disp_rows_  = drows;
+    hist_use_   = clamp(hist_use_ + addhist, 0, hrows);
   } else {
     // Cols and total rows the same, probably just changed disp/hist ratio
     int addhist = disp_rows() - drows;            // adj hist_use smaller if disp enlarged
@@ -2616,6 +2763,68 @@ bool Fl_Terminal::is_ctrl(char c) {
   return ((c >= 0x00) && (c < 0x20)) ? true : false;
 }
 
+// Return the RGB values of entry 'ci' (8..255) of the xterm 256 color palette
+//    8..15 are the bright colors, 16..231 a 6x6x6 color cube, 232..255 grays.
+//    0..7 are not handled here, they're the regular xterm colors.
+//
+static void xterm256_rgb(int ci, int &r, int &g, int &b) {
+  static const uchar bright[8][3] = {
+    {0x80,0x80,0x80}, {0xff,0x00,0x00}, {0x00,0xff,0x00}, {0xff,0xff,0x00},
+    {0x5c,0x5c,0xff}, {0xff,0x00,0xff}, {0x00,0xff,0xff}, {0xff,0xff,0xff}
+  };
+  static const uchar level[6] = { 0, 95, 135, 175, 215, 255 };
+  if (ci < 16)       { r = bright[ci-8][0]; g = bright[ci-8][1]; b = bright[ci-8][2]; }
+  else if (ci < 232) { ci -= 16; r = level[ci/36]; g = level[(ci/6)%6]; b = level[ci%6]; }
+  else               { r = g = b = 8 + (ci - 232) * 10; }
+}
+
+// Set fg (or bg) color to entry 'ci' of the xterm 256 color palette
+void Fl_Terminal::CharStyle::color_xterm256(bool fg, int ci) {
+  ci = clamp(ci, 0, 255);
+  if (ci < 8) {                                        // regular xterm color
+    if (fg) fgcolor_xterm(uchar(ci));
+    else    bgcolor_xterm(uchar(ci));
+    return;
+  }
+  int r, g, b;
+  xterm256_rgb(ci, r, g, b);
+  if (fg) fgcolor(r, g, b);
+  else    bgcolor(r, g, b);
+}
+
+// Handle the extended color of ESC[38..m or ESC[48..m at val index 'i'.
+//    Handles these forms (48 for bg is the same):
+//        ESC[38;5;<n>m           ESC[38:5:<n>m           - xterm 256 color palette
+//        ESC[38;2;<r>;<g>;<b>m   ESC[38:2::<r>:<g>:<b>m  - RGB color
+//                                ESC[38:2:<r>:<g>:<b>m
+//    Returns the index of the last val used; on error, the last val of the
+//    sequence (the rest of the semicolon form can't be interpreted).
+//
+int Fl_Terminal::handle_SGR_color(int i) {
+  EscapeSeq &esc = escseq;
+  int  tot   = esc.total_vals();
+  bool fg    = (esc.val(i) == 38);
+  int  first = i + 1;                    // first val after the 38/48
+  int  n     = 0;                        // #vals that belong to the color
+  while (first+n < tot && esc.is_sub(first+n)) n++;
+  bool colon = (n > 0);                  // colon (sub-parameter) form?
+  if (!colon) n = tot - first;           // semicolon form: rest of vals
+  int mode = n ? esc.val(first) : 0;
+  if (mode == 5 && n >= 2) {                           // palette index
+    current_style_->color_xterm256(fg, esc.val(first+1));
+    return colon ? first+n-1 : first+1;
+  }
+  if (mode == 2 && n >= 4) {                           // RGB
+    int o = (colon && n >= 5) ? first+2 : first+1;     // skip colon form's color space id
+    int r = clamp(esc.val(o),0,255), g = clamp(esc.val(o+1),0,255), b = clamp(esc.val(o+2),0,255);
+    if (fg) current_style_->fgcolor(r,g,b);
+    else    current_style_->bgcolor(r,g,b);
+    return colon ? first+n-1 : o+2;
+  }
+  handle_unknown_char();
+  return colon ? first+n-1 : tot-1;
+}
+
 // Handle ESC[m sequences.
 //    This is different from the others in that the list of vals
 //    separated by ;'s can be long, to allow combining multiple mode
@@ -2625,41 +2834,16 @@ void Fl_Terminal::handle_SGR(void) {     // ESC[...m?
   // Shortcut varnames..
   EscapeSeq &esc = escseq;
   int tot = esc.total_vals();
-  // Handle ESC[m or ESC[;m
+  // Handle ESC[m
   if (tot == 0)
     { current_style_->sgr_reset(); return; }
   // Handle ESC[#;#;#...m
-  int rgbcode = 0;                   // 0=none, 38=fg, 48=bg
-  int rgbmode = 0;                   // 0=none, 1="2", 2=<r>, 3=<g>, 4=<b>
-  int r=0,g=0,b=0;
   for (int i=0; i<tot; i++) {        // expect possibly many values
     int val = esc.val(i);            // each val one at a time
-    switch (rgbmode) {
-      case 0:
-         // RGB mode values?
-         switch (val) {
-           case 38:                  // fg RGB mode? e.g. ESC[38;2;<R>;<G>;<B>m
-           case 48:                  // bg RGB mode? e.g. ESC[48;2;<R>;<G>;<B>m
-             rgbmode = 1;
-             rgbcode = val;
-             continue;
-         }
-         break;
-      case 1: if (val == 2) { rgbmode++; continue; }    // '2'?
-              rgbcode = rgbmode = 0;                    // not '2'? cancel
-              handle_unknown_char();
-              break;
-      case 2: r=clamp(val,0,255); ++rgbmode; continue;  // parse red value
-      case 3: g=clamp(val,0,255); ++rgbmode; continue;  // parse grn value
-      case 4: b=clamp(val,0,255);                       // parse blu value
-        switch (rgbcode) {
-          case 38: current_style_->fgcolor(r,g,b);      // Set fg rgb
-                   break;
-          case 48: current_style_->bgcolor(r,g,b);      // Set bg rgb
-                   break;
-        }
-        rgbcode = rgbmode = 0;                          // done w/rgb mode parsing
-        continue;                                       // continue loop to parse more vals
+    if (esc.is_sub(i)) continue;     // unknown sub-parameter? skip
+    if (val == 38 || val == 48) {    // extended fg/bg color? e.g. ESC[38;5;<n>m
+      i = handle_SGR_color(i);
+      continue;
     }
     if (val < 10) {                                     // Set attribute? (bold,underline..)
       switch (val) {
@@ -2699,6 +2883,10 @@ void Fl_Terminal::handle_SGR(void) {     // ESC[...m?
     } else if (val == 49) {                              // ESC[49m -- "normal" bg color:
       Fl_Color bg = current_style_->defaultbgcolor();    // ..get default bg color
       current_style_->bgcolor_xterm(bg);                 // ..set current bg color
+    } else if (val >= 90 && val <= 97) {                 // Set bright fg color? (aixterm)
+      current_style_->color_xterm256(true, val - 90 + 8);
+    } else if (val >= 100 && val <= 107) {               // Set bright bg color? (aixterm)
+      current_style_->color_xterm256(false, val - 100 + 8);
     } else {
       handle_unknown_char();  // does an escseq.reset()  // unimplemented SGR codes
     }
@@ -2736,11 +2924,23 @@ void Fl_Terminal::handle_escseq(char c) {
   switch (escseq.parse(c)) {                           // parse char, advance s..
     case EscapeSeq::fail: escseq.reset(); return;      // failed? reset, done
     case EscapeSeq::success:              return;      // keep parsing..
+    case EscapeSeq::execute: handle_ctrl(c); return;   // ctrl char inside sequence? execute it
     case EscapeSeq::completed:            break;       // parsed complete esc sequence?
   }
   // Shortcut varnames for escseq parsing..
   EscapeSeq &esc = escseq;
   char mode     = esc.esc_mode();
+  // Sequences with a private marker or intermediate char, e.g. <ESC>[?25h, <ESC>(B
+  if (esc.private_mode() || esc.intermediate()) {
+    if (esc.is_csi() && mode == 't' && esc.intermediate() == '$')
+      handle_DECRARA();                          // <ESC>[#..$t -- (DECRARA)
+    else if (!esc.is_csi() && esc.intermediate() && strchr("()*+", esc.intermediate()))
+      { }                                        // <ESC>(B etc. -- designate G0..G3 charset: always UTF-8
+    else
+      handle_unknown_char();                     // does an escseq.reset()
+    esc.reset();
+    return;
+  }
   int  tot      = esc.total_vals();
   int  val0     = (tot==0) ? 0 : esc.val(0);
   int  val1     = (tot<2)  ? 0 : esc.val(1);
@@ -2901,6 +3101,7 @@ cup:
       case 'M': cursor_up(1, true);        break;// <ESC>M - (RI) Reverse Index (up w/scroll)
       case '7': handle_unknown_char();     break;// <ESC>7 - Save cursor & attrs    // TODO
       case '8': handle_unknown_char();     break;// <ESC>8 - Restore cursor & attrs // TODO
+      case '\\':                          break;// <ESC>\\ - (ST) String Terminator of OSC/DCS
       default:
         handle_unknown_char();                   // does an escseq.reset()
         break;
@@ -3135,9 +3336,36 @@ void Fl_Terminal::append_utf8(const char *buf, int len/*=-1*/) {
   }
 
   // For sure buf is now pointing at a valid char, so walk to end of buffer
+  const bool do_scroll = true;
   int clen;                                 // char length
   const char *p = buf;                      // ptr to walk buffer
   while (len>0) {
+    uchar c = uchar(*p);
+    if (escseq.parse_in_progress()) {       // ESC sequence in progress? parse byte
+      handle_escseq(*p);
+      p++; len--; mod |= 1;
+      continue;
+    }
+    if (c >= 0x20 && c < 0x7f) {            // printable ASCII? plot the whole run
+      int n = 1;
+      while (n < len && uchar(p[n]) >= 0x20 && uchar(p[n]) < 0x7f) n++;
+      p += n; len -= n; mod |= 1;
+      for (const char *s = p - n; n > 0; ) {
+        int col  = cursor_col();
+        int room = MIN(disp_cols() - col, n); // chars that fit on this row
+        if (room < 1) { cursor_right(1, do_scroll); continue; }
+        Utf8Char *u8c = u8c_disp_row(cursor_row()) + col;
+        for (int i=0; i<room; i++) (u8c++)->text_utf8(s++, 1, *current_style_);
+        n -= room;
+        cursor_right(room, do_scroll);       // wraps/scrolls only on the last char
+      }
+      continue;
+    }
+    if (c < 0x20 || c == 0x7f) {            // ctrl char or DEL?
+      if (c < 0x20) handle_ctrl(*p);
+      p++; len--; mod |= 1;
+      continue;
+    }
     clen = fl_utf8len(*p);                  // how many bytes long is this char?
     if (clen == -1) {                       // not expecting bad UTF-8 here
       mod |= handle_unknown_char();
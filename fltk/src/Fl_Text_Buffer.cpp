@@ -19,11 +19,19 @@
 #include "../hdr/fl_utf8.h"
 #include "../hdr/fl_string_functions.h"
 #include "flstring.h"
+#include "Fl_Memory.h"
 #include <ctype.h>
 #include "../hdr/Fl.h"
 #include "../hdr/Fl_Text_Buffer.h"
+#include "../hdr/Fl_Task_Pool.h"
 #include "../hdr/fl_ask.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
 
 /*
  This file is based on a port of NEdit to FLTK many years ago. NEdit at that
@@ -96,6 +104,7 @@ public:
   ~Fl_Text_Undo_Action() {
     if (undobuffer)
       ::free(undobuffer);
+    fl_memory_account(FL_MEMORY_TEXT_UNDO, -undobufferlength);
   }
 
   char *undobuffer;
@@ -111,6 +120,7 @@ public:
   void undobuffersize(int n)
   {
     if (n > undobufferlength) {
+      fl_memory_account(FL_MEMORY_TEXT_UNDO, n + 128 - undobufferlength);
       undobufferlength = n + 128;
       undobuffer = (char *)realloc(undobuffer, undobufferlength);
     }
@@ -196,6 +206,40 @@ public:
 };
 
 
+/*
+ The text is stored in a block with a reference count, so that snapshots can
+ share it with the buffer. safe_start and safe_end hold the part of the
+ storage that no snapshot sees: the intersection of the gaps of all
+ snapshots. The buffer can write there while the block is shared, anything
+ else must be copied first.
+ */
+struct Fl_Text_Block {
+  int refcount;
+  int safe_start, safe_end;
+  int pad_;
+};
+
+static char *alloc_block(int size) {
+  Fl_Text_Block *b = (Fl_Text_Block *) malloc(sizeof(Fl_Text_Block) + size);
+  b->refcount = 1;
+  b->safe_start = b->safe_end = 0;
+  return (char *)(b + 1);
+}
+
+static Fl_Text_Block *block_of(char *buf) {
+  return (Fl_Text_Block *) buf - 1;
+}
+
+static void retain_block(char *buf) {
+  __sync_add_and_fetch(&block_of(buf)->refcount, 1);
+}
+
+static void release_block(char *buf) {
+  if (__sync_sub_and_fetch(&block_of(buf)->refcount, 1) == 0)
+    free(block_of(buf));
+}
+
+
 static void def_transcoding_warning_action(Fl_Text_Buffer *text)
 {
   fl_alert("%s", text->file_encoding_warning_message);
@@ -208,7 +252,9 @@ Fl_Text_Buffer::Fl_Text_Buffer(int requestedSize, int preferredGapSize)
 {
   mLength = 0;
   mPreferredGapSize = preferredGapSize;
-  mBuf = (char *) malloc(requestedSize + mPreferredGapSize);
+  mBuf = alloc_block(requestedSize + mPreferredGapSize);
+  mVersion = 0;
+  fl_memory_account(FL_MEMORY_TEXT_BUFFER, requestedSize + mPreferredGapSize);
   mGapStart = 0;
   mGapEnd = requestedSize + mPreferredGapSize;
   mTabDist = 8;
@@ -239,7 +285,8 @@ Fl_Text_Buffer::Fl_Text_Buffer(int requestedSize, int preferredGapSize)
  */
 Fl_Text_Buffer::~Fl_Text_Buffer()
 {
-  free(mBuf);
+  release_block(mBuf);
+  fl_memory_account(FL_MEMORY_TEXT_BUFFER, -(mLength + mGapEnd - mGapStart));
   if (mNModifyProcs != 0) {
     delete[]mModifyProcs;
     delete[]mCbArgs;
@@ -283,11 +330,14 @@ void Fl_Text_Buffer::text(const char *t)
   /* Save information for redisplay, and get rid of the old buffer */
   const char *deletedText = text();
   int deletedLength = mLength;
-  free((void *) mBuf);
+  release_block(mBuf);
+  fl_memory_account(FL_MEMORY_TEXT_BUFFER, -(mLength + mGapEnd - mGapStart));
 
   /* Start a new buffer with a gap of mPreferredGapSize at the end */
   int insertedLength = (int) strlen(t);
-  mBuf = (char *) malloc(insertedLength + mPreferredGapSize);
+  mBuf = alloc_block(insertedLength + mPreferredGapSize);
+  mVersion++;
+  fl_memory_account(FL_MEMORY_TEXT_BUFFER, insertedLength + mPreferredGapSize);
   mLength = insertedLength;
   mGapStart = insertedLength;
   mGapEnd = mGapStart + mPreferredGapSize;
@@ -376,6 +426,178 @@ char Fl_Text_Buffer::byte_at(int pos) const {
 }
 
 
+/**
+ \brief Returns an immutable view of the current text.
+
+ Taking a snapshot does not copy the text, the buffer and the snapshot share
+ the storage until the buffer needs to change a part of it that the snapshot
+ sees. The snapshot can then be read from any thread.
+
+ \code
+   Fl_Text_Snapshot *snap = buffer->snapshot();
+   // ... hand snap to a worker thread, which calls snap->release() when done
+ \endcode
+
+ \return a new snapshot with one reference, drop it with Fl_Text_Snapshot::release()
+ \see Fl_Text_Snapshot, version()
+ */
+Fl_Text_Snapshot *Fl_Text_Buffer::snapshot() const {
+  Fl_Text_Block *b = block_of(mBuf);
+  if (b->refcount == 1) {
+    b->safe_start = mGapStart;
+    b->safe_end = mGapEnd;
+  } else {
+    if (b->safe_start < mGapStart) b->safe_start = mGapStart;
+    if (b->safe_end > mGapEnd) b->safe_end = mGapEnd;
+  }
+  retain_block(mBuf);
+  Fl_Text_Snapshot *snap = new Fl_Text_Snapshot;
+  snap->mBuf = mBuf;
+  snap->mLength = mLength;
+  snap->mGapStart = mGapStart;
+  snap->mGapEnd = mGapEnd;
+  snap->mVersion = mVersion;
+  snap->mRefCount = 1;
+  return snap;
+}
+
+
+/*
+ Check whether a range of the storage is seen by a snapshot.
+ Snapshots drop their reference from other threads, a stale count only
+ makes us copy once too often.
+ */
+int Fl_Text_Buffer::shared_(int start, int end) const {
+  if (start >= end) return 0;
+  Fl_Text_Block *b = block_of(mBuf);
+  if (b->refcount == 1) return 0;
+  return start < b->safe_start || end > b->safe_end;
+}
+
+
+Fl_Text_Snapshot::~Fl_Text_Snapshot() {
+  release_block(mBuf);
+}
+
+
+void Fl_Text_Snapshot::retain() {
+  __sync_add_and_fetch(&mRefCount, 1);
+}
+
+
+void Fl_Text_Snapshot::release() {
+  if (__sync_sub_and_fetch(&mRefCount, 1) == 0)
+    delete this;
+}
+
+
+/**
+ Returns the raw byte at position \p pos, or 0 if \p pos is out of range.
+ */
+char Fl_Text_Snapshot::byte_at(int pos) const {
+  if (pos < 0 || pos >= mLength)
+    return '\0';
+  return *address(pos);
+}
+
+
+/**
+ Returns the UCS-4 character at position \p pos, or 0 if \p pos is out of range.
+ \p pos must be at a UTF-8 character boundary.
+ */
+unsigned int Fl_Text_Snapshot::char_at(int pos) const {
+  if (pos < 0 || pos >= mLength)
+    return '\0';
+  const char *src = address(pos);
+  // a character is never split by the gap
+  return fl_utf8decode(src, src + fl_utf8len1(*src), 0);
+}
+
+
+/**
+ Returns the position of the first character of the line containing \p pos.
+ */
+int Fl_Text_Snapshot::line_start(int pos) const {
+  if (pos > mLength) pos = mLength;
+  while (pos > 0 && *address(pos - 1) != '\n')
+    pos--;
+  return pos < 0 ? 0 : pos;
+}
+
+
+/**
+ Returns the position of the newline ending the line containing \p pos,
+ or length() if it is the last line.
+ */
+int Fl_Text_Snapshot::line_end(int pos) const {
+  if (pos < 0) pos = 0;
+  const char *p1, *p2;
+  int n1, n2;
+  if (!range(pos, mLength, &p1, &n1, &p2, &n2))
+    return mLength;
+  const char *nl = (const char *) memchr(p1, '\n', n1);
+  if (nl) return pos + int(nl - p1);
+  nl = n2 ? (const char *) memchr(p2, '\n', n2) : 0;
+  if (nl) return pos + n1 + int(nl - p2);
+  return mLength;
+}
+
+
+/**
+ \brief Gives access to a range of the text without copying it.
+
+ The text from \p start to \p end is returned in at most two contiguous
+ pieces, because the snapshot shares the gap buffer of Fl_Text_Buffer.
+ The pointers are valid until the snapshot is released and are not
+ nul-terminated.
+
+ \code
+   const char *p1, *p2; int n1, n2;
+   snap->range(0, snap->length(), &p1, &n1, &p2, &n2);
+   fwrite(p1, 1, n1, f); fwrite(p2, 1, n2, f);
+ \endcode
+
+ \param[in] start, end  byte range, clipped to the text
+ \param[out] p1, n1     first piece
+ \param[out] p2, n2     second piece, \p n2 is 0 if there is none
+ \return the number of bytes in the range
+ */
+int Fl_Text_Snapshot::range(int start, int end, const char **p1, int *n1,
+                            const char **p2, int *n2) const {
+  if (start < 0) start = 0;
+  if (end > mLength) end = mLength;
+  if (end < start) end = start;
+  *p2 = 0;
+  *n2 = 0;
+  if (end <= mGapStart || start >= mGapStart) {
+    *p1 = address(start);
+    *n1 = end - start;
+  } else {
+    *p1 = mBuf + start;
+    *n1 = mGapStart - start;
+    *p2 = mBuf + mGapEnd;
+    *n2 = end - mGapStart;
+  }
+  return end - start;
+}
+
+
+/**
+ Returns a copy of the text from \p start to \p end, the caller must
+ free() it.
+ */
+char *Fl_Text_Snapshot::text_range(int start, int end) const {
+  const char *p1, *p2;
+  int n1, n2;
+  int n = range(start, end, &p1, &n1, &p2, &n2);
+  char *s = (char *) malloc(n + 1);
+  memcpy(s, p1, n1);
+  if (n2) memcpy(s + n1, p2, n2);
+  s[n] = '\0';
+  return s;
+}
+
+
 /*
  Insert some text at the given index.
  Pos must be at a character boundary.
@@ -537,6 +759,8 @@ void Fl_Text_Buffer::copy(Fl_Text_Buffer * fromBuf, int fromStart,
     reallocate_with_gap(toPos, copiedLength + mPreferredGapSize);
   else if (toPos != mGapStart)
     move_gap(toPos);
+  if (shared_(toPos, toPos + copiedLength))
+    reallocate_with_gap(toPos, mGapEnd - mGapStart);
 
   /* Insert the new text (toPos now corresponds to the start of the gap) */
   if (fromEnd <= fromBuf->mGapStart) {
@@ -553,6 +777,7 @@ void Fl_Text_Buffer::copy(Fl_Text_Buffer * fromBuf, int fromStart,
   }
   mGapStart += copiedLength;
   mLength += copiedLength;
+  mVersion++;
   update_selections(toPos, 0, copiedLength);
 }
 
@@ -1371,11 +1596,14 @@ int Fl_Text_Buffer::insert_(int pos, const char *text, int insertedLength)
     reallocate_with_gap(pos, insertedLength + mPreferredGapSize);
   else if (pos != mGapStart)
     move_gap(pos);
+  if (shared_(pos, pos + insertedLength))
+    reallocate_with_gap(pos, mGapEnd - mGapStart);
 
   /* Insert the new text (pos now corresponds to the start of the gap) */
   memcpy(&mBuf[pos], text, insertedLength);
   mGapStart += insertedLength;
   mLength += insertedLength;
+  mVersion++;
   update_selections(pos, 0, insertedLength);
 
   if (mCanUndo) {
@@ -1453,6 +1681,7 @@ void Fl_Text_Buffer::remove_(int start, int end)
 
   /* update the length */
   mLength -= end - start;
+  mVersion++;
 
   /* fix up any selections which might be affected by the change */
   update_selections(start, end - start, 0);
@@ -1671,6 +1900,13 @@ void Fl_Text_Buffer::move_gap(int pos)
 {
   int gapLen = mGapEnd - mGapStart;
 
+  /* moving the gap overwrites text a snapshot may still see, copying the
+   storage moves the gap for free */
+  if (pos > mGapStart ? shared_(mGapStart, pos) : shared_(pos + gapLen, mGapEnd)) {
+    reallocate_with_gap(pos, gapLen);
+    return;
+  }
+
   if (pos > mGapStart)
     memmove(&mBuf[mGapStart], &mBuf[mGapEnd], pos - mGapStart);
   else
@@ -1686,7 +1922,7 @@ void Fl_Text_Buffer::move_gap(int pos)
  */
 void Fl_Text_Buffer::reallocate_with_gap(int newGapStart, int newGapLen)
 {
-  char *newBuf = (char *) malloc(mLength + newGapLen);
+  char *newBuf = alloc_block(mLength + newGapLen);
   int newGapEnd = newGapStart + newGapLen;
 
   if (newGapStart <= mGapStart) {
@@ -1702,7 +1938,8 @@ void Fl_Text_Buffer::reallocate_with_gap(int newGapStart, int newGapLen)
            &mBuf[mGapEnd + newGapStart - mGapStart],
            mLength - newGapStart);
   }
-  free((void *) mBuf);
+  release_block(mBuf);
+  fl_memory_account(FL_MEMORY_TEXT_BUFFER, newGapLen - (mGapEnd - mGapStart));
   mBuf = newBuf;
   mGapStart = newGapStart;
   mGapEnd = newGapEnd;
@@ -1999,27 +2236,302 @@ const char *Fl_Text_Buffer::file_encoding_warning_message =
 }
 
 
+/*
+ Saving: the two pieces of text around the gap are streamed to a temporary
+ file next to the target, which is renamed over it when everything was
+ written. Symbolic links, hard links, special files, files in
+ directories where no temporary file can be created and files whose
+ owner or group the temporary file can't be given are written in place
+ instead, as a rename would replace, miss or take over them. The same
+ code saves from the buffer in the user interface thread and from a
+ snapshot in a background thread.
+ */
+
+typedef void (*Text_Save_Progress)(int done, void *data);
+
+// Writes all of iov, restarting after partial writes and signals.
+static int write_iov(int fd, struct iovec *iov, int n) {
+  while (n > 0) {
+    ssize_t r = writev(fd, iov, n);
+    if (r < 0) {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+    while (n > 0 && (size_t)r >= iov->iov_len) {
+      r -= iov->iov_len;
+      iov++; n--;
+    }
+    if (n > 0) {
+      iov->iov_base = (char *)iov->iov_base + r;
+      iov->iov_len -= r;
+    }
+  }
+  return 0;
+}
+
+// Writes pieces unchanged, chunk bytes per call.
+static int write_pieces(int fd, const char **piece, const int *len, int chunk,
+                        Text_Save_Progress progress, void *pdata) {
+  int total = len[0] + len[1];
+  for (int done = 0; done < total; ) {
+    struct iovec iov[2];
+    int n = 0, left = min(chunk, total - done), pos = done;
+    for (int i = 0; i < 2 && left > 0; i++) {
+      if (pos >= len[i]) { pos -= len[i]; continue; }
+      int l = min(left, len[i] - pos);
+      iov[n].iov_base = (void *)(piece[i] + pos);
+      iov[n].iov_len = l;
+      n++;
+      left -= l;
+      pos = 0;
+    }
+    if (write_iov(fd, iov, n) < 0) return 2;
+    done += min(chunk, total - done);
+    if (progress) progress(done, pdata);
+  }
+  return 0;
+}
+
+// Writes pieces converted according to Fl_Text_Save_Flags through a buffer
+// of chunk bytes.
+static int write_pieces_converted(int fd, const char **piece, const int *len,
+                                  int chunk, int flags,
+                                  Text_Save_Progress progress, void *pdata) {
+  char *out = (char *) malloc(chunk + 2);
+  int n = 0, done = 0, err = 0;
+  for (int i = 0; i < 2 && !err; i++) {
+    const char *p = piece[i], *e = p + len[i];
+    while (p < e) {
+      unsigned char c = (unsigned char)*p;
+      if (c == '\n' && (flags & FL_TEXT_SAVE_CRLF)) {
+        out[n++] = '\r';
+        out[n++] = '\n';
+        p++;
+      } else if (c >= 0x80 && (flags & FL_TEXT_SAVE_LATIN1)) {
+        int l;
+        unsigned u = fl_utf8decode(p, e, &l);
+        out[n++] = u < 0x100 ? (char)u : '?';
+        p += l;
+      } else {
+        out[n++] = (char)c;
+        p++;
+      }
+      if (n >= chunk) {
+        struct iovec iov = { out, (size_t)n };
+        if (write_iov(fd, &iov, 1) < 0) { err = 2; break; }
+        n = 0;
+        if (progress) progress(done + int(p - piece[i]), pdata);
+      }
+    }
+    done += len[i];
+  }
+  if (!err && n) {
+    struct iovec iov = { out, (size_t)n };
+    if (write_iov(fd, &iov, 1) < 0) err = 2;
+  }
+  free(out);
+  return err;
+}
+
+// The mode for a new file: that of the file it replaces, else the default.
+// Not thread safe because of umask().
+static mode_t save_mode(const char *file) {
+  struct stat st;
+  if (fl_stat(file, &st) == 0) return st.st_mode & 07777;
+  mode_t mask = umask(0);
+  umask(mask);
+  return 0666 & ~mask;
+}
+
+// Returns non-zero if file must be overwritten in place, not replaced.
+// st receives the status of file, st_nlink is 0 for a new file.
+static int save_in_place(const char *file, struct stat &st) {
+  if (lstat(file, &st) < 0) {
+    st.st_nlink = 0;
+    return 0;
+  }
+  return !S_ISREG(st.st_mode) || st.st_nlink > 1;
+}
+
+static int save_pieces(const char *file, const char **piece, const int *len,
+                       int chunk, int flags, mode_t mode,
+                       Text_Save_Progress progress, void *pdata) {
+  if (chunk < 4096) chunk = 4096;
+  char *tmp = 0;
+  int fd = -1;
+  struct stat st;
+  if (!save_in_place(file, st)) {
+    tmp = (char *) malloc(strlen(file) + 8);
+    sprintf(tmp, "%s.XXXXXX", file);
+    fd = mkstemp(tmp);
+    // the replacement keeps the owner and group of the file, if we may
+    // not set them it is written in place like a link
+    if (fd >= 0 && st.st_nlink && fchown(fd, st.st_uid, st.st_gid) < 0) {
+      close(fd);
+      fl_unlink(tmp);
+      fd = -1;
+    }
+    if (fd < 0) {               // e.g. the directory is not writable
+      free(tmp);
+      tmp = 0;
+    } else {
+      fchmod(fd, mode);
+    }
+  }
+  if (fd < 0) {
+    fd = fl_open(file, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) return 1;
+  }
+  int err = flags ? write_pieces_converted(fd, piece, len, chunk, flags, progress, pdata)
+                  : write_pieces(fd, piece, len, chunk, progress, pdata);
+  if (!err && tmp && fsync(fd) < 0) err = 2;   // data before the rename
+  if (close(fd) < 0 && !err) err = 2;
+  if (!tmp) return err;
+  if (!err && fl_rename(tmp, file) < 0) err = 2;
+  if (err) {
+    int e = errno;              // keep the reason for strerror()
+    fl_unlink(tmp);
+    errno = e;
+  }
+  free(tmp);
+  return err;
+}
+
+
 /*
  Write text to file.
  Unicode safe.
  */
 int Fl_Text_Buffer::outputfile(const char *file,
                                int start, int end,
-                               int buflen) {
-  FILE *fp;
-  if (!(fp = fl_fopen(file, "w")))
-    return 1;
-  for (int n; (n = min(end - start, buflen)); start += n) {
-    const char *p = text_range(start, start + n);
-    int r = (int) fwrite(p, 1, n, fp);
-    free((void *) p);
-    if (r != n)
-      break;
+                               int buflen, int flags) {
+  if (start < 0) start = 0;
+  if (end > mLength) end = mLength;
+  if (end < start) end = start;
+  const char *piece[2];
+  int len[2];
+  if (end <= mGapStart || start >= mGapStart) {
+    piece[0] = address(start); len[0] = end - start;
+    piece[1] = 0;              len[1] = 0;
+  } else {
+    piece[0] = mBuf + start;   len[0] = mGapStart - start;
+    piece[1] = mBuf + mGapEnd; len[1] = end - mGapStart;
   }
+  return save_pieces(file, piece, len, buflen, flags, save_mode(file), 0, 0);
+}
 
-  int e = ferror(fp) ? 2 : 0;
-  fclose(fp);
-  return e;
+
+// The callback of a background save, referenced by the save task and by
+// each progress report in the awake queue
+struct Fl_Text_Save_Client {
+  Fl_Text_Save_Cb cb;
+  void *data;
+  int total;
+  int finished;                 // final report done, ignore progress
+  volatile int refs;
+  void release() { if (__sync_sub_and_fetch(&refs, 1) == 0) delete this; }
+};
+
+// A save running in the shared task pool
+struct Fl_Text_Save_Job : public Fl_Task {
+  Fl_Text_Snapshot *snap;
+  char *file;
+  int flags;
+  mode_t mode;
+  Fl_Text_Save_Client *client; // NULL without callback
+  int reported;                 // progress sent last
+  int written, status;
+  ~Fl_Text_Save_Job() {
+    snap->release();
+    free(file);
+    if (client) client->release();
+  }
+  void run();
+  void done() {
+    client->cb(written, client->total, status, client->data);
+    client->finished = 1;
+  }
+};
+
+// A progress report sent to the user interface thread with Fl::awake()
+struct Fl_Text_Save_Report {
+  Fl_Text_Save_Client *client;
+  int done;
+};
+
+static void save_report_cb(void *r) {
+  Fl_Text_Save_Report *rep = (Fl_Text_Save_Report *) r;
+  Fl_Text_Save_Client *c = rep->client;
+  if (!c->finished) c->cb(rep->done, c->total, -1, c->data);
+  c->release();
+  delete rep;
+}
+
+// Progress is reported every 4 MB, reports are dropped if the awake
+// queue is full
+static void save_progress(int done, void *data) {
+  Fl_Text_Save_Job *job = (Fl_Text_Save_Job *) data;
+  if (done - job->reported < 4 * 1024 * 1024) return;
+  job->reported = done;
+  Fl_Text_Save_Report *rep = new Fl_Text_Save_Report;
+  rep->client = job->client;
+  rep->done = done;
+  __sync_add_and_fetch(&job->client->refs, 1);
+  if (Fl::awake(save_report_cb, rep) < 0) {
+    job->client->release();
+    delete rep;
+  }
+}
+
+void Fl_Text_Save_Job::run() {
+  const char *piece[2];
+  int len[2];
+  int n = snap->range(0, snap->length(), &piece[0], &len[0], &piece[1], &len[1]);
+  status = save_pieces(file, piece, len, 1024 * 1024, flags, mode,
+                       client ? save_progress : 0, this);
+  written = status ? reported : n;
+}
+
+
+/**
+ \brief Saves the buffer to a file without blocking the user interface.
+
+ The text is taken with snapshot(), which costs no copy, and written by a
+ task of Fl_Task_Pool::shared() like outputfile() does, so the buffer can
+ be edited while it is saved. Progress and the result are reported to
+ \p cb in the user interface thread, through Fl::awake(). The last call
+ has a status of 0 or more; \p cb is not called at all if it is NULL.
+
+ Without thread support the file is saved before this returns, and \p cb
+ is called directly.
+
+ \param file   file name
+ \param cb     progress and completion callback, may be NULL
+ \param data   user data passed to \p cb
+ \param flags  conversions, see Fl_Text_Save_Flags
+ */
+void Fl_Text_Buffer::savefile_background(const char *file, Fl_Text_Save_Cb cb,
+                                         void *data, int flags) {
+  Fl_Text_Save_Job *job = new Fl_Text_Save_Job;
+  job->snap = snapshot();
+  job->file = fl_strdup(file);
+  job->flags = flags;
+  job->mode = save_mode(file);
+  job->client = 0;
+  job->reported = 0;
+  job->written = 0;
+  job->status = 0;
+  if (cb) {
+    Fl_Text_Save_Client *c = new Fl_Text_Save_Client;
+    c->cb = cb;
+    c->data = data;
+    c->total = job->snap->length();
+    c->finished = 0;
+    c->refs = 1;
+    job->client = c;
+    job->then_on_ui();
+  }
+  Fl_Task_Pool::shared()->submit(job);
 }
 
 
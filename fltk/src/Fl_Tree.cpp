@@ -4,9 +4,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "../hdr/config.h"
 #include "../hdr/Fl_Tree.h"
 #include "../hdr/Fl_Preferences.h"
 #include "../hdr/fl_string_functions.h"
+#include "../hdr/Fl_Task_Pool.h"
 
 //////////////////////
 // Fl_Tree.cxx
@@ -26,6 +28,8 @@
 //     https://www.fltk.org/bugs.php
 //
 
+static void filter_free(Fl_Tree_Filter *f);    // see filter()
+
 // INTERNAL: scroller callback (hor+vert scroll)
 static void scroll_cb(Fl_Widget*,void *data) {
   ((Fl_Tree*)data)->redraw();
@@ -76,6 +80,7 @@ static int find_total_children(Fl_Tree_Item *item, int count=0) {
 
 /// Constructor.
 Fl_Tree::Fl_Tree(int X, int Y, int W, int H, const char *L) : Fl_Group(X,Y,W,H,L) {
+  _filter = 0;                                  // before any item calls recalc_tree()
   _root = new Fl_Tree_Item(this);
   _root->parent(0);                             // we are root of tree
   _root->label("ROOT");
@@ -112,6 +117,7 @@ Fl_Tree::Fl_Tree(int X, int Y, int W, int H, const char *L) : Fl_Group(X,Y,W,H,L
 /// Destructor.
 Fl_Tree::~Fl_Tree() {
   if ( _root ) { delete _root; _root = 0; }
+  if ( _filter ) { filter_free(_filter); _filter = 0; }
 }
 
 /// Extend the selection between and including \p 'from' and \p 'to'
@@ -800,6 +806,7 @@ Fl_Tree_Item* Fl_Tree::root() {
 void Fl_Tree::root(Fl_Tree_Item *newitem) {
   if ( _root ) clear();
   _root = newitem;
+  recalc_tree();
 }
 
 /** Adds a new item, given a menu style \p 'path'.
@@ -1645,6 +1652,247 @@ int Fl_Tree::is_close(const char *path) const {
   return(item->is_close()?1:0);
 }
 
+//////////////////////////
+// Item filter methods
+//////////////////////////
+
+// Internal: state of filter(), kept between calls so that a longer filter
+// text only has to re-check the items that matched the shorter one.
+//
+struct Fl_Tree_Filter {
+  char *text;                   // current filter text (0 if none)
+  int flags;                    // Fl_Tree_Filter_Flags of text
+  int dirty;                    // tree changed since the snapshot was taken
+  Fl_Tree_Item **items;         // all items except the root, in tree order
+  int *parent;                  // snapshot index of each item's parent (-1: root)
+  int nitems, aitems;
+  int *matches;                 // snapshot indices of the items matching text
+  int nmatches;
+  unsigned char *hit;           // match results of the current pass
+  const char *pattern;          // text being matched (folded to lower case), during filter() only
+  int plen;
+  int pflags;
+  volatile int cancel;          // set to stop the workers
+};
+
+#define FILTER_BLOCK        4096        // items matched between cancel checks
+#define FILTER_PARALLEL_MIN 32768       // fewer candidates are matched by the caller only
+#define FILTER_MAX_THREADS  8
+
+static void filter_free(Fl_Tree_Filter *f) {
+  free(f->text);
+  free(f->items);
+  free(f->parent);
+  free(f->matches);
+  free(f->hit);
+  delete f;
+}
+
+// Walk the tree in display order and append every item below 'item'
+static void filter_snapshot(Fl_Tree_Filter *f, Fl_Tree_Item *item, int parent) {
+  for ( int t=0; t<item->children(); t++ ) {
+    if ( f->nitems == f->aitems ) {
+      f->aitems = f->aitems ? 2 * f->aitems : 1024;
+      f->items  = (Fl_Tree_Item**)realloc(f->items, f->aitems * sizeof(Fl_Tree_Item*));
+      f->parent = (int*)realloc(f->parent, f->aitems * sizeof(int));
+    }
+    int i = f->nitems++;
+    f->items[i]  = item->child(t);
+    f->parent[i] = parent;
+    filter_snapshot(f, item->child(t), i);
+  }
+}
+
+static inline unsigned char fold(unsigned char c) {
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+// Returns non-zero if 'text' starts with 'prev', compared like filter_match()
+static int filter_extends(const char *text, const char *prev, int flags) {
+  size_t n = strlen(prev);
+  if ( flags & FL_TREE_FILTER_CASE ) return strncmp(text, prev, n) == 0;
+  for ( size_t i=0; i<n; i++ )
+    if ( fold((unsigned char)text[i]) != fold((unsigned char)prev[i]) ) return 0;
+  return 1;
+}
+
+static int filter_match(const char *label, const char *pat, int plen, int flags) {
+  if ( !label ) return 0;
+  if ( flags & FL_TREE_FILTER_CASE ) {
+    if ( flags & FL_TREE_FILTER_PREFIX ) return strncmp(label, pat, plen) == 0;
+    return strstr(label, pat) != 0;
+  }
+  const unsigned char *s = (const unsigned char*)label;
+  const unsigned char *p = (const unsigned char*)pat;
+  for ( ; *s; s++ ) {
+    int i = 0;
+    while ( i < plen && s[i] && fold(s[i]) == p[i] ) i++;
+    if ( i == plen ) return 1;
+    if ( flags & FL_TREE_FILTER_PREFIX ) break;
+  }
+  return 0;
+}
+
+// A range of candidates matched by one thread
+struct Filter_Job : public Fl_Task {
+  Fl_Tree_Filter *f;
+  const int *cand;              // candidate snapshot indices, 0 = all items
+  int from, to;
+  int interrupt;                // poll for user input (caller's thread only)
+  void run();
+};
+
+void Filter_Job::run() {
+  for ( int k = from; k < to && !f->cancel; ) {
+    int end = k + FILTER_BLOCK < to ? k + FILTER_BLOCK : to;
+    for ( ; k < end; k++ ) {
+      int i = cand ? cand[k] : k;
+      f->hit[k] = (unsigned char)filter_match(f->items[i]->label(), f->pattern, f->plen, f->pflags);
+    }
+    if ( interrupt && Fl::ready() ) f->cancel = 1;
+  }
+}
+
+// Match 'n' candidates, using the shared task pool for large sets.
+// Returns 0 if cancelled.
+static int filter_candidates(Fl_Tree_Filter *f, const int *cand, int n, int interrupt) {
+  int nthreads = 1;
+  Fl_Task_Pool *pool = 0;
+  if ( n >= FILTER_PARALLEL_MIN ) {
+    pool = Fl_Task_Pool::shared();
+    nthreads = pool->threads() + 1;     // the caller works too
+    if ( nthreads > FILTER_MAX_THREADS ) nthreads = FILTER_MAX_THREADS;
+    if ( nthreads > n / (FILTER_PARALLEL_MIN / 2) ) nthreads = n / (FILTER_PARALLEL_MIN / 2);
+  }
+  Filter_Job jobs[FILTER_MAX_THREADS];
+  f->cancel = 0;
+  for ( int t=0; t<nthreads; t++ ) {
+    jobs[t].f = f;
+    jobs[t].cand = cand;
+    jobs[t].from = (int)((long)n * t / nthreads);
+    jobs[t].to = (int)((long)n * (t+1) / nthreads);
+    jobs[t].interrupt = (t == 0) ? interrupt : 0;
+    jobs[t].auto_delete(0);
+    jobs[t].priority(FL_TASK_HIGH);
+  }
+  for ( int t=1; t<nthreads; t++ )
+    pool->submit(&jobs[t]);
+  jobs[0].run();
+  for ( int t=1; t<nthreads; t++ )
+    pool->join(&jobs[t]);
+  return !f->cancel;
+}
+
+/**
+ Shows only the items whose label matches \p 'text', together with their
+ parents, and hides all others.
+
+ Matching is done on a snapshot of the item pointers, on the threads of
+ Fl_Task_Pool::shared() for large trees. The visibility of all items is
+ then changed in one pass followed by a single relayout of the tree.
+
+ When \p 'text' extends the text of the previous call (the user typed
+ one more character) with the same \p 'flags' and the tree was not
+ changed in between, only the previous matches are checked again.
+
+ With FL_TREE_FILTER_INTERRUPT the call gives up as soon as user input
+ is waiting, leaving the tree as it was; the application will normally
+ call filter() again with the new text from that input.
+
+ A NULL or empty \p 'text' removes the filter and shows all items it
+ hid. Items that were hidden by the application stay hidden, also when
+ they match. Items added while a filter is set are visible until filter()
+ is called again.
+
+ \param[in] text  text to look for in the item labels
+ \param[in] flags any of ::Fl_Tree_Filter_Flags or'ed together
+ \returns the number of matching items, or -1 if interrupted
+ \version 1.4.0
+*/
+int Fl_Tree::filter(const char *text, int flags) {
+  if ( !text || !*text ) {
+    if ( _filter ) {
+      for ( Fl_Tree_Item *item = first(); item; item = next(item) )
+        if ( item->_flags & Fl_Tree_Item::FILTERED )
+          item->_flags = (item->_flags & ~Fl_Tree_Item::FILTERED) | Fl_Tree_Item::VISIBLE;
+      filter_free(_filter);
+      _filter = 0;
+      recalc_tree();
+      redraw();
+    }
+    return 0;
+  }
+  if ( !_root ) return 0;
+  if ( !_filter ) {
+    _filter = new Fl_Tree_Filter;
+    memset(_filter, 0, sizeof(Fl_Tree_Filter));
+    _filter->dirty = 1;
+  }
+  Fl_Tree_Filter *f = _filter;
+  int match_flags = flags & (FL_TREE_FILTER_PREFIX | FL_TREE_FILTER_CASE);
+  int incremental = !f->dirty && f->text && f->flags == match_flags &&
+                    filter_extends(text, f->text, match_flags);
+  if ( f->dirty ) {
+    f->nitems = 0;
+    filter_snapshot(f, _root, -1);
+    f->matches = (int*)realloc(f->matches, (f->nitems ? f->nitems : 1) * sizeof(int));
+    f->hit = (unsigned char*)realloc(f->hit, f->nitems ? f->nitems : 1);
+    f->dirty = 0;
+  }
+
+  // match the labels
+  char *pattern = fl_strdup(text);
+  if ( !(match_flags & FL_TREE_FILTER_CASE) )
+    for ( char *p = pattern; *p; p++ ) *p = (char)fold((unsigned char)*p);
+  f->pattern = pattern;
+  f->plen = (int)strlen(pattern);
+  f->pflags = match_flags;
+  const int *cand = incremental ? f->matches : 0;
+  int ncand = incremental ? f->nmatches : f->nitems;
+  int done = filter_candidates(f, cand, ncand, flags & FL_TREE_FILTER_INTERRUPT);
+  f->pattern = 0;
+  free(pattern);
+  if ( !done ) return -1;
+  int n = 0;
+  for ( int k=0; k<ncand; k++ )         // in place: n <= k
+    if ( f->hit[k] ) f->matches[n++] = cand ? cand[k] : k;
+  f->nmatches = n;
+  free(f->text);
+  f->text = fl_strdup(text);            // as given, for filter() and the next call
+  f->flags = match_flags;
+
+  // matching items and their parents are visible
+  unsigned char *vis = f->hit;          // reused, indexed by item now
+  memset(vis, 0, f->nitems);
+  for ( int m=0; m<n; m++ ) {
+    int i = f->matches[m];
+    vis[i] = 1;
+    for ( int p = f->parent[i]; p >= 0 && !vis[p]; p = f->parent[p] ) vis[p] = 2;
+  }
+  for ( int i=0; i<f->nitems; i++ ) {
+    Fl_Tree_Item *item = f->items[i];
+    if ( vis[i] ) {
+      if ( item->_flags & Fl_Tree_Item::FILTERED )
+        item->_flags = (item->_flags & ~Fl_Tree_Item::FILTERED) | Fl_Tree_Item::VISIBLE;
+      if ( vis[i] == 2 && (flags & FL_TREE_FILTER_OPEN) && item->is_close() ) item->open();
+    } else if ( item->_flags & Fl_Tree_Item::VISIBLE ) {      // else hidden by the application
+      item->_flags = (item->_flags & ~Fl_Tree_Item::VISIBLE) | Fl_Tree_Item::FILTERED;
+    }
+  }
+  if ( n && (flags & FL_TREE_FILTER_OPEN) && _root->is_close() ) _root->open();
+  recalc_tree();
+  redraw();
+  f->dirty = 0;                         // our own changes keep the snapshot valid
+  return n;
+}
+
+/// Returns the text set by filter(), or NULL if no filter is set.
+/// \version 1.4.0
+///
+const char *Fl_Tree::filter() const {
+  return _filter ? _filter->text : 0;
+}
+
 /// Select the specified \p 'item'. Use 'deselect()' to deselect it.
 ///
 /// Invokes the callback depending on the value of optional parameter \p docallback.<br>
@@ -2688,4 +2936,5 @@ void Fl_Tree::fix_scrollbar_order() {
 ///
 void Fl_Tree::recalc_tree() {
   _tree_w = _tree_h = -1;
+  if ( _filter ) _filter->dirty = 1;    // items may have been added or removed
 }
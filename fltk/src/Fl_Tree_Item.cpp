@@ -10,6 +10,12 @@
 #include "../hdr/Fl_Tree.h"
 #include "../hdr/fl_string_functions.h"
 #include "Fl_System_Driver.h"
+#include "Fl_Memory.h"
+
+// Bytes of a label, as reported to memory accounting
+static long label_bytes(const char *s) {
+  return s ? (long)strlen(s) + 1 : 0;
+}
 
 //////////////////////
 // Fl_Tree_Item.cxx
@@ -74,6 +80,7 @@ void Fl_Tree_Item::_Init(const Fl_Tree_Prefs &prefs, Fl_Tree *tree) {
   _children.manage_item_destroy(1);     // let array's dtor manage destroying Fl_Tree_Items
   _prev_sibling     = 0;
   _next_sibling     = 0;
+  fl_memory_account(FL_MEMORY_TREE, sizeof(Fl_Tree_Item));
 }
 
 /// Constructor.
@@ -90,6 +97,7 @@ Fl_Tree_Item::Fl_Tree_Item(Fl_Tree *tree) {
 
 // DTOR
 Fl_Tree_Item::~Fl_Tree_Item() {
+  fl_memory_account(FL_MEMORY_TREE, -((long)sizeof(Fl_Tree_Item) + label_bytes(_label)));
   if ( _label ) {
     free((void*)_label);
     _label = 0;
@@ -130,6 +138,7 @@ Fl_Tree_Item::Fl_Tree_Item(const Fl_Tree_Item *o) {
   _parent           = o->_parent;
   _prev_sibling     = 0;                // do not copy ptrs! use update_prev_next()
   _next_sibling     = 0;                // do not copy ptrs! use update_prev_next()
+  fl_memory_account(FL_MEMORY_TREE, sizeof(Fl_Tree_Item) + label_bytes(_label));
 }
 
 /// Print the tree as 'ascii art' to stdout.
@@ -156,6 +165,7 @@ void Fl_Tree_Item::show_self(const char *indent) const {
 /// Makes and manages an internal copy of \p 'name'.
 ///
 void Fl_Tree_Item::label(const char *name) {
+  fl_memory_account(FL_MEMORY_TREE, label_bytes(name) - label_bytes(_label));
   if ( _label ) { free((void*)_label); _label = 0; }
   _label = name ? fl_strdup(name) : 0;
   recalc_tree();                // may change label geometry
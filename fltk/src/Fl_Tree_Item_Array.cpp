@@ -6,6 +6,7 @@
 
 #include "../hdr/Fl_Tree_Item_Array.h"
 #include "../hdr/Fl_Tree_Item.h"
+#include "Fl_Memory.h"
 
 //////////////////////
 // Fl_Tree_Item_Array.cxx
@@ -46,6 +47,7 @@ Fl_Tree_Item_Array::~Fl_Tree_Item_Array() {
 /// Copy constructor. Makes new copy of array, with new instances of each item.
 Fl_Tree_Item_Array::Fl_Tree_Item_Array(const Fl_Tree_Item_Array* o) {
   _items = (Fl_Tree_Item**)malloc(o->_size * sizeof(Fl_Tree_Item*));
+  fl_memory_account(FL_MEMORY_TREE, o->_size * (long)sizeof(Fl_Tree_Item*));
   _total     = 0;
   _size      = o->_size;
   _chunksize = o->_chunksize;
@@ -77,6 +79,7 @@ void Fl_Tree_Item_Array::clear() {
       }
     }
     free((void*)_items); _items = 0;
+    fl_memory_account(FL_MEMORY_TREE, -_size * (long)sizeof(Fl_Tree_Item*));
   }
   _total = _size = 0;
 }
@@ -99,6 +102,7 @@ void Fl_Tree_Item_Array::enlarge(int count) {
       free((void*)_items); _items = 0;
     }
     // Adjust items/sizeitems
+    fl_memory_account(FL_MEMORY_TREE, (newsize - _size) * (long)sizeof(Fl_Tree_Item*));
     _items = newitems;
     _size = newsize;
   }
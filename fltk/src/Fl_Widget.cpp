@@ -18,6 +18,7 @@
 #include "../hdr/Fl_Widget.h"
 #include "../hdr/Fl_Group.h"
 #include "../hdr/Fl_Tooltip.h"
+#include "../hdr/Fl_Draw_Profiler.h"
 #include "../hdr/fl_draw.h"
 #include "../hdr/fl_string_functions.h"
 #include <stdlib.h>
@@ -163,6 +164,7 @@ extern void fl_throw_focus(Fl_Widget*); // in Fl_x.cxx
 */
 Fl_Widget::~Fl_Widget() {
   Fl::clear_widget_pointer(this);
+  Fl_Draw_Profiler::forget_(this);
   if (flags() & COPIED_LABEL) free((void *)(label_.value));
   if (flags() & COPIED_TOOLTIP) free((void *)(tooltip_));
   image(NULL);
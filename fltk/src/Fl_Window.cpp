@@ -890,6 +890,29 @@ void Fl_Window::screen_num(int screen_num) {
   if (!shown() && screen_num >= 0 && screen_num < Fl::screen_count()) pWindowDriver->screen_num(screen_num);
 }
 
+/**
+  Limits how often the window is redrawn.
+
+  Redraws requested more often than \p fps times per second are merged
+  into the next frame, see Fl::frame_rate(double) for details.
+
+  \param[in] fps  maximum frames per second, 0 for no limit, or a negative
+                  value to use the global Fl::frame_rate() (the default)
+*/
+void Fl_Window::frame_rate(double fps) {
+  pWindowDriver->frame_interval_ = (fps > 0) ? 1.0 / fps : (fps < 0 ? -1.0 : 0.0);
+}
+
+/**
+  Returns the frame rate limit of the window.
+  \return frames per second, 0 if unlimited, negative if the global
+         Fl::frame_rate() is used
+*/
+double Fl_Window::frame_rate() const {
+  double t = pWindowDriver->frame_interval_;
+  return (t > 0) ? 1.0 / t : t;
+}
+
 /** Assigns a non-rectangular shape to the window.
  This function gives an arbitrary shape (not just a rectangular region) to an Fl_Window.
  An Fl_Image of any dimension can be used as mask; it is rescaled to the window's dimension as needed.
@@ -43,6 +43,10 @@ Fl_Window_Driver::Fl_Window_Driver(Fl_Window *win)
   wait_for_expose_value = 0;
   other_xid = 0;
   screen_num_ = 0;
+  frame_interval_ = -1.0;
+  last_frame_ = Fl_Timestamp(); // long ago
+  deferred_ = 0;
+  input_pending_ = 0;
 }
 
 
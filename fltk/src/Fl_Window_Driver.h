@@ -66,6 +66,12 @@ public:
   static Fl_Window *find(fl_uintptr_t xid);
   int wait_for_expose_value;
   Fl_Image_Surface *other_xid; // offscreen bitmap (overlay and double-buffered windows)
+  // frame scheduling, see Fl::flush()
+  double frame_interval_;     // min. seconds between flushes, 0 = no limit, < 0 = global
+  Fl_Timestamp last_frame_;   // time of the last flush
+  int deferred_;              // number of flushes postponed since then
+  char input_pending_;        // set by Fl::handle() for user input to this window tree
+  double frame_interval();
   int screen_num();
   void screen_num(int n) { screen_num_ = n; }
 
@@ -110,7 +116,7 @@ public:
   void show_iconic(char c) { Fl_Window::show_next_window_iconic(c); }
   void flx(Fl_X *x) { pWindow->flx_ = x; }
   Fl_Cursor cursor_default() { return pWindow->cursor_default; }
-  void destroy_double_buffer();
+  virtual void destroy_double_buffer();
   /** for an Fl_Overlay_Window, returns the value of its overlay_ member variable */
   Fl_Window *overlay() {
     return pWindow->as_overlay_window() ? pWindow->as_overlay_window()->overlay_ : NULL;
@@ -32,6 +32,45 @@ static idle_cb* first;
 static idle_cb* last;
 static idle_cb* freelist;
 
+// Budgeted idle callbacks are kept in a list sorted by priority, highest
+// first. A callback that ran is moved to the end of its priority group,
+// so callbacks with the same priority take turns.
+
+struct slice_cb {
+  Fl_Idle_Slice_Handler cb;
+  void* data;
+  int priority;
+  double cost;          // average run time in seconds, 0 = not run yet
+  unsigned pass;        // last pass that visited it
+  int deferred;         // consecutive frames it was skipped
+  slice_cb *next;
+};
+
+static slice_cb* slices;
+static slice_cb* running_slice;     // callback being called
+static char running_removed;        // ... and removed by itself
+static Fl_Timestamp frame_end;      // when the idle slices last returned
+static char frame_valid;
+
+// Callbacks whose average cost exceeds this part of the frame are not
+// called while events are pending, unless they were skipped this many times:
+#define EXPENSIVE_PART 4
+#define MAX_DEFERRED 8
+// Every frame gets at least this part of the budget for idle slices:
+#define MIN_SLICE_PART 8
+
+static void insert_slice(slice_cb* p) {
+  slice_cb** q = &slices;
+  while (*q && (*q)->priority >= p->priority) q = &(*q)->next;
+  p->next = *q;
+  *q = p;
+}
+
+static void unlink_slice(slice_cb* p) {
+  for (slice_cb** q = &slices; *q; q = &(*q)->next)
+    if (*q == p) { *q = p->next; return; }
+}
+
 // The function call_idle()
 // - removes the first idle callback from the front of the list (ring)
 // - adds it as the last entry and
@@ -39,10 +78,62 @@ static idle_cb* freelist;
 // The idle callback may remove itself from the list of idle callbacks
 // by calling Fl::remove_idle()
 
+// The function call_slices() calls the budgeted idle callbacks in
+// priority order, in as many passes as fit in the time left of the
+// frame, i.e. the frame interval minus the time spent on events and
+// drawing since it last returned. The cost of each call is measured
+// to skip callbacks that would overrun the deadline or delay pending
+// input.
+
+static void call_slices() {
+  double budget = Fl::frame_rate() > 0 ? 1.0 / Fl::frame_rate() : 1.0 / 60;
+  if (!frame_valid) { frame_end = Fl::now(); frame_valid = 1; }
+  double left = budget - Fl::seconds_since(frame_end);
+  if (left < budget / MIN_SLICE_PART) left = budget / MIN_SLICE_PART;
+  Fl_Timestamp deadline = Fl::now(left);
+  int input = Fl::ready();
+  static unsigned pass;
+  unsigned first_pass = pass + 1;
+  int ran = 0;
+  for (;;) {
+    int ran_in_pass = 0;
+    pass++;
+    for (;;) {
+      slice_cb* p = slices;
+      while (p && p->pass == pass) p = p->next;
+      if (!p) break;
+      p->pass = pass;
+      double remaining = -Fl::seconds_since(deadline);
+      if (ran && remaining <= 0) goto done;
+      if ((input && p->cost > budget / EXPENSIVE_PART) || (ran && p->cost > remaining)) {
+        if (pass != first_pass || ++p->deferred <= MAX_DEFERRED) continue;
+      }
+      p->deferred = 0;
+      unlink_slice(p);
+      insert_slice(p);
+      running_slice = p;
+      running_removed = 0;
+      Fl_Timestamp start = Fl::now();
+      p->cb(p->data, deadline); // this may call add_idle() or remove_idle()!
+      double t = Fl::seconds_since(start);
+      running_slice = 0;
+      if (running_removed) delete p;
+      else p->cost = p->cost > 0 ? 0.75 * p->cost + 0.25 * t : t;
+      ran = ran_in_pass = 1;
+    }
+    if (!ran_in_pass) break;
+  }
+done:
+  frame_end = Fl::now();
+}
+
 static void call_idle() {
   idle_cb* p = first;
-  last = p; first = p->next;
-  p->cb(p->data); // this may call add_idle() or remove_idle()!
+  if (p) {
+    last = p; first = p->next;
+    p->cb(p->data); // this may call add_idle() or remove_idle()!
+  }
+  if (slices) call_slices();
 }
 
 /**
@@ -75,7 +166,7 @@ void Fl::add_idle(Fl_Idle_Handler cb, void* data) {
   } else {
     first = last = p;
     p->next = p;
-    set_idle(call_idle);
+    if (!slices) set_idle(call_idle);
   }
 }
 
@@ -105,7 +196,7 @@ void Fl::remove_idle(Fl_Idle_Handler cb, void* data) {
   }
   if (l == p) { // only one
     first = last = 0;
-    set_idle(0);
+    if (!slices) set_idle(0);
   } else {
     last = l;
     first = l->next = p->next;
@@ -113,3 +204,80 @@ void Fl::remove_idle(Fl_Idle_Handler cb, void* data) {
   p->next = freelist;
   freelist = p;
 }
+
+/**
+  Adds a budgeted idle callback.
+
+  Unlike the callbacks added with add_idle(Fl_Idle_Handler, void*), which
+  are called one per Fl::wait(), budgeted callbacks share the time left
+  in each frame (see Fl::frame_rate(), 1/60 second if it is not set) after
+  events were handled and windows drawn. They are called in order of
+  \p priority, highest first, and again as long as time is left, and
+  should do a slice of work and return when \p deadline is reached:
+
+  \code
+  void index_files(void *data, Fl_Timestamp deadline) {
+    Indexer *ix = (Indexer *)data;
+    while (Fl::seconds_since(deadline) < 0)
+      if (!ix->index_next_file()) { Fl::remove_idle(index_files, data); break; }
+  }
+  Fl::add_idle(index_files, indexer, 1);
+  \endcode
+
+  FLTK measures how long each callback runs. A callback that usually
+  takes longer than the time left in the frame is skipped, and one that
+  takes more than a quarter of the frame is skipped while events are
+  pending, so background work doesn't delay user input. A skipped
+  callback is still called every few frames.
+
+  As with the other idle callbacks, Fl::wait() does not block while any
+  is installed. Adding a callback that is already installed changes its
+  priority.
+
+  \see has_idle(Fl_Idle_Slice_Handler, void*), remove_idle(Fl_Idle_Slice_Handler, void*)
+*/
+void Fl::add_idle(Fl_Idle_Slice_Handler cb, void* data, int priority) {
+  slice_cb* p;
+  for (p = slices; p; p = p->next)
+    if (p->cb == cb && p->data == data) break;
+  if (p) {
+    unlink_slice(p);
+  } else {
+    p = new slice_cb;
+    p->cb = cb;
+    p->data = data;
+    p->cost = 0.0;
+    p->pass = 0;
+    p->deferred = 0;
+    if (!slices && !first) {
+      frame_valid = 0;
+      set_idle(call_idle);
+    }
+  }
+  p->priority = priority;
+  insert_slice(p);
+}
+
+/**
+  Returns true if the specified budgeted idle callback is installed.
+*/
+int Fl::has_idle(Fl_Idle_Slice_Handler cb, void* data) {
+  for (slice_cb* p = slices; p; p = p->next)
+    if (p->cb == cb && p->data == data) return 1;
+  return 0;
+}
+
+/**
+  Removes the specified budgeted idle callback, if it is installed.
+  A callback can remove itself.
+*/
+void Fl::remove_idle(Fl_Idle_Slice_Handler cb, void* data) {
+  slice_cb* p;
+  for (p = slices; p; p = p->next)
+    if (p->cb == cb && p->data == data) break;
+  if (!p) return;
+  unlink_slice(p);
+  if (p == running_slice) running_removed = 1;
+  else delete p;
+  if (!slices && !first) set_idle(0);
+}
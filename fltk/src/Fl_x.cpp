@@ -139,7 +139,7 @@ int Fl_X11_Screen_Driver::poll_or_select_with_delay(double time_to_wait) {
 
 // just like Fl_X11_Screen_Driver::poll_or_select_with_delay(0.0) except no callbacks are done:
 int Fl_X11_Screen_Driver::poll_or_select() {
-  if (XQLength(fl_display)) return 1;
+  if (fl_display && XQLength(fl_display)) return 1;
   return Fl_Unix_Screen_Driver::poll_or_select();
 }
 
@@ -1278,10 +1278,14 @@ static bool remove_xid_vector(Window xid) {
   return false;
 }
 
+// set by Fl::dnd() while dragging, returns non-zero for events it consumed
+int (*fl_dnd_event_hook)(const XEvent&) = 0;
+
 int fl_handle(const XEvent& thisevent)
 {
   XEvent xevent = thisevent;
   fl_xevent = &thisevent;
+  if (fl_dnd_event_hook && fl_dnd_event_hook(thisevent)) return 1;
   Window xid = xevent.xany.window;
 
   // For each DestroyNotify event, determine whether an FLTK-created window
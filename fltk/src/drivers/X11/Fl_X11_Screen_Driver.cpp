@@ -508,7 +508,11 @@ int Fl_X11_Screen_Driver::parse_color(const char* p, uchar& r, uchar& g, uchar&
   // if it's #rgb, we can do that ourselves
   if (Fl_Screen_Driver::parse_color(p, r, g, b))
     return 1;
-  // it's neither "None" nor hex, so finally open the diplay and ask X11
+  // and most names too
+  if (color_name(p, r, g, b))
+    return 1;
+  // it's neither "None" nor hex nor a known name, so finally open the
+  // display and ask X11, e.g. for "rgb:ff/80/00"
   XColor x;
   if (!fl_display) open_display();
   if (XParseColor(fl_display, fl_colormap, p, &x)) {
@@ -540,11 +544,11 @@ static void getsyscolor(const char *key1, const char* key2, const char *arg, con
     arg = XGetDefault(fl_display, key1, key2);
     if (!arg) arg = defarg;
   }
-  XColor x;
-  if (!XParseColor(fl_display, fl_colormap, arg, &x))
+  uchar r, g, b;
+  if (!Fl::screen_driver()->parse_color(arg, r, g, b))
     Fl::error("Unknown color: %s", arg);
   else
-    func(x.red>>8, x.green>>8, x.blue>>8);
+    func(r, g, b);
 }
 
 
@@ -91,6 +91,7 @@ public:
   void grab(Fl_Window* win) FL_OVERRIDE;
   // --- global colors
   int parse_color(const char* p, uchar& r, uchar& g, uchar& b) FL_OVERRIDE;
+  static int color_name(const char *name, uchar &r, uchar &g, uchar &b);
   void get_system_colors() FL_OVERRIDE;
   const char *get_system_scheme() FL_OVERRIDE;
   int dnd(int unused) FL_OVERRIDE;
@@ -31,6 +31,7 @@
 #include "../../../hdr/fl_ask.h"
 #include "../../../hdr/Fl.h"
 #include "../../../hdr/platform.h"
+#include "../../Fl_Memory.h"
 #include <string.h>
 #if HAVE_DLFCN_H
 #include <dlfcn.h>
@@ -41,6 +42,89 @@
 Window fl_window;
 
 
+#if !FLTK_USE_CAIRO
+
+// Back buffers of double-buffered windows.
+//
+// Buffers get some slack so that interactive resizing does not need a
+// new pixmap for each step. Buffers released by destroy_double_buffer(),
+// e.g. when Fl_Double_Window::resize() finds the window bigger, are kept
+// in a small pool for a moment, so that the next flush of this or another
+// window can use them if they are big enough. Their content is not kept:
+// a resized window is redrawn completely anyway.
+
+#define BACK_POOL_SIZE 4
+#define BACK_POOL_DELAY 2.0 // seconds before pooled buffers are freed
+
+struct Back_Buffer {
+  Display *display;
+  Pixmap pixmap;
+  int w, h, depth;          // allocated size
+};
+
+static Back_Buffer back_pool[BACK_POOL_SIZE];
+static int back_pool_n = 0;
+
+// adds about a quarter and rounds up to a multiple of 64 or 256 pixels
+static int back_buffer_size(int v) {
+  v += v / 4;
+  int q = (v < 1024 ? 64 : 256);
+  return (v + q - 1) / q * q;
+}
+
+static void free_back_buffer(Back_Buffer &b) {
+  if (b.display == fl_display) // else the display was closed
+    XFreePixmap(fl_display, b.pixmap);
+  fl_memory_account(FL_MEMORY_OFFSCREEN, -fl_offscreen_bytes(b.w, b.h));
+}
+
+static void back_pool_remove(int i) {
+  back_pool_n--;
+  memmove(back_pool + i, back_pool + i + 1, (back_pool_n - i) * sizeof(Back_Buffer));
+}
+
+static void back_pool_clear(void * = 0) {
+  for (int i = 0; i < back_pool_n; i++)
+    free_back_buffer(back_pool[i]);
+  back_pool_n = 0;
+}
+
+static void back_pool_trim() {
+  Fl::remove_timeout(back_pool_clear);
+  back_pool_clear();
+}
+
+static void back_pool_put(const Back_Buffer &b) {
+  if (back_pool_n == BACK_POOL_SIZE) {
+    free_back_buffer(back_pool[0]);
+    back_pool_remove(0);
+  }
+  back_pool[back_pool_n++] = b;
+  fl_memory_trim_handler(back_pool_trim);
+  Fl::remove_timeout(back_pool_clear);
+  Fl::add_timeout(BACK_POOL_DELAY, back_pool_clear);
+}
+
+// Takes a buffer of at least W x H pixels from the pool, the one released
+// last. Buffers much larger than needed are left there.
+static bool back_pool_get(int W, int H, Back_Buffer &b) {
+  int best = -1;
+  double limit = 2.0 * back_buffer_size(W) * back_buffer_size(H);
+  for (int i = back_pool_n - 1; i >= 0; i--) {
+    Back_Buffer &e = back_pool[i];
+    if (e.display != fl_display || e.depth != fl_visual->depth || e.w < W || e.h < H)
+      continue;
+    if ((double)e.w * e.h <= limit) { best = i; break; }
+  }
+  if (best < 0) return false;
+  b = back_pool[best];
+  back_pool_remove(best);
+  return true;
+}
+
+#endif // !FLTK_USE_CAIRO
+
+
 Fl_X11_Window_Driver::Fl_X11_Window_Driver(Fl_Window *win)
 : Fl_Window_Driver(win)
 {
@@ -52,6 +136,9 @@ Fl_X11_Window_Driver::Fl_X11_Window_Driver(Fl_Window *win)
 #endif
 #if FLTK_USE_CAIRO
   cairo_ = NULL;
+#else
+  back_w_ = back_h_ = 0;
+  back_scale_ = 1;
 #endif
 }
 
@@ -150,6 +237,7 @@ void Fl_X11_Window_Driver::draw_begin()
 }
 
 
+
 void Fl_X11_Window_Driver::flush_double()
 {
   if (!shown()) return;
@@ -160,16 +248,38 @@ void Fl_X11_Window_Driver::flush_double(int erase_overlay)
 {
   pWindow->make_current(); // make sure fl_gc is non-zero
   Fl_X *i = Fl_X::flx(pWindow);
+#if FLTK_USE_CAIRO
   if (!other_xid) {
     other_xid = new Fl_Image_Surface(w(), h(), 1);
-#if FLTK_USE_CAIRO
     cairo_ = ((Fl_Cairo_Graphics_Driver*)other_xid->driver())->cr();
-#endif
     pWindow->clear_damage(FL_DAMAGE_ALL);
   }
-#if FLTK_USE_CAIRO
   ((Fl_X11_Cairo_Graphics_Driver*)fl_graphics_driver)->set_cairo(cairo_);
-#endif
+#else
+  float s = Fl::screen_driver()->scale(screen_num());
+  int PW = int(w() * s), PH = int(h() * s);
+  if (PW < 1) PW = 1;
+  if (PH < 1) PH = 1;
+  if (other_xid && (PW > back_w_ || PH > back_h_ || s != back_scale_))
+    destroy_double_buffer();
+  if (!other_xid) {
+    Back_Buffer b;
+    if (!back_pool_get(PW, PH, b)) {
+      b.display = fl_display;
+      b.depth = fl_visual->depth;
+      b.w = back_buffer_size(PW);
+      b.h = back_buffer_size(PH);
+      b.pixmap = XCreatePixmap(fl_display, RootWindow(fl_display, fl_screen), b.w, b.h, b.depth);
+      fl_memory_account(FL_MEMORY_OFFSCREEN, fl_offscreen_bytes(b.w, b.h));
+    }
+    other_xid = new Fl_Image_Surface(w(), h(), 1, (Fl_Offscreen)b.pixmap);
+    if (s != 1) other_xid->driver()->scale(s); // not done for given offscreens
+    back_w_ = b.w;
+    back_h_ = b.h;
+    back_scale_ = s;
+    pWindow->clear_damage(FL_DAMAGE_ALL);
+  }
+#endif // FLTK_USE_CAIRO
     if (pWindow->damage() & ~FL_DAMAGE_EXPOSE) {
       fl_clip_region(i->region); i->region = 0;
       fl_window = other_xid->offscreen();
@@ -186,6 +296,24 @@ void Fl_X11_Window_Driver::flush_double(int erase_overlay)
 }
 
 
+void Fl_X11_Window_Driver::destroy_double_buffer()
+{
+#if !FLTK_USE_CAIRO
+  if (other_xid && fl_display) {
+    Back_Buffer b;
+    b.display = fl_display;
+    b.pixmap = (Pixmap)other_xid->offscreen();
+    b.depth = fl_visual->depth;
+    b.w = back_w_;
+    b.h = back_h_;
+    back_pool_put(b);
+  }
+  back_w_ = back_h_ = 0;
+#endif
+  Fl_Window_Driver::destroy_double_buffer();
+}
+
+
 void Fl_X11_Window_Driver::flush_overlay()
 {
   if (!shown()) return;
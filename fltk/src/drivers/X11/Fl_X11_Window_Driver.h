@@ -76,6 +76,10 @@ private:
 #endif // USE_XFT
 #if FLTK_USE_CAIRO
   cairo_t *cairo_;
+#else
+  // back buffer of a double-buffered window, see flush_double()
+  int back_w_, back_h_;             // allocated size in pixels
+  float back_scale_;
 #endif // FLTK_USE_CAIRO
   bool decorated_win_size(int &w, int &h);
   void combine_mask();
@@ -103,6 +107,7 @@ public:
   void take_focus() FL_OVERRIDE;
   void flush_double() FL_OVERRIDE;
   void flush_overlay() FL_OVERRIDE;
+  void destroy_double_buffer() FL_OVERRIDE;
   void draw_begin() FL_OVERRIDE;
   void make_current() FL_OVERRIDE;
   void show() FL_OVERRIDE;
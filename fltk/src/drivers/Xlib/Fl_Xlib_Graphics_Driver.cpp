@@ -43,6 +43,9 @@ GC fl_x11_gc() { return fl_gc; }
 Fl_Xlib_Graphics_Driver::Fl_Xlib_Graphics_Driver(void) {
   mask_bitmap_ = NULL;
   short_point = NULL;
+  arcs_ = NULL;
+  n_arcs_ = arcs_size_ = 0;
+  in_path_ = 0;
 #if USE_PANGO
   Fl_Graphics_Driver::font(0, 0);
 #endif
@@ -53,6 +56,7 @@ Fl_Xlib_Graphics_Driver::Fl_Xlib_Graphics_Driver(void) {
 
 Fl_Xlib_Graphics_Driver::~Fl_Xlib_Graphics_Driver() {
   if (short_point) free(short_point);
+  if (arcs_) free(arcs_);
 }
 
 
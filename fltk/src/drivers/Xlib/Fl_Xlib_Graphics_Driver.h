@@ -70,8 +70,9 @@ protected:
   void draw_image_unscaled(Fl_Draw_Image_Cb cb, void* data, int X,int Y,int W,int H, int D=3) FL_OVERRIDE;
   void draw_image_mono_unscaled(const uchar* buf, int X,int Y,int W,int H, int D=1, int L=0) FL_OVERRIDE;
   void draw_image_mono_unscaled(Fl_Draw_Image_Cb cb, void* data, int X,int Y,int W,int H, int D=1) FL_OVERRIDE;
-#if HAVE_XRENDER
   void draw_rgb(Fl_RGB_Image *rgb, int XP, int YP, int WP, int HP, int cx, int cy) FL_OVERRIDE;
+  void draw_rgb_scaled_(Fl_RGB_Image *rgb, int XP, int YP, int WP, int HP, int cx, int cy);
+#if HAVE_XRENDER
   int scale_and_render_pixmap(Fl_Offscreen pixmap, int depth, double scale_x, double scale_y, int XP, int YP, int WP, int HP);
 #endif
   int height_unscaled() FL_OVERRIDE;
@@ -97,6 +98,10 @@ private:
   uchar *mask_bitmap_;
   uchar **mask_bitmap() FL_OVERRIDE {return &mask_bitmap_;}
   XPoint *short_point;
+  XArc *arcs_;          // circles of the current path
+  int n_arcs_, arcs_size_;
+  char in_path_;        // between fl_begin_XXX() and fl_end_XXX()
+  void end_arcs_();
 #if USE_XFT
   static Window draw_window;
   static struct _XftDraw* draw_;
@@ -190,6 +195,11 @@ protected:
   int clip_box(int x, int y, int w, int h, int &X, int &Y, int &W, int &H) FL_OVERRIDE;
   int not_clipped(int x, int y, int w, int h) FL_OVERRIDE;
   void restore_clip() FL_OVERRIDE;
+  void begin_points() FL_OVERRIDE;
+  void begin_line() FL_OVERRIDE;
+  void begin_loop() FL_OVERRIDE;
+  void begin_polygon() FL_OVERRIDE;
+  void begin_complex_polygon() FL_OVERRIDE;
   void end_points() FL_OVERRIDE;
   void end_line() FL_OVERRIDE;
   void end_loop() FL_OVERRIDE;
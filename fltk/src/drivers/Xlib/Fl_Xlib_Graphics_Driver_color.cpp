@@ -35,6 +35,7 @@
 #  include "../../../hdr/Fl.h"
 #  include "../../../hdr/platform.h"
 #  include "../../../hdr/fl_draw.h"
+#  include <string.h>
 
 extern unsigned fl_cmap[256]; // defined in fl_color.cxx
 
@@ -112,14 +113,130 @@ void Fl_Xlib_Graphics_Driver::color(uchar r,uchar g,uchar b) {
   XSetForeground(fl_display, gc_, fl_xpixel_rgb(r,g,b));
 }
 
+#  if USE_COLORMAP
+////////////////////////////////////////////////////////////////
+// Colormapped visuals.
+//
+// The colormap is read once with XQueryColors() into a mirror, and the
+// cell used for a color is looked up there through a 32x32x32 cube, so
+// after a few calls fl_color() no longer talks to the server.
+//
+// For visuals with a writable colormap (PseudoColor, GrayScale), all
+// entries of fl_cmap (the standard colors, the gray ramp and the color
+// cube the image code dithers with) get cells of their own, allocated and
+// stored with one XAllocColorCells() and one XStoreColors() request.
+// Entries left without a cell, if the colormap is short of cells, get
+// their exact color with XAllocColor() as long as that works. Other colors
+// use the closest cell; a cell first used that way is allocated once with
+// XAllocColor() so that its color can't change when the client that owns
+// it exits. The colors of static visuals can't change, so they are never
+// allocated.
+
+struct Mirror_Cell {
+  uchar r, g, b;
+  uchar ready;          // pixel can be used
+  unsigned long pixel;  // X pixel showing this color
+};
+
+static Mirror_Cell *mirror;     // one per colormap cell
+static int numcolors;
+static short *cell_cube;        // 32x32x32 -> closest cell, -1 = unknown
+static char alloc_failed;       // XAllocColor() of an exact color failed
+
+// Allocates the colors of fl_cmap, or as many of them as there are free
+// cells for.
+static void preallocate_colors(Colormap colormap) {
+  const int n_all = 256;
+  unsigned long pixels[n_all];
+  int n = n_all;
+  while (n > 0 && !XAllocColorCells(fl_display, colormap, False, 0, 0, pixels, n))
+    n /= 2;
+  if (!n) return;
+  XColor defs[n_all];
+  for (int k = 0; k < n; k++) {
+    unsigned c = fl_cmap[k];
+    uchar r = uchar(c >> 24), g = uchar(c >> 16), b = uchar(c >> 8);
+    defs[k].pixel = pixels[k];
+    defs[k].red = r<<8 | r; defs[k].green = g<<8 | g; defs[k].blue = b<<8 | b;
+    defs[k].flags = DoRed | DoGreen | DoBlue;
+    Fl_XColor &xmap = fl_xmap[Fl_Xlib_Graphics_Driver::fl_overlay][k];
+    xmap.mapped = 2; // 2 prevents XFreeColor from being called
+    xmap.pixel = pixels[k];
+    xmap.r = r; xmap.g = g; xmap.b = b;
+    if (pixels[k] < (unsigned long)numcolors) {
+      Mirror_Cell &m = mirror[pixels[k]];
+      m.r = r; m.g = g; m.b = b;
+      m.ready = 1;
+    }
+  }
+  XStoreColors(fl_display, colormap, defs, n);
+}
+
+static void mirror_colormap() {
+  numcolors = fl_visual->colormap_size;
+  if (numcolors > 0x7FFF) numcolors = 0x7FFF; // cell_cube holds shorts
+  XColor *all = new XColor[numcolors];
+  for (int p = numcolors; p--;) all[p].pixel = p;
+  XQueryColors(fl_display, fl_colormap, all, numcolors);
+  int writable = (fl_visual->c_class == PseudoColor || fl_visual->c_class == GrayScale);
+  mirror = new Mirror_Cell[numcolors];
+  for (int p = numcolors; p--;) {
+    mirror[p].r = all[p].red >> 8;
+    mirror[p].g = all[p].green >> 8;
+    mirror[p].b = all[p].blue >> 8;
+    mirror[p].ready = !writable;
+    mirror[p].pixel = p;
+  }
+  delete[] all;
+  cell_cube = new short[32 * 32 * 32];
+  memset(cell_cube, 0xFF, 32 * 32 * 32 * sizeof(short));
+  if (writable) preallocate_colors(fl_colormap);
+  else alloc_failed = 1;        // static colors are never allocated
+}
+
+// Returns the colormap cell showing the color closest to r,g,b.
+static int closest_cell(uchar r, uchar g, uchar b) {
+  if (!mirror) mirror_colormap();
+  short &cell = cell_cube[(r >> 3) << 10 | (g >> 3) << 5 | (b >> 3)];
+  if (cell >= 0) return cell;
+  // least-squares match for the middle of the cube entry:
+  int cr = (r & 0xF8) | 4, cg = (g & 0xF8) | 4, cb = (b & 0xF8) | 4;
+  int mindist = 0x7FFFFFFF, best = 0;
+  for (int n = numcolors; n--;) {
+    Mirror_Cell &a = mirror[n];
+    int d, t;
+    t = cr - a.r; d = t*t;
+    t = cg - a.g; d += t*t;
+    t = cb - a.b; d += t*t;
+    if (d < mindist || (d == mindist && a.ready)) {best = n; mindist = d;}
+  }
+  Mirror_Cell &c = mirror[best];
+  if (!c.ready) {
+    // It appears to "work" to not call this XAllocColor, which will
+    // avoid another round-trip to the server.  But then X does not
+    // know that this program "owns" this value, and can (and will)
+    // change it when the program that did allocate it exits.
+    // If XAllocColor fails, which some X servers always do when the
+    // colormap is full, the pixel is assumed to be ok for the duration
+    // of the program.
+    XColor xcol;
+    xcol.red = c.r << 8; xcol.green = c.g << 8; xcol.blue = c.b << 8;
+    if (XAllocColor(fl_display, fl_colormap, &xcol)) {
+      c.pixel = xcol.pixel;
+      c.r = xcol.red >> 8; c.g = xcol.green >> 8; c.b = xcol.blue >> 8;
+    }
+    c.ready = 1;
+  }
+  return cell = (short)best;
+}
+#  endif // USE_COLORMAP
+
 /** \addtogroup  fl_attributes
     @{ */
 ////////////////////////////////////////////////////////////////
 // Get an rgb color.  This is easy for a truecolor visual.  For
-// colormapped it picks the closest color out of the cube in the
-// fltk colormap.  However if this color cube entry has been
-// requested before, you will get the earlier requested color, and
-// even this may be approximated if the X colormap was full.
+// colormapped it picks the closest color in the X colormap, see
+// closest_cell().
 
 /**
   Returns the X pixel number used to draw the given rgb color.
@@ -131,17 +248,18 @@ ulong fl_xpixel_rgb(uchar r,uchar g,uchar b) {
   if (!beenhere) figure_out_visual();
 #  if USE_COLORMAP
   if (!fl_redmask) {
-    // find closest entry in the colormap:
+    // the image code dithers with the color cube entries:
     Fl_Color i =
       fl_color_cube(r*FL_NUM_RED/256,g*FL_NUM_GREEN/256,b*FL_NUM_BLUE/256);
-    Fl_XColor &xmap = fl_xmap[Fl_Xlib_Graphics_Driver::fl_overlay][i];
-    if (xmap.mapped) return xmap.pixel;
-    // if not black or white, change the entry to be an exact match:
-    if (i != FL_COLOR_CUBE && i != 0xFF)
-    {
+    if (!mirror) mirror_colormap();
+    if (!fl_xmap[Fl_Xlib_Graphics_Driver::fl_overlay][i].mapped) {
+      // a cube entry without a cell: if not black or white, change the
+      // entry to be an exact match
+      if (i != FL_COLOR_CUBE && i != 0xFF)
         fl_cmap[i] = (r << 24) | (g << 16) | (b << 8);
+      return fl_xpixel(i); // allocate an X color
     }
-    return fl_xpixel(i); // allocate an X color
+    return mirror[closest_cell(r, g, b)].pixel;
   }
 #  endif
   return
@@ -153,9 +271,8 @@ ulong fl_xpixel_rgb(uchar r,uchar g,uchar b) {
 
 ////////////////////////////////////////////////////////////////
 // Get a color out of the fltk colormap.  Again for truecolor
-// visuals this is easy.  For colormap this actually tries to allocate
-// an X color, and does a least-squares match to find the closest
-// color if X cannot allocate that color.
+// visuals this is easy.  For colormap this uses the cell allocated by
+// preallocate_colors() or the closest color in the X colormap.
 
 // calculate what color is actually on the screen for a mask:
 static inline uchar realcolor(uchar color, uchar mask) {
@@ -202,7 +319,6 @@ ulong fl_xpixel(Fl_Color i) {
   {unsigned c = fl_cmap[i]; r = uchar(c >> 24); g = uchar(c >> 16); b = uchar(c >> 8); }
 
 #  if USE_COLORMAP
-  Colormap colormap = fl_colormap;
   if (fl_redmask) {
 #  endif
     // return color for a truecolor visual:
@@ -217,66 +333,34 @@ ulong fl_xpixel(Fl_Color i) {
        ) >> fl_extrashift;
 #  if USE_COLORMAP
   }
-  static XColor *allcolors;
-  static int numcolors;
-
+  if (!mirror) mirror_colormap();
+  if (xmap.mapped) return xmap.pixel; // one of the preallocated colors
   // I don't try to allocate colors with XAllocColor once it fails
-  // with any color.  It is possible that it will work, since a color
-  // may have been freed, but some servers are extremely slow and this
-  // avoids one round trip:
-  if (!numcolors) { // don't try after a failure
+  // with any color, some servers are extremely slow to say no:
+  if (!alloc_failed) {
     XColor xcol;
-    xcol.red = r<<8; xcol.green = g<<8; xcol.blue = b<<8;
-    if (XAllocColor(fl_display, colormap, &xcol)) {
-      xmap.mapped = 1;
-      xmap.r = xcol.red>>8;
-      xmap.g = xcol.green>>8;
-      xmap.b = xcol.blue>>8;
+    xcol.red = r<<8 | r; xcol.green = g<<8 | g; xcol.blue = b<<8 | b;
+    if (XAllocColor(fl_display, fl_colormap, &xcol)) {
+      xmap.mapped = 2; // the mirror may use the cell, so it is never freed
+      xmap.r = xcol.red >> 8;
+      xmap.g = xcol.green >> 8;
+      xmap.b = xcol.blue >> 8;
+      if (xcol.pixel < (unsigned long)numcolors) { // closest_cell() may use it now
+        Mirror_Cell &m = mirror[xcol.pixel];
+        m.r = xmap.r; m.g = xmap.g; m.b = xmap.b;
+        m.ready = 1;
+        memset(cell_cube, 0xFF, 32 * 32 * 32 * sizeof(short));
+      }
       return xmap.pixel = xcol.pixel;
     }
-
-    // I only read the colormap once.  Again this is due to the slowness
-    // of round-trips to the X server, even though other programs may alter
-    // the colormap after this and make decisions here wrong.
-    numcolors = fl_visual->colormap_size;
-    if (!allcolors) allcolors = new XColor[numcolors];
-    for (int p = numcolors; p--;) allcolors[p].pixel = p;
-    XQueryColors(fl_display, colormap, allcolors, numcolors);
-  }
-
-  // find least-squares match:
-  int mindist = 0x7FFFFFFF;
-  unsigned int bestmatch = 0;
-  for (unsigned int n = numcolors; n--;) {
-    XColor &a = allcolors[n];
-    int d, t;
-    t = int(r)-int(a.red>>8); d = t*t;
-    t = int(g)-int(a.green>>8); d += t*t;
-    t = int(b)-int(a.blue>>8); d += t*t;
-    if (d <= mindist) {bestmatch = n; mindist = d;}
-  }
-  XColor &p = allcolors[bestmatch];
-
-  // It appears to "work" to not call this XAllocColor, which will
-  // avoid another round-trip to the server.  But then X does not
-  // know that this program "owns" this value, and can (and will)
-  // change it when the program that did allocate it exits:
-  if (XAllocColor(fl_display, colormap, &p)) {
-    xmap.mapped = 1;
-    xmap.pixel = p.pixel;
-  } else {
-    // However, if that XAllocColor fails, I have to give up and
-    // assume the pixel is ok for the duration of the program.  This
-    // is due to bugs (?) in the Solaris X and some X terminals
-    // where XAllocColor *always* fails when the colormap is full,
-    // even if we ask for a color already in it...
-    xmap.mapped = 2; // 2 prevents XFreeColor from being called
-    xmap.pixel = bestmatch;
+    alloc_failed = 1;
   }
-  xmap.r = p.red>>8;
-  xmap.g = p.green>>8;
-  xmap.b = p.blue>>8;
-  return xmap.pixel;
+  Mirror_Cell &c = mirror[closest_cell(r, g, b)];
+  xmap.mapped = 2; // 2 prevents XFreeColor from being called
+  xmap.r = c.r;
+  xmap.g = c.g;
+  xmap.b = c.b;
+  return xmap.pixel = c.pixel;
 #  endif
 }
 
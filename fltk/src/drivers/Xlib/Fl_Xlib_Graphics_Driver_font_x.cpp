@@ -22,9 +22,16 @@
 #include "../../../hdr/platform.h"
 #include "../../../hdr/fl_string_functions.h"
 #include "Fl_Font.h"
+#include "../../Fl_Memory.h"
+
+#include "../../../hdr/fl_utf8.h"
+#include "../../../hdr/filename.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 static char* fl_find_fontsize(char* name);
 static const char* fl_font_word(const char* p, int n);
@@ -264,6 +271,11 @@ static int ultrasort(const void *aa, const void *bb) {
 }
 }
 
+// Sorts a list of X font names the way set_fonts() expects them
+static void sort_font_list(char **list, int count) {
+  qsort(list, count, sizeof(*list), ultrasort);
+}
+
 // converts a X font name to a standard starname, returns point size:
 static int to_canonical(char *to, const char *from, size_t tolen) {
   char* c = fl_find_fontsize((char*)from);
@@ -287,26 +299,151 @@ static int to_canonical(char *to, const char *from, size_t tolen) {
   return size;
 }
 
-static unsigned int fl_free_font = FL_FREE_FONT;
+////////////////////////////////////////////////////////////////
+// Font list cache.
+//
+// Listing all fonts of a remote X server is slow, so set_fonts() keeps
+// the result of XListFonts() in a file of the user's cache directory.
+// The file is used when it was made for the same server vendor and
+// release, font path, pattern and encoding, which costs only an
+// XGetFontPath() round trip to check. A cache older than a day is used
+// once more and rewritten a few seconds after set_fonts(). This runs on
+// the main thread, because Xlib is not safe to use from another thread
+// unless XInitThreads() was called before the display was opened.
+// The cached list goes through the same sorting and grouping as the
+// live one, so the font table is the same.
+
+#define FONT_CACHE_MAGIC "FLTK X font cache 1"
+#define FONT_CACHE_MAX_AGE (24 * 60 * 60) // seconds
+#define FONT_CACHE_PATH_MAX (FL_PATH_MAX + 64) // room for the file name after the directory
+
+// The key of the cached list: one line, with tabs between the fields.
+static char *font_cache_key(Display *d, const char *xstarname) {
+  int npath = 0;
+  char **path = XGetFontPath(d, &npath);
+  char release[20];
+  snprintf(release, sizeof(release), "%d", VendorRelease(d));
+  const char *vendor = ServerVendor(d);
+  size_t len = strlen(vendor) + strlen(release) + strlen(xstarname) + strlen(fl_encoding) + 5;
+  for (int i = 0; i < npath; i++) len += strlen(path[i]) + 1;
+  char *key = (char*)malloc(len);
+  snprintf(key, len, "%s\t%s\t%s\t%s\t", vendor, release, xstarname, fl_encoding);
+  for (int i = 0; i < npath; i++) {
+    strlcat(key, path[i], len);
+    if (i < npath-1) strlcat(key, ",", len);
+  }
+  for (char *p = key; *p; p++) if (*p == '\n') *p = ' ';
+  if (path) XFreeFontPath(path);
+  return key;
+}
 
+// The cache file of a display: $XDG_CACHE_HOME/fltk/xfonts-HOST-N,
+// empty if there is no cache directory or the name does not fit
+static void font_cache_file(const char *display_name, char *to, size_t tolen) {
+  const char *dir = fl_getenv("XDG_CACHE_HOME");
+  char home_cache[FL_PATH_MAX];
+  *to = 0;
+  if (!dir || !*dir) {
+    const char *home = fl_getenv("HOME");
+    if (!home || !*home) return;
+    int n = snprintf(home_cache, sizeof(home_cache), "%s/.cache", home);
+    if (n < 0 || n >= (int)sizeof(home_cache)) return;
+    dir = home_cache;
+  }
+  int n = snprintf(to, tolen, "%s/fltk/xfonts-", dir);
+  if (n < 0 || n + strlen(display_name) >= tolen) { *to = 0; return; }
+  for (const char *p = display_name; *p; p++) // ':' and '/' make bad file names
+    to[n++] = (*p == ':' || *p == '/') ? '-' : *p;
+  to[n] = 0;
+}
 
-// This function fills in the fltk font table with all the fonts that
-// are found on the X server.  It tries to place the fonts into families
-// and to sort them so the first 4 in a family are normal, bold, italic,
-// and bold italic.
-Fl_Font Fl_Xlib_Graphics_Driver::set_fonts(const char* xstarname) {
-  if (fl_free_font > (unsigned)FL_FREE_FONT) // already been here
-    return (Fl_Font)fl_free_font;
-  fl_open_display();
-  int xlistsize;
-  char buf[20];
-  if (!xstarname) {
-    strcpy(buf,"-*-"); strcpy(buf+3,fl_encoding);
-    xstarname = buf;
+// Returns the cached font names or NULL; the names and the array are one
+// allocation that is never freed, like the list of XListFonts().
+static char **read_font_cache(const char *file, const char *key, int &count, int &stale) {
+  FILE *f = fl_fopen(file, "rb");
+  if (!f) return 0;
+  struct stat st;
+  if (fstat(fileno(f), &st) || st.st_size <= 0) { fclose(f); return 0; }
+  char *buf = (char*)malloc(st.st_size + 1);
+  size_t len = fread(buf, 1, st.st_size, f);
+  fclose(f);
+  buf[len] = 0;
+  stale = (time(0) - st.st_mtime > FONT_CACHE_MAX_AGE);
+  // header: magic, key and count lines
+  char *lines[3], *p = buf;
+  for (int i = 0; i < 3; i++) {
+    char *e = strchr(p, '\n');
+    if (!e) { free(buf); return 0; }
+    *e = 0; lines[i] = p; p = e + 1;
+  }
+  count = atoi(lines[2]);
+  // every name takes at least its newline, so a larger count is corrupt
+  if (strcmp(lines[0], FONT_CACHE_MAGIC) || strcmp(lines[1], key) ||
+      count <= 0 || (size_t)count > len - (p - buf)) {
+    free(buf);
+    return 0;
   }
-  char **xlist = XListFonts(fl_display, xstarname, 10000, &xlistsize);
-  if (!xlist) return (Fl_Font)fl_free_font;
-  qsort(xlist, xlistsize, sizeof(*xlist), ultrasort);
+  size_t names = len - (p - buf) + 1;
+  char **list = (char**)malloc(count * sizeof(char*) + names);
+  char *q = (char*)(list + count);
+  memcpy(q, p, names);
+  free(buf);
+  for (int i = 0; i < count; i++) {
+    char *e = strchr(q, '\n');
+    if (!e) { free(list); return 0; } // truncated
+    *e = 0; list[i] = q; q = e + 1;
+  }
+  return list;
+}
+
+// Writes the list to a temporary file renamed over the cache file,
+// so that readers never see a partial file.
+static void write_font_cache(const char *file, const char *key, char **list, int count) {
+  if (!*file) return;
+  char tmp[FONT_CACHE_PATH_MAX + 16];
+  int n = snprintf(tmp, sizeof(tmp), "%s.%d", file, (int)getpid());
+  if (n < 0 || n >= (int)sizeof(tmp)) return;
+  fl_make_path_for_file(file);
+  FILE *f = fl_fopen(tmp, "wb");
+  if (!f) return;
+  fprintf(f, "%s\n%s\n%d\n", FONT_CACHE_MAGIC, key, count);
+  for (int i = 0; i < count; i++) fprintf(f, "%s\n", list[i]);
+  if (fclose(f) || rename(tmp, file)) fl_unlink(tmp);
+}
+
+#define FONT_CACHE_REFRESH_DELAY 5.0 // seconds after set_fonts()
+
+// A stale cache file to rewrite, with the pattern it was made for
+struct Font_Cache_Refresh {
+  char *xstarname, *file;
+};
+
+// Rewrites a stale cache file from the list of the open display.
+static void font_cache_refresh(void *data) {
+  Font_Cache_Refresh *r = (Font_Cache_Refresh*)data;
+  if (fl_display) {
+    int count = 0;
+    char **list = XListFonts(fl_display, r->xstarname, 10000, &count);
+    if (list) {
+      sort_font_list(list, count);
+      char *key = font_cache_key(fl_display, r->xstarname);
+      write_font_cache(r->file, key, list, count);
+      free(key);
+      XFreeFontNames(list);
+    }
+  }
+  free(r->xstarname);
+  free(r->file);
+  delete r;
+}
+
+static unsigned int fl_free_font = FL_FREE_FONT;
+
+
+// Adds the fonts of a sorted list of X font names to the fltk font table,
+// one entry per family. Returns non-zero if the table uses the list, which
+// must then be kept.
+static int add_font_families(char **xlist, int xlistsize) {
   int used_xlist = 0;
   for (int i=0; i<xlistsize;) {
     int first_xlist = i;
@@ -338,13 +475,52 @@ Fl_Font Fl_Xlib_Graphics_Driver::set_fonts(const char* xstarname) {
       }
     }
     Fl_Xlib_Fontdesc *s = ((Fl_Xlib_Fontdesc*)fl_fonts)+j;
-    if (!s->xlist) {
+    if (!s->xlist) { // get_font_sizes() reads the sizes from here
       s->xlist = xlist+first_xlist;
       s->n = -(i-first_xlist);
       used_xlist = 1;
     }
   }
-  if (!used_xlist) XFreeFontNames(xlist);
+  return used_xlist;
+}
+
+// This function fills in the fltk font table with all the fonts that
+// are found on the X server.  It tries to place the fonts into families
+// and to sort them so the first 4 in a family are normal, bold, italic,
+// and bold italic. The list of fonts comes from the font list cache
+// when it is valid.
+Fl_Font Fl_Xlib_Graphics_Driver::set_fonts(const char* xstarname) {
+  if (fl_free_font > (unsigned)FL_FREE_FONT) // already been here
+    return (Fl_Font)fl_free_font;
+  fl_open_display();
+  int xlistsize;
+  char buf[20];
+  if (!xstarname) {
+    strcpy(buf,"-*-"); strcpy(buf+3,fl_encoding);
+    xstarname = buf;
+  }
+  char *key = font_cache_key(fl_display, xstarname);
+  char file[FONT_CACHE_PATH_MAX];
+  font_cache_file(DisplayString(fl_display), file, sizeof(file));
+  int stale = 0;
+  char **xlist = *file ? read_font_cache(file, key, xlistsize, stale) : 0;
+  if (xlist) { // already sorted
+    if (!add_font_families(xlist, xlistsize)) free(xlist);
+    if (stale) {
+      Font_Cache_Refresh *r = new Font_Cache_Refresh;
+      r->xstarname = fl_strdup(xstarname);
+      r->file = fl_strdup(file);
+      Fl::add_timeout(FONT_CACHE_REFRESH_DELAY, font_cache_refresh, r);
+    }
+  } else {
+    xlist = XListFonts(fl_display, xstarname, 10000, &xlistsize);
+    if (xlist) {
+      sort_font_list(xlist, xlistsize);
+      write_font_cache(file, key, xlist, xlistsize);
+      if (!add_font_families(xlist, xlistsize)) XFreeFontNames(xlist);
+    }
+  }
+  free(key);
   return (Fl_Font)fl_free_font;
 }
 
@@ -384,12 +560,32 @@ int Fl_Xlib_Graphics_Driver::get_font_sizes(Fl_Font fnum, int*& sizep) {
 
 #ifndef FL_DOXYGEN
 
+// Bytes held by a descriptor: the client side copies of the X font
+// structures, their per character metrics and properties.
+static long font_bytes(const XUtf8FontStruct *fs) {
+  long n = sizeof(Fl_Xlib_Font_Descriptor);
+  if (!fs) return n;
+  n += sizeof(XUtf8FontStruct);
+  n += fs->nb_font * (long)(sizeof(char*) + 3 * sizeof(int) + sizeof(XFontStruct*));
+  for (int i = 0; i < fs->nb_font; i++) {
+    const XFontStruct *f = fs->fonts[i];
+    if (!f) continue;
+    n += sizeof(XFontStruct) + f->n_properties * (long)sizeof(XFontProp);
+    if (f->per_char)
+      n += (long)(f->max_char_or_byte2 - f->min_char_or_byte2 + 1) *
+           (f->max_byte1 - f->min_byte1 + 1) * (long)sizeof(XCharStruct);
+    if (fs->font_name_list[i]) n += strlen(fs->font_name_list[i]) + 1;
+  }
+  return n;
+}
+
 Fl_Xlib_Font_Descriptor::Fl_Xlib_Font_Descriptor(const char* name) : Fl_Font_Descriptor(name, 0) {
   font = XCreateUtf8FontStruct(fl_display, name);
   if (!font) {
     Fl::warning("bad font: %s", name);
     font = XCreateUtf8FontStruct(fl_display, "fixed");
   }
+  fl_memory_account(FL_MEMORY_FONTS, font_bytes(font));
 #  if HAVE_GL
   listbase = 0;
   for (int u = 0; u < 64; u++) glok[u] = 0;
@@ -408,6 +604,7 @@ Fl_Xlib_Font_Descriptor::~Fl_Xlib_Font_Descriptor() {
     fl_graphics_driver->font_descriptor(NULL);
     fl_xfont = 0;
   }
+  fl_memory_account(FL_MEMORY_FONTS, -font_bytes(font));
   XFreeUtf8FontStruct(fl_display, font);
 }
 
@@ -55,6 +55,9 @@
 #  include "../../Fl_Screen_Driver.h"
 #  include "../../Fl_XColor.h"
 #  include "../../flstring.h"
+#  include "../../Fl_Memory.h"
+#  include "../../../hdr/Fl_Task_Pool.h"
+#  include "../../../hdr/mymath.h"
 #if HAVE_XRENDER
 #  include <X11/extensions/Xrender.h>
 #  if RENDER_MAJOR * 100 + RENDER_MAJOR < 10
@@ -469,6 +472,17 @@ static void figure_out_visual() {
 
 #  define MAXBUFFER 0x40000 // 256k
 
+static STORETYPE *buffer;   // our storage, always word aligned
+static long buffer_size;
+
+// Called by Fl::memory_trim(): the buffer is allocated again by the next innards()
+static void trim_buffer() {
+  fl_memory_account(FL_MEMORY_CONVERT, -(long)(buffer_size * sizeof(STORETYPE)));
+  delete[] buffer;
+  buffer = 0;
+  buffer_size = 0;
+}
+
 static void innards(const uchar *buf, int X, int Y, int W, int H,
                     int delta, int linedelta, int mono,
                     Fl_Draw_Image_Cb cb, void* userdata,
@@ -528,8 +542,6 @@ static void innards(const uchar *buf, int X, int Y, int W, int H,
   } else {
     int linesize = ((w*bytes_per_pixel+scanline_add)&scanline_mask)/sizeof(STORETYPE);
     int blocking = h;
-    static STORETYPE *buffer;   // our storage, always word aligned
-    static long buffer_size;
     {int size = linesize*h;
     if (size > MAXBUFFER) {
       size = MAXBUFFER;
@@ -537,6 +549,8 @@ static void innards(const uchar *buf, int X, int Y, int W, int H,
     }
     if (size > buffer_size) {
       delete[] buffer;
+      fl_memory_account(FL_MEMORY_CONVERT, (long)((size - buffer_size) * sizeof(STORETYPE)));
+      if (!buffer_size) fl_memory_trim_handler(trim_buffer);
       buffer_size = size;
       buffer = new STORETYPE[size];
     }}
@@ -729,6 +743,238 @@ static void alpha_blend(Fl_RGB_Image *img, int X, int Y, int W, int H, int cx, i
   delete[] dst;
 }
 
+////////////////////////////////////////////////////////////////
+// Scaled forms of Fl_RGB_Image objects drawn without XRender.
+//
+// The scaled pixmap (opaque images) or scaled pixels (images with alpha,
+// which are blended on each draw) are made once per target size and kept
+// in the image's id_ and mask_ slots. All scaled forms are in a list in
+// the order they were last drawn; the least recently drawn ones are
+// released when the list holds more than SCALED_BUDGET bytes.
+
+#define SCALED_BUDGET (32L * 1024 * 1024)
+
+struct Scaled_Form {
+  Fl_RGB_Image *owner;
+  Fl_RGB_Image *pixels;         // scaled copy of an image with alpha, or NULL
+  long bytes;
+  Scaled_Form *prev, *next;     // most recently drawn first
+};
+
+static Scaled_Form *scaled_first, *scaled_last;
+static long scaled_bytes;
+
+static void scaled_unlink(Scaled_Form *f) {
+  if (f->prev) f->prev->next = f->next; else scaled_first = f->next;
+  if (f->next) f->next->prev = f->prev; else scaled_last = f->prev;
+}
+
+static void scaled_push_front(Scaled_Form *f) {
+  f->prev = 0;
+  f->next = scaled_first;
+  if (scaled_first) scaled_first->prev = f; else scaled_last = f;
+  scaled_first = f;
+}
+
+static void scaled_trim() {
+  while (scaled_last) scaled_last->owner->uncache();
+}
+
+// Weights of the source pixels that make a destination pixel, for one axis:
+// taps[first[i] .. first[i+1]) are (source index, weight / 2^14) pairs.
+struct Scale_Axis {
+  int max_taps;
+  int *first;
+  int *index;
+  int *weight;
+  void init(int src, int dst, int nearest);
+  ~Scale_Axis() { delete[] first; delete[] index; delete[] weight; }
+};
+
+void Scale_Axis::init(int src, int dst, int nearest) {
+  double step = double(src) / dst;
+  max_taps = (dst < src ? int(step) + 2 : 2);
+  first = new int[dst + 1];
+  index = new int[dst * max_taps];
+  weight = new int[dst * max_taps];
+  int n = 0;
+  for (int i = 0; i < dst; i++) {
+    first[i] = n;
+    if (nearest) {
+      int s = int((i + 0.5) * step);
+      index[n] = s < src ? s : src - 1; weight[n++] = 1 << 14;
+    } else if (dst < src) { // box filter: average of the covered source pixels
+      double a = i * step, b = a + step;
+      int total = 0;
+      for (int s = int(a); s < b && s < src; s++) {
+        double lo = s > a ? s : a, hi = s + 1 < b ? s + 1 : b;
+        int w = int((hi - lo) / step * (1 << 14) + 0.5);
+        if (w <= 0) continue;
+        index[n] = s; weight[n++] = w; total += w;
+      }
+      weight[n-1] += (1 << 14) - total; // exact sum
+    } else { // bilinear
+      double c = (i + 0.5) * step - 0.5;
+      int s = int(::floor(c));
+      int w = int((c - s) * (1 << 14) + 0.5);
+      int s0 = s < 0 ? 0 : s, s1 = s + 1 < src ? s + 1 : src - 1;
+      index[n] = s0; weight[n++] = (1 << 14) - w;
+      index[n] = s1; weight[n++] = w;
+    }
+  }
+  first[dst] = n;
+}
+
+// Resamples rows [from, to) of the destination, horizontally then vertically.
+struct Scale_Band : public Fl_Task {
+  const uchar *src;
+  int ld, d, sw;
+  uchar *dst;
+  int dw;
+  const Scale_Axis *ax, *ay;
+  int from, to;
+  void run();
+};
+
+// The horizontal pass of the last ay->max_taps source rows is kept, so
+// each source row is resampled once per band.
+void Scale_Band::run() {
+  int row_bytes = dw * d;
+  int slots = ay->max_taps, next = 0;
+  int *acc = new int[row_bytes];
+  uchar *lines = new uchar[slots * row_bytes];
+  int *tags = new int[slots];
+  for (int k = 0; k < slots; k++) tags[k] = -1;
+  for (int y = from; y < to; y++) {
+    memset(acc, 0, row_bytes * sizeof(int));
+    for (int ty = ay->first[y]; ty < ay->first[y+1]; ty++) {
+      int sy = ay->index[ty], k;
+      for (k = 0; k < slots && tags[k] != sy; k++) {}
+      uchar *line;
+      if (k < slots) {
+        line = lines + k * row_bytes;
+      } else { // horizontal pass of this source row
+        k = next; next = (next + 1) % slots;
+        tags[k] = sy;
+        line = lines + k * row_bytes;
+        const uchar *s = src + (long)sy * ld;
+        for (int x = 0; x < dw; x++) {
+          for (int c = 0; c < d; c++) {
+            int v = 0;
+            for (int tx = ax->first[x]; tx < ax->first[x+1]; tx++)
+              v += s[ax->index[tx] * d + c] * ax->weight[tx];
+            line[x * d + c] = (uchar)((v + (1 << 13)) >> 14);
+          }
+        }
+      }
+      int wy = ay->weight[ty];
+      for (int i = 0; i < row_bytes; i++) acc[i] += line[i] * wy;
+    }
+    uchar *q = dst + (long)y * row_bytes;
+    for (int i = 0; i < row_bytes; i++) {
+      int v = (acc[i] + (1 << 13)) >> 14;
+      q[i] = (uchar)(v > 255 ? 255 : v);
+    }
+  }
+  delete[] tags;
+  delete[] lines;
+  delete[] acc;
+}
+
+#define SCALE_MAX_BANDS 8
+#define SCALE_PARALLEL_MIN (128 * 128) // destination pixels
+
+// Returns a copy of img scaled to W x H, made with fixed-point box (when
+// shrinking) or bilinear filters, or nearest neighbour if that is the
+// Fl_Image::scaling_algorithm(). Large images are scaled in row bands on
+// the threads of Fl_Task_Pool::shared().
+static Fl_RGB_Image *scale_rgb(Fl_RGB_Image *img, int W, int H) {
+  int d = img->d(), sw = img->data_w(), sh = img->data_h();
+  int nearest = (Fl_Image::scaling_algorithm() == FL_RGB_SCALING_NEAREST);
+  Scale_Axis ax, ay;
+  ax.init(sw, W, nearest);
+  ay.init(sh, H, nearest);
+  uchar *array = new uchar[(long)W * H * d];
+  int nbands = 1;
+  Fl_Task_Pool *pool = 0;
+  if ((long)W * H >= SCALE_PARALLEL_MIN) {
+    pool = Fl_Task_Pool::shared();
+    nbands = pool->threads() + 1;
+    if (nbands > SCALE_MAX_BANDS) nbands = SCALE_MAX_BANDS;
+    if (nbands > H) nbands = H;
+  }
+  Scale_Band bands[SCALE_MAX_BANDS];
+  for (int b = 0; b < nbands; b++) {
+    Scale_Band &t = bands[b];
+    t.src = img->array; t.ld = img->ld() ? img->ld() : sw * d; t.d = d; t.sw = sw;
+    t.dst = array; t.dw = W;
+    t.ax = &ax; t.ay = &ay;
+    t.from = H * b / nbands; t.to = H * (b + 1) / nbands;
+    t.auto_delete(0);
+    t.priority(FL_TASK_HIGH);
+  }
+  for (int b = 1; b < nbands; b++) pool->submit(&bands[b]);
+  bands[0].run();
+  // bands that no worker has started, e.g. because all are busy with
+  // long tasks, are run here by join()
+  for (int b = nbands - 1; b > 0; b--) pool->join(&bands[b]);
+  Fl_RGB_Image *img2 = new Fl_RGB_Image(array, W, H, d);
+  img2->alloc_array = 1;
+  return img2;
+}
+
+// Draws img scaled to its drawing size from a cached scaled form.
+void Fl_Xlib_Graphics_Driver::draw_rgb_scaled_(Fl_RGB_Image *img, int XP, int YP, int WP, int HP, int cx, int cy) {
+  int need_scaled_drawing = img->d() && img->array &&
+                            ( fabs(img->w() - img->data_w()/scale())/img->w() > 0.05 ||
+                              fabs(img->h() - img->data_h()/scale())/img->h() > 0.05 );
+  if (!need_scaled_drawing) {
+    Fl_Graphics_Driver::draw_rgb(img, XP, YP, WP, HP, cx, cy);
+    return;
+  }
+  if (start_image(img, XP, YP, WP, HP, cx, cy, XP, YP, WP, HP)) {
+    return;
+  }
+  int w2 = img->w(), h2 = img->h();
+  cache_size(img, w2, h2); // after this, w2 x h2 is desired cached image size
+  int *pw, *ph;
+  cache_w_h(img, pw, ph);
+  Scaled_Form *f = (Scaled_Form*)*Fl_Graphics_Driver::mask(img);
+  if ((f || *Fl_Graphics_Driver::id(img)) && (!f || *pw != w2 || *ph != h2)) {
+    img->uncache();
+    f = 0;
+  }
+  if (f) {
+    scaled_unlink(f);
+  } else {
+    Fl_RGB_Image *img2 = scale_rgb(img, w2, h2);
+    f = new Scaled_Form;
+    f->owner = img;
+    if (img->d() == 1 || img->d() == 3) {
+      f->pixels = 0;
+      cache(img2);
+      *Fl_Graphics_Driver::id(img) = *Fl_Graphics_Driver::id(img2);
+      *Fl_Graphics_Driver::id(img2) = 0;
+      delete img2;
+      f->bytes = fl_offscreen_bytes(w2, h2);
+      // counted in FL_MEMORY_IMAGE_CACHE here and by Fl_RGB_Image::uncache()
+      if (*Fl_Graphics_Driver::id(img)) fl_memory_account(FL_MEMORY_IMAGE_CACHE, f->bytes);
+    } else {
+      f->pixels = img2;
+      f->bytes = (long)w2 * h2 * img->d();
+      fl_memory_account(FL_MEMORY_IMAGE_CACHE, f->bytes);
+    }
+    *pw = w2; *ph = h2;
+    *Fl_Graphics_Driver::mask(img) = (fl_uintptr_t)f;
+    if (!scaled_first) fl_memory_trim_handler(scaled_trim);
+    scaled_bytes += f->bytes;
+  }
+  scaled_push_front(f);
+  while (scaled_bytes > SCALED_BUDGET && scaled_last != f)
+    scaled_last->owner->uncache();
+  draw_fixed(f->pixels ? f->pixels : img, XP, YP, WP, HP, cx, cy);
+}
+
 void Fl_Xlib_Graphics_Driver::cache(Fl_RGB_Image *img) {
   Fl_Image_Surface *surface;
   int depth = img->d();
@@ -784,11 +1030,14 @@ void Fl_Xlib_Graphics_Driver::draw_fixed(Fl_RGB_Image *img, int X, int Y, int W,
 
 void Fl_Xlib_Graphics_Driver::draw_rgb(Fl_RGB_Image *rgb, int XP, int YP, int WP, int HP, int cx, int cy) {
   if (!fl_can_do_alpha_blending()) {
-    Fl_Graphics_Driver::draw_rgb(rgb, XP, YP, WP, HP, cx, cy);
+    draw_rgb_scaled_(rgb, XP, YP, WP, HP, cx, cy);
     return;
   }
   if (!*Fl_Graphics_Driver::id(rgb)) {
     cache(rgb);
+    // counted in FL_MEMORY_IMAGE_CACHE here and by Fl_RGB_Image::uncache()
+    if (*Fl_Graphics_Driver::id(rgb))
+      fl_memory_account(FL_MEMORY_IMAGE_CACHE, fl_offscreen_bytes(rgb->data_w(), rgb->data_h()));
   }
   float s = scale();
   int Xs = Fl_Scalable_Graphics_Driver::floor(XP - cx, s);
@@ -860,6 +1109,12 @@ int Fl_Xlib_Graphics_Driver::scale_and_render_pixmap(Fl_Offscreen pixmap, int de
   return 1;
 }
 
+#else
+
+void Fl_Xlib_Graphics_Driver::draw_rgb(Fl_RGB_Image *rgb, int XP, int YP, int WP, int HP, int cx, int cy) {
+  draw_rgb_scaled_(rgb, XP, YP, WP, HP, cx, cy);
+}
+
 #endif // HAVE_XRENDER
 
 void Fl_Xlib_Graphics_Driver::uncache(Fl_RGB_Image*, fl_uintptr_t &id_, fl_uintptr_t &mask_)
@@ -868,6 +1123,17 @@ void Fl_Xlib_Graphics_Driver::uncache(Fl_RGB_Image*, fl_uintptr_t &id_, fl_uintp
     XFreePixmap(fl_display, (Pixmap)id_);
     id_ = 0;
   }
+  if (mask_) { // see draw_rgb_scaled_()
+    Scaled_Form *f = (Scaled_Form*)mask_;
+    scaled_unlink(f);
+    scaled_bytes -= f->bytes;
+    if (f->pixels) {
+      fl_memory_account(FL_MEMORY_IMAGE_CACHE, -f->bytes);
+      delete f->pixels;
+    }
+    delete f;
+    mask_ = 0;
+  }
 }
 
 void Fl_Xlib_Graphics_Driver::cache(Fl_Bitmap *bm) {
@@ -923,12 +1189,14 @@ void Fl_Xlib_Graphics_Driver::draw_fixed(Fl_Pixmap *pxm, int X, int Y, int W, in
 }
 
 
+extern int fl_draw_pixmap(const Fl_Pixmap *pxm, int x, int y, Fl_Color bg); // in fl_draw_pixmap.cxx
+
 void Fl_Xlib_Graphics_Driver::cache(Fl_Pixmap *pxm) {
   Fl_Image_Surface *surf = new Fl_Image_Surface(pxm->data_w(), pxm->data_h());
   Fl_Surface_Device::push_current(surf);
   uchar **pbitmap = surf->driver()->mask_bitmap();
   *pbitmap = (uchar*)1;// will instruct fl_draw_pixmap() to compute the image's mask
-  fl_draw_pixmap(pxm->data(), 0, 0, FL_BLACK);
+  fl_draw_pixmap(pxm, 0, 0, FL_BLACK);
   uchar *bitmap = *pbitmap;
   if (bitmap) {
     *Fl_Graphics_Driver::mask(pxm) = (fl_uintptr_t)create_bitmask(pxm->data_w(), pxm->data_h(), bitmap);
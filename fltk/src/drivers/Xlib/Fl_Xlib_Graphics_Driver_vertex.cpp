@@ -26,10 +26,46 @@
 #include "../../../hdr/fl_draw.h"
 #include "../../../hdr/platform.h"
 #include "../../../hdr/mymath.h"
+#include <stdlib.h>
+
+// The circles of a path are drawn together when the path ends.
+
+void Fl_Xlib_Graphics_Driver::begin_points() {
+  Fl_Graphics_Driver::begin_points();
+  n_arcs_ = 0; in_path_ = 1;
+}
+
+void Fl_Xlib_Graphics_Driver::begin_line() {
+  Fl_Graphics_Driver::begin_line();
+  n_arcs_ = 0; in_path_ = 1;
+}
+
+void Fl_Xlib_Graphics_Driver::begin_loop() {
+  Fl_Graphics_Driver::begin_loop();
+  n_arcs_ = 0; in_path_ = 1;
+}
+
+void Fl_Xlib_Graphics_Driver::begin_polygon() {
+  Fl_Graphics_Driver::begin_polygon();
+  n_arcs_ = 0; in_path_ = 1;
+}
+
+void Fl_Xlib_Graphics_Driver::begin_complex_polygon() {
+  Fl_Graphics_Driver::begin_complex_polygon();
+  n_arcs_ = 0; in_path_ = 1;
+}
+
+void Fl_Xlib_Graphics_Driver::end_arcs_() {
+  in_path_ = 0;
+  if (!n_arcs_) return;
+  (what == POLYGON ? XFillArcs : XDrawArcs)(fl_display, fl_window, gc_, arcs_, n_arcs_);
+  n_arcs_ = 0;
+}
 
 
 void Fl_Xlib_Graphics_Driver::end_points() {
   if (n>1) XDrawPoints(fl_display, fl_window, gc_, short_point, n, 0);
+  end_arcs_();
 }
 
 void Fl_Xlib_Graphics_Driver::end_line() {
@@ -38,6 +74,7 @@ void Fl_Xlib_Graphics_Driver::end_line() {
     return;
   }
   if (n>1) XDrawLines(fl_display, fl_window, gc_, short_point, n, 0);
+  end_arcs_();
 }
 
 void Fl_Xlib_Graphics_Driver::end_loop() {
@@ -55,6 +92,7 @@ void Fl_Xlib_Graphics_Driver::end_polygon() {
     return;
   }
   if (n>2) XFillPolygon(fl_display, fl_window, gc_, short_point, n, Convex, 0);
+  end_arcs_();
 }
 
 void Fl_Xlib_Graphics_Driver::gap() {
@@ -74,6 +112,7 @@ void Fl_Xlib_Graphics_Driver::end_complex_polygon() {
     return;
   }
   if (n>2) XFillPolygon(fl_display, fl_window, gc_, short_point, n, 0, 0);
+  end_arcs_();
 }
 
 bool Fl_Xlib_Graphics_Driver::can_fill_non_convex_polygon() {
@@ -81,14 +120,25 @@ bool Fl_Xlib_Graphics_Driver::can_fill_non_convex_polygon() {
 }
 
 // shortcut the closed circles so they use XDrawArc:
-// warning: these do not draw rotated ellipses correctly!
-// See fl_arc.c for portable version.
+// ellipse_unscaled() is only called for axis-aligned ellipses, see
+// Fl_Scalable_Graphics_Driver::circle() and fl_arc.cxx for other matrices.
 void Fl_Xlib_Graphics_Driver::ellipse_unscaled(double xt, double yt, double rx, double ry) {
   int llx = (int)rint(xt-rx);
   int w = (int)rint(xt+rx)-llx;
   int lly = (int)rint(yt-ry);
   int h = (int)rint(yt+ry)-lly;
 
-  (what == POLYGON ? XFillArc : XDrawArc)
-    (fl_display, fl_window, gc_, llx, lly, w, h, 0, 360*64);
+  if (!in_path_) { // fl_circle() used by itself
+    (what == POLYGON ? XFillArc : XDrawArc)
+      (fl_display, fl_window, gc_, llx, lly, w, h, 0, 360*64);
+    return;
+  }
+  if (n_arcs_ >= arcs_size_) {
+    arcs_size_ = arcs_ ? 2*arcs_size_ : 16;
+    arcs_ = (XArc*)realloc((void*)arcs_, arcs_size_*sizeof(*arcs_));
+  }
+  XArc &a = arcs_[n_arcs_++];
+  a.x = llx; a.y = lly;
+  a.width = w; a.height = h;
+  a.angle1 = 0; a.angle2 = 360*64;
 }
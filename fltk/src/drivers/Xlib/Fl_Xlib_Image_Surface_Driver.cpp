@@ -17,6 +17,7 @@
 #include "../../../hdr/platform.h"
 #include "Fl_Xlib_Image_Surface_Driver.h"
 #include "../../Fl_Screen_Driver.h"
+#include "../../Fl_Memory.h"
 #include <stdlib.h>
 #if FLTK_USE_CAIRO
 #  include <cairo-xlib.h>
@@ -29,6 +30,7 @@
 
 Fl_Xlib_Image_Surface_Driver::Fl_Xlib_Image_Surface_Driver(int w, int h, int high_res, Fl_Offscreen off) : Fl_Image_Surface_Driver(w, h, high_res, off) {
   float d = 1;
+  accounted_ = 0;
   if (!off) {
     fl_open_display();
     d =  Fl_Graphics_Driver::default_driver().scale();
@@ -37,6 +39,8 @@ Fl_Xlib_Image_Surface_Driver::Fl_Xlib_Image_Surface_Driver(int w, int h, int hig
       h = int(h*d);
     }
     offscreen = (Fl_Offscreen)XCreatePixmap(fl_display, RootWindow(fl_display, fl_screen), w, h, fl_visual->depth);
+    accounted_ = fl_offscreen_bytes(w, h);
+    fl_memory_account(FL_MEMORY_OFFSCREEN, accounted_);
   }
   shape_data_ = NULL;
 #if FLTK_USE_CAIRO
@@ -74,6 +78,10 @@ Fl_Xlib_Image_Surface_Driver::~Fl_Xlib_Image_Surface_Driver() {
   }
 #endif
   if (offscreen && !external_offscreen) XFreePixmap(fl_display, (Pixmap)offscreen);
+  // the bytes leave FL_MEMORY_OFFSCREEN also if the offscreen was taken by
+  // Fl_Graphics_Driver::get_offscreen_and_delete_image_surface(): the image
+  // caches that take it count it in FL_MEMORY_IMAGE_CACHE
+  fl_memory_account(FL_MEMORY_OFFSCREEN, -accounted_);
   delete driver();
 }
 
@@ -26,12 +26,6 @@
 #include "../hdr/fl_draw.h"
 #include "../hdr/mymath.h"
 
-// avoid problems with some platforms that don't
-// implement hypot.
-static double _fl_hypot(double x, double y) {
-  return sqrt(x*x + y*y);
-}
-
 /**
  \cond DriverDev
  \addtogroup DriverDeveloper
@@ -56,15 +50,16 @@ void Fl_Graphics_Driver::arc(double x, double y, double r, double start, double
   double Y = -r*sin(A);                 //   from center to initial point
   fl_vertex(x+X,y+Y);                   // Insert initial point
 
-  // Maximum arc length to approximate with chord with error <= 0.125
+  // Maximum arc length to approximate with chord with error <= 0.125 pixel
+  // on the device, i.e. after the current matrix and the display scale:
 
   double epsilon; {
-    double r1 = _fl_hypot(fl_transform_dx(r,0), // Horizontal "radius"
-                          fl_transform_dy(r,0));
-    double r2 = _fl_hypot(fl_transform_dx(0,r), // Vertical "radius"
-                          fl_transform_dy(0,r));
+    double a = fl_transform_dx(r,0), b = fl_transform_dy(r,0);
+    double c = fl_transform_dx(0,r), d = fl_transform_dy(0,r);
+    double s = (a*a + b*b + c*c + d*d) / 2;   // largest "radius" of the ellipse
+    double det = a*d - b*c;
+    double r1 = sqrt(s + sqrt(fabs(s*s - det*det))) * scale();
 
-    if (r1 > r2) r1 = r2;               // r1 = minimum "radius"
     if (r1 < 2.) r1 = 2.;               // radius for circa 9 chords/circle
 
     epsilon = 2*acos(1.0 - 0.125/r1);   // Maximum arc angle
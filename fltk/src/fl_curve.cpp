@@ -52,16 +52,16 @@ void Fl_Graphics_Driver::curve(double X0, double Y0,
   double x3 = fl_transform_x(X3,Y3);
   double y3 = fl_transform_y(X3,Y3);
 
-  // find the area:
-  double a = fabs((x-x2)*(y3-y1)-(y-y2)*(x3-x1));
-  double b = fabs((x-x3)*(y2-y1)-(y-y3)*(x2-x1));
-  if (b > a) a = b;
-
-  // use that to guess at the number of segments:
-  int nSeg = int(sqrt(a)/4);
+  // number of segments for an error <= 0.125 pixel on the device (Wang's
+  // formula, from the largest second difference of the control points):
+  double ddx = fabs(x-2*x1+x2), ddy = fabs(y-2*y1+y2);
+  double dd2x = fabs(x1-2*x2+x3), dd2y = fabs(y1-2*y2+y3);
+  if (dd2x > ddx) ddx = dd2x;
+  if (dd2y > ddy) ddy = dd2y;
+  double dd = sqrt(ddx*ddx + ddy*ddy) * scale();
+  int nSeg = int(ceil(sqrt(6 * dd)));
   if (nSeg > 1) {
-    if (nSeg > 100) nSeg = 100; // make huge curves not hang forever
-    if (nSeg < 9) nSeg = 9; // make tiny curevs look bearable
+    if (nSeg > 500) nSeg = 500; // make huge curves not hang forever
 
     double e = 1.0/nSeg;
 
@@ -23,6 +23,7 @@
 #include "flstring.h"
 #include "drivers/X11/Fl_X11_Screen_Driver.h"
 #include "Fl_Window_Driver.h"
+#include <stdlib.h>
 
 extern Atom fl_XdndAware;
 extern Atom fl_XdndSelection;
@@ -63,6 +64,235 @@ static int dnd_aware(Window& window) {
   return ret;
 }
 
+////////////////////////////////////////////////////////////////
+// Window stack cache.
+//
+// Finding the window below the pointer with XQueryPointer() on each level
+// and reading XdndAware from each candidate costs several round trips per
+// mouse move. Instead the children of the root window are read once per
+// drag with XQueryTree() and kept up to date from the SubstructureNotify
+// events of the root window, the window below the pointer is found from
+// their geometry, and the Xdnd target inside each of them is looked up
+// once and dropped when an XdndAware property changes.
+
+// Limit of the search for the Xdnd target below a child of the root, the
+// window manager frame and the client window are usually enough.
+#define DND_MAX_DEPTH 3
+
+struct Dnd_Top {
+  Window xid;
+  int x, y, w, h;       // including the border
+  char known;           // geometry and map state were read
+  char mapped;
+  char resolved;        // target was looked up
+  Window target;        // FLTK or XdndAware window inside, or 0
+  int version;          // Xdnd version of target
+  Fl_Window *local;     // FLTK window of target
+};
+
+static Dnd_Top *tops = 0;       // children of the root, bottom to top
+static int n_tops = 0, tops_size = 0;
+static Window *watched = 0;     // windows with our PropertyChangeMask
+static int n_watched = 0, watched_size = 0;
+static int root_version;        // Xdnd version of the root, -1 = unknown
+
+static int dnd_x_root, dnd_y_root; // pointer position in pixels
+static char dnd_moved;
+static Window dnd_target;          // window of the last XdndPosition
+static char status_pending;        // no XdndStatus for it yet
+static Fl_Timestamp position_time;
+
+extern int (*fl_dnd_event_hook)(const XEvent&); // in Fl_x.cxx
+
+static int top_index(Window w) {
+  for (int i = n_tops - 1; i >= 0; i--)
+    if (tops[i].xid == w) return i;
+  return -1;
+}
+
+static void top_remove(int i) {
+  n_tops--;
+  memmove(tops + i, tops + i + 1, (n_tops - i) * sizeof(Dnd_Top));
+}
+
+static Dnd_Top &top_insert(int i, Window w) {
+  if (n_tops == tops_size) {
+    tops_size = tops_size ? 2 * tops_size : 64;
+    tops = (Dnd_Top*)realloc(tops, tops_size * sizeof(Dnd_Top));
+  }
+  memmove(tops + i + 1, tops + i, (n_tops - i) * sizeof(Dnd_Top));
+  n_tops++;
+  memset(tops + i, 0, sizeof(Dnd_Top));
+  tops[i].xid = w;
+  return tops[i];
+}
+
+static void top_geometry(Dnd_Top &t, int x, int y, int w, int h, int border) {
+  t.x = x; t.y = y;
+  t.w = w + 2 * border; t.h = h + 2 * border;
+}
+
+static void top_fetch(Dnd_Top &t) {
+  XWindowAttributes a;
+  if (XGetWindowAttributes(fl_display, t.xid, &a)) {
+    top_geometry(t, a.x, a.y, a.width, a.height, a.border_width);
+    t.mapped = (a.map_state != IsUnmapped);
+  } else {
+    t.mapped = 0;
+  }
+  t.known = 1;
+}
+
+static void unresolve_tops() {
+  for (int i = 0; i < n_tops; i++) tops[i].resolved = 0;
+}
+
+// follow changes of XdndAware on a window we don't own
+static void watch(Window w) {
+  if (n_watched == watched_size) {
+    watched_size = watched_size ? 2 * watched_size : 32;
+    watched = (Window*)realloc(watched, watched_size * sizeof(Window));
+  }
+  watched[n_watched++] = w;
+  XSelectInput(fl_display, w, PropertyChangeMask);
+}
+
+// finds the FLTK or XdndAware window in w or its viewable descendants
+static int resolve(Window w, int depth, Dnd_Top &t) {
+  if ((t.local = fl_find(w))) { t.target = w; t.version = 0; return 1; }
+  watch(w);
+  if ((t.version = dnd_aware(w))) { t.target = w; return 1; }
+  if (depth >= DND_MAX_DEPTH) return 0;
+  Window root, parent, *children = 0; unsigned int n = 0;
+  if (!XQueryTree(fl_display, w, &root, &parent, &children, &n)) return 0;
+  int found = 0;
+  for (int i = int(n) - 1; i >= 0 && !found; i--) {
+    XWindowAttributes a;
+    if (XGetWindowAttributes(fl_display, children[i], &a) && a.map_state == IsViewable)
+      found = resolve(children[i], depth + 1, t);
+  }
+  if (children) XFree(children);
+  return found;
+}
+
+static void snapshot_tops() {
+  Window root, parent, *children = 0; unsigned int n = 0;
+  n_tops = 0;
+  if (!XQueryTree(fl_display, RootWindow(fl_display, fl_screen), &root, &parent, &children, &n))
+    return;
+  for (unsigned int i = 0; i < n; i++) top_insert(n_tops, children[i]);
+  if (children) XFree(children);
+}
+
+// returns the topmost mapped child of the root containing the point, or -1
+static int top_at(int x, int y) {
+  for (int i = n_tops - 1; i >= 0; i--) {
+    Dnd_Top &t = tops[i];
+    if (!t.known) top_fetch(t);
+    if (t.mapped && x >= t.x && x < t.x + t.w && y >= t.y && y < t.y + t.h) return i;
+  }
+  return -1;
+}
+
+// Called by fl_handle() for each event during a drag, returns 1 for
+// events that are only of interest here.
+static int dnd_event(const XEvent &e) {
+  Window root = RootWindow(fl_display, fl_screen);
+  int i;
+  switch (e.type) {
+    case MotionNotify:
+      dnd_x_root = e.xmotion.x_root;
+      dnd_y_root = e.xmotion.y_root;
+      dnd_moved = 1;
+      return 0;
+    case ClientMessage:
+      if (e.xclient.message_type == fl_XdndStatus &&
+          (Window)e.xclient.data.l[0] == dnd_target) {
+        status_pending = 0;
+        return 1;
+      }
+      return 0;
+    case PropertyNotify:
+      if (e.xproperty.atom == fl_XdndAware) {
+        if (e.xproperty.window == root) root_version = -1;
+        else unresolve_tops();
+      }
+      return e.xproperty.window != root && !fl_find(e.xproperty.window);
+    case CreateNotify:
+      if (e.xcreatewindow.parent != root) return 0;
+      {
+        Dnd_Top &t = top_insert(n_tops, e.xcreatewindow.window);
+        top_geometry(t, e.xcreatewindow.x, e.xcreatewindow.y, e.xcreatewindow.width,
+                     e.xcreatewindow.height, e.xcreatewindow.border_width);
+        t.known = 1; // new windows are unmapped
+      }
+      return 1;
+    case DestroyNotify:
+      if (e.xdestroywindow.event != root) return 0;
+      if ((i = top_index(e.xdestroywindow.window)) >= 0) top_remove(i);
+      return 1;
+    case MapNotify:
+    case UnmapNotify:
+      if (e.xmap.event != root) return 0;
+      if ((i = top_index(e.xmap.window)) >= 0) {
+        tops[i].mapped = (e.type == MapNotify);
+        tops[i].resolved = 0;
+      }
+      return 1;
+    case ReparentNotify:
+      if (e.xreparent.event != root) return 0;
+      if ((i = top_index(e.xreparent.window)) >= 0) top_remove(i);
+      if (e.xreparent.parent == root) top_insert(n_tops, e.xreparent.window);
+      unresolve_tops(); // a client went into or out of a frame
+      return 1;
+    case ConfigureNotify: {
+      if (e.xconfigure.event != root) return 0;
+      if ((i = top_index(e.xconfigure.window)) < 0) return 1;
+      Dnd_Top t = tops[i];
+      // the map state of a window not fetched yet is still unknown:
+      top_geometry(t, e.xconfigure.x, e.xconfigure.y, e.xconfigure.width,
+                   e.xconfigure.height, e.xconfigure.border_width);
+      top_remove(i);
+      int above = e.xconfigure.above ? top_index(e.xconfigure.above) + 1 : 0;
+      top_insert(above, t.xid) = t;
+      return 1;
+    }
+    case CirculateNotify: {
+      if (e.xcirculate.event != root) return 0;
+      if ((i = top_index(e.xcirculate.window)) < 0) return 1;
+      Dnd_Top t = tops[i];
+      top_remove(i);
+      top_insert(e.xcirculate.place == PlaceOnTop ? n_tops : 0, t.xid) = t;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void begin_tracking() {
+  Window root = RootWindow(fl_display, fl_screen);
+  // the mask of fl_open_display() plus the window stack changes
+  XSelectInput(fl_display, root, PropertyChangeMask | SubstructureNotifyMask);
+  snapshot_tops();
+  root_version = -1;
+  Window junk1, junk2; int junk3, junk4; unsigned int junk5;
+  XQueryPointer(fl_display, root, &junk1, &junk2, &dnd_x_root, &dnd_y_root,
+                &junk3, &junk4, &junk5);
+  dnd_moved = 1;
+  dnd_target = 0;
+  status_pending = 0;
+  fl_dnd_event_hook = dnd_event;
+}
+
+static void end_tracking() {
+  fl_dnd_event_hook = 0;
+  XSelectInput(fl_display, RootWindow(fl_display, fl_screen), PropertyChangeMask);
+  for (int i = 0; i < n_watched; i++)
+    XSelectInput(fl_display, watched[i], NoEventMask);
+  n_watched = 0;
+  n_tops = 0;
+}
+
 static int grabfunc(int event) {
   if (event == FL_RELEASE) Fl::pushed(0);
   return 0;
@@ -90,22 +320,30 @@ int Fl_X11_Screen_Driver::dnd(int unused) {
   int dndversion = 4; int dest_x, dest_y;
   XSetSelectionOwner(fl_display, fl_XdndSelection, source_window, fl_event_time);
 
+  begin_tracking();
+  char position_pending = 0;
+
   while (Fl::pushed()) {
     // figure out what window we are pointing at:
     Window new_window = 0; int new_version = 0;
     Fl_Window* new_local_window = 0;
-    for (Window child = RootWindow(fl_display, fl_screen);;) {
-      Window root; unsigned int junk3;
-      XQueryPointer(fl_display, child, &root, &child,
-                    &Fl::e_x_root, &Fl::e_y_root, &dest_x, &dest_y, &junk3);
-      if (!child) {
-        if (!new_window && (new_version = dnd_aware(root))) new_window = root;
-        break;
+    int i = top_at(dnd_x_root, dnd_y_root);
+    if (i >= 0) {
+      Dnd_Top &t = tops[i];
+      if (!t.resolved) {
+        if (!resolve(t.xid, 1, t)) { t.target = 0; t.version = 0; t.local = 0; }
+        t.resolved = 1;
       }
-      new_window = child;
-      if ((new_local_window = fl_find(child))) break;
-      if ((new_version = dnd_aware(new_window))) break;
+      new_window = t.target ? t.target : t.xid;
+      new_version = t.version;
+      new_local_window = t.local;
+    } else {
+      Window root = RootWindow(fl_display, fl_screen);
+      if (root_version < 0) root_version = dnd_aware(root);
+      if ((new_version = root_version)) new_window = root;
     }
+    Fl::e_x_root = dnd_x_root;
+    Fl::e_y_root = dnd_y_root;
 #if USE_XFT
     if (new_local_window) {
       float s = Fl::screen_driver()->scale(Fl_Window_Driver::driver(new_local_window)->screen_num());
@@ -123,6 +361,9 @@ int Fl_X11_Screen_Driver::dnd(int unused) {
       dndversion = new_version;
       target_window = new_window;
       local_window = new_local_window;
+      dnd_target = local_window ? 0 : target_window;
+      status_pending = 0;
+      position_pending = (dnd_target && dndversion);
       if (local_window) {
         local_handle(FL_DND_ENTER, local_window);
       } else if (dndversion) {
@@ -165,21 +406,43 @@ int Fl_X11_Screen_Driver::dnd(int unused) {
         exroot *= s; eyroot *= s;
       }
 #endif
-      fl_sendClientMessage(target_window, fl_XdndPosition, source_window,
-                           0, (exroot<<16)|eyroot, fl_event_time,
-                           fl_XdndActionCopy);
+      // one XdndPosition per XdndStatus, as allowed by the protocol;
+      // targets that don't answer get one per second
+      if (dnd_moved) position_pending = 1;
+      if (position_pending && (!status_pending || Fl::seconds_since(position_time) > 1.0)) {
+        fl_sendClientMessage(target_window, fl_XdndPosition, source_window,
+                             0, (exroot<<16)|eyroot, fl_event_time,
+                             fl_XdndActionCopy);
+        position_pending = 0;
+        status_pending = 1;
+        position_time = Fl::now();
+      }
     }
-    Fl::wait();
+    dnd_moved = 0;
+    if (position_pending) Fl::wait(1.0);
+    else Fl::wait();
   }
 
   if (local_window) {
     fl_i_own_selection[0] = 1;
     if (local_handle(FL_DND_RELEASE, local_window)) Fl::paste(*Fl::belowmouse(), 0);
   } else if (dndversion) {
+    if (position_pending) { // drop where the pointer is
+      fl_sendClientMessage(target_window, fl_XdndPosition, source_window,
+                           0, (dnd_x_root<<16)|dnd_y_root, fl_event_time,
+                           fl_XdndActionCopy);
+    }
     fl_sendClientMessage(target_window, fl_XdndDrop, source_window,
                          0, fl_event_time);
   } else if (target_window) {
-    // fake a drop by clicking the middle mouse button:
+    // fake a drop by clicking the middle mouse button
+    // on the deepest window below the pointer:
+    for (Window child = RootWindow(fl_display, fl_screen); child;) {
+      Window root; unsigned int junk3;
+      target_window = child;
+      XQueryPointer(fl_display, child, &root, &child,
+                    &Fl::e_x_root, &Fl::e_y_root, &dest_x, &dest_y, &junk3);
+    }
     XButtonEvent msg;
     msg.type = ButtonPress;
     msg.window = target_window;
@@ -204,6 +467,7 @@ int Fl_X11_Screen_Driver::dnd(int unused) {
     XSendEvent(fl_display, target_window, False, 0L, (XEvent*)&msg);
   }
 
+  end_tracking();
   fl_local_grab = 0;
   Fl::handle(FL_RELEASE, source_fl_win);
   source_fl_win->cursor(FL_CURSOR_DEFAULT);
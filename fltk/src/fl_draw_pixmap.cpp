@@ -35,6 +35,8 @@
 #include "Fl_System_Driver.h"
 #include "../hdr/platform.h"
 #include "../hdr/fl_draw.h"
+#include "../hdr/Fl_Pixmap.h"
+#include "Fl_Memory.h"
 #include <stdio.h>
 #include "flstring.h"
 
@@ -181,20 +183,8 @@ int fl_convert_pixmap(const char*const* cdata, uchar* out, Fl_Color bg) {
   return 1;
 }
 
-int fl_draw_pixmap(const char*const* cdata, int x, int y, Fl_Color bg) {
-  int w, h;
-
-  if (!fl_measure_pixmap(cdata, w, h))
-    return 0;
-
-  uchar *buffer = new uchar[w*h*4];
-
-  if (!fl_convert_pixmap(cdata, buffer, bg)) {
-    delete[] buffer;
-    return 0;
-  }
-
-  // build the mask bitmap used by Fl_Pixmap:
+// draws RGBA pixels, and builds the mask bitmap used by Fl_Pixmap
+static void draw_rgba(const uchar *buffer, int x, int y, int w, int h) {
   uchar **p = fl_graphics_driver->mask_bitmap();
   if (p && *p) {
     int W = (w+7)/8;
@@ -218,7 +208,145 @@ int fl_draw_pixmap(const char*const* cdata, int x, int y, Fl_Color bg) {
   }
 
   fl_draw_image(buffer, x, y, w, h, 4);
+}
+
+int fl_draw_pixmap(const char*const* cdata, int x, int y, Fl_Color bg) {
+  int w, h;
+
+  if (!fl_measure_pixmap(cdata, w, h))
+    return 0;
+
+  uchar *buffer = new uchar[w*h*4];
 
+  if (!fl_convert_pixmap(cdata, buffer, bg)) {
+    delete[] buffer;
+    return 0;
+  }
+
+  draw_rgba(buffer, x, y, w, h);
+
+  delete[] buffer;
+  return 1;
+}
+
+////////////////////////////////////////////////////////////////
+// Decoded pixels of Fl_Pixmap objects.
+//
+// Parsing an XPM image, its color names in particular, is slow compared
+// to drawing it, and an Fl_Pixmap may need its pixels again: when its
+// cached server pixmap is made again after uncache() or a change of
+// scale, and for each Fl_RGB_Image made from it. The pixels of the last
+// decoded pixmaps are kept, most recently used first, up to
+// DECODED_BUDGET bytes.
+
+#define DECODED_BUDGET (8 * 1024 * 1024)
+
+struct Decoded_Pixmap {
+  const Fl_Pixmap *owner;
+  const char * const *data;     // owner->data() when decoded
+  uchar *rgba;
+  int w, h;
+  Fl_Color bg;                  // color given to transparent pixels
+  Decoded_Pixmap *prev, *next;
+};
+
+static Decoded_Pixmap *decoded_first = 0, *decoded_last = 0;
+static long decoded_bytes = 0;
+
+static void decoded_unlink(Decoded_Pixmap *d) {
+  if (d->prev) d->prev->next = d->next; else decoded_first = d->next;
+  if (d->next) d->next->prev = d->prev; else decoded_last = d->prev;
+}
+
+static void decoded_link_first(Decoded_Pixmap *d) {
+  d->prev = 0;
+  d->next = decoded_first;
+  if (decoded_first) decoded_first->prev = d; else decoded_last = d;
+  decoded_first = d;
+}
+
+static void decoded_free(Decoded_Pixmap *d) {
+  decoded_unlink(d);
+  long bytes = 4L * d->w * d->h;
+  decoded_bytes -= bytes;
+  fl_memory_account(FL_MEMORY_IMAGE_CACHE, -bytes);
+  delete[] d->rgba;
+  delete d;
+}
+
+static void decoded_trim() {
+  while (decoded_first) decoded_free(decoded_first);
+}
+
+// Forgets the decoded pixels of pxm, when its data changes or it is deleted.
+void fl_forget_decoded_pixmap(const Fl_Pixmap *pxm) {
+  for (Decoded_Pixmap *d = decoded_first; d; d = d->next)
+    if (d->owner == pxm) { decoded_free(d); return; }
+}
+
+/*
+  Like fl_convert_pixmap(const char*const*, uchar*, Fl_Color), but parses
+  the data of pxm only the first time.
+*/
+int fl_convert_pixmap(const Fl_Pixmap *pxm, uchar *out, Fl_Color bg) {
+  const char * const *data = pxm->data();
+  int w = pxm->data_w(), h = pxm->data_h();
+  if (Fl_Graphics_Driver::need_pixmap_bg_color || !data || w <= 0 || h <= 0)
+    return fl_convert_pixmap(data, out, bg);
+  Decoded_Pixmap *d;
+  for (d = decoded_first; d; d = d->next)
+    if (d->owner == pxm) break;
+  if (d && (d->data != data || d->w != w || d->h != h)) {
+    decoded_free(d);
+    d = 0;
+  }
+  if (!d) {
+    d = new Decoded_Pixmap;
+    d->rgba = new uchar[4 * w * h];
+    if (!fl_convert_pixmap(data, d->rgba, bg)) {
+      delete[] d->rgba;
+      delete d;
+      return 0;
+    }
+    d->owner = pxm;
+    d->data = data;
+    d->w = w;
+    d->h = h;
+    d->bg = bg;
+    long bytes = 4L * w * h;
+    while (decoded_last && decoded_bytes + bytes > DECODED_BUDGET)
+      decoded_free(decoded_last);
+    decoded_bytes += bytes;
+    fl_memory_account(FL_MEMORY_IMAGE_CACHE, bytes);
+    fl_memory_trim_handler(decoded_trim);
+  } else {
+    decoded_unlink(d);
+  }
+  decoded_link_first(d);
+  memcpy(out, d->rgba, 4 * w * h);
+  if (bg != d->bg) { // transparent pixels are given the background color
+    uchar r, g, b;
+    Fl::get_color(bg, r, g, b);
+    uchar *p = out, *e = out + 4 * w * h;
+    for (; p < e; p += 4)
+      if (!p[3]) { p[0] = r; p[1] = g; p[2] = b; }
+  }
+  return 1;
+}
+
+/*
+  Like fl_draw_pixmap(const char*const*, int, int, Fl_Color), but parses
+  the data of pxm only the first time.
+*/
+int fl_draw_pixmap(const Fl_Pixmap *pxm, int x, int y, Fl_Color bg) {
+  int w = pxm->data_w(), h = pxm->data_h();
+  if (w <= 0 || h <= 0) return 0;
+  uchar *buffer = new uchar[w*h*4];
+  if (!fl_convert_pixmap(pxm, buffer, bg)) {
+    delete[] buffer;
+    return 0;
+  }
+  draw_rgba(buffer, x, y, w, h);
   delete[] buffer;
   return 1;
 }
@@ -86,17 +86,21 @@ fl_check_images(const char *name,               // I - Filename
   if (headerlen < 6) // not a valid image
     return 0;
 
+  // Size requested with FL_DECODE_REDUCED, or 0, 0
+  int W, H;
+  Fl_Shared_Image::decode_size(W, H);
+
   // GIF
 
   if (memcmp(header, "GIF87a", 6) == 0 ||
       memcmp(header, "GIF89a", 6) == 0) // GIF file
     return Fl_GIF_Image::animate ? new Fl_Anim_GIF_Image(name) :
-                                   new Fl_GIF_Image(name);
+                                   new Fl_GIF_Image(name, W, H);
 
   // BMP
 
   if (memcmp(header, "BM", 2) == 0)     // BMP file
-    return new Fl_BMP_Image(name);
+    return new Fl_BMP_Image(name, W, H);
 
   if (memcmp(header, "\0\0\1\0", 4) == 0 && header[5] == 0)   // ICO file
     return new Fl_ICO_Image(name);
@@ -105,7 +109,7 @@ fl_check_images(const char *name,               // I - Filename
 
   if (header[0] == 'P' && header[1] >= '1' && header[1] <= '7')
                                         // Portable anymap
-    return new Fl_PNM_Image(name);
+    return new Fl_PNM_Image(name, W, H);
 
   // PNG
 
@@ -125,6 +129,15 @@ fl_check_images(const char *name,               // I - Filename
   // SVG or SVGZ (gzip'ed SVG)
 
 #ifdef FLTK_USE_SVG
+  // precompiled SVG, see Fl_SVG_Image::write_precompiled()
+  if (headerlen >= 8 && memcmp(header, "\211NSVG\r\n", 7) == 0) {
+    Fl_SVG_Image *image = new Fl_SVG_Image(name);
+    if (image->w() && image->h())
+      return image;
+    delete image;
+    return 0;
+  }
+
   uchar header2[64];      // buffer for decompression
   uchar *buf = header;    // original header data
   int count = headerlen;  // original header data size
@@ -29,6 +29,8 @@
 #ifndef NANOSVG_H
 #define NANOSVG_H
 
+#include <stddef.h>
+
 #ifndef NANOSVG_CPLUSPLUS
 #ifdef __cplusplus
 extern "C" {
@@ -51,6 +53,11 @@ extern "C" {
 // DPI (dots-per-inch) controls how the unit conversion is done.
 //
 // If you don't know or care about the units stuff, "px" and 96 should get you going.
+//
+// Modified by FLTK: all memory of an image is allocated from a few large
+// blocks that nsvgDelete() frees together, and images can be written to
+// and read from a compact binary form (see nsvgSerialize()), so that they
+// don't need to be parsed again.
 
 
 /* Example Usage:
@@ -164,6 +171,7 @@ typedef struct NSVGimage
 	float width;				// Width of the image.
 	float height;				// Height of the image.
 	NSVGshape* shapes;			// Linked list of shapes in the image.
+	struct NSVGarena* arena;	// Memory blocks holding the image (FLTK).
 } NSVGimage;
 
 // Parses SVG file from a file, returns SVG image as paths.
@@ -179,6 +187,23 @@ NSVGpath* nsvgDuplicatePath(NSVGpath* p);
 // Deletes an image.
 void nsvgDelete(NSVGimage* image);
 
+// Returns the number of bytes allocated for an image (FLTK).
+size_t nsvgImageSize(NSVGimage* image);
+
+// First bytes of the binary form of an image, followed by the version (FLTK).
+#define NSVG_SERIAL_MAGIC "\211NSVG\r\n"
+#define NSVG_SERIAL_VERSION 1
+
+// Writes the binary form of an image into buf if it holds at least as many
+// bytes as needed, returns the number of bytes needed. The binary form is
+// independent of byte order. The fillGradient, strokeGradient and xform
+// members of shapes are not kept, they are only used while parsing (FLTK).
+size_t nsvgSerialize(NSVGimage* image, unsigned char* buf, size_t size);
+
+// Creates an image from its binary form, returns NULL if the data is not
+// valid (FLTK).
+NSVGimage* nsvgDeserialize(const unsigned char* data, size_t size);
+
 #ifndef NANOSVG_CPLUSPLUS
 #ifdef __cplusplus
 }
@@ -220,7 +245,8 @@ void nsvgDelete(NSVGimage* image);
 
 static int nsvg__isspace(char c)
 {
-	return strchr(" \t\n\v\f\r", c) != 0;
+	// like strchr(" \t\n\v\f\r", c), which is also true for '\0' (FLTK)
+	return c == ' ' || (c >= '\t' && c <= '\r') || c == '\0';
 }
 
 static int nsvg__isdigit(char c)
@@ -439,10 +465,25 @@ typedef struct NSVGattrib
 	char visible;
 } NSVGattrib;
 
+// Memory of an image (FLTK). Its shapes, paths, points and gradients are
+// allocated from blocks of growing size by nsvg__alloc(), which are freed
+// together. NSVGimage.arena is the last block, linked to the previous ones.
+#define NSVG_ARENA_MIN 2048
+#define NSVG_ARENA_MAX 65536
+#define NSVG_ARENA_HEADER ((sizeof(NSVGarena) + 7) & ~(size_t)7)
+
+typedef struct NSVGarena
+{
+	struct NSVGarena* next;		// Previous block or NULL.
+	size_t size;				// Bytes in the block, after the header.
+	size_t used;
+} NSVGarena;
+
 typedef struct NSVGparser
 {
 	NSVGattrib attr[NSVG_MAX_ATTR];
 	int attrHead;
+	NSVGarena* arena;
 	float* pts;
 	int npts;
 	int cpts;
@@ -614,14 +655,102 @@ static void nsvg__curveBounds(float* bounds, float* curve)
 	}
 }
 
+static void* nsvg__alloc(NSVGarena** arena, size_t size)
+{
+	NSVGarena* a = *arena;
+	void* ptr;
+	size = (size + 7) & ~(size_t)7;
+	if (a == NULL || a->size - a->used < size) {
+		size_t n = a != NULL ? a->size * 2 : NSVG_ARENA_MIN;
+		if (n > NSVG_ARENA_MAX) n = NSVG_ARENA_MAX;
+		if (n < size) n = size;
+		a = (NSVGarena*)malloc(NSVG_ARENA_HEADER + n);
+		if (a == NULL) return NULL;
+		a->next = *arena;
+		a->size = n;
+		a->used = 0;
+		*arena = a;
+	}
+	ptr = (char*)a + NSVG_ARENA_HEADER + a->used;
+	a->used += size;
+	return ptr;
+}
+
+static void nsvg__deleteArena(NSVGarena* a)
+{
+	while (a != NULL) {
+		NSVGarena* next = a->next;
+		free(a);
+		a = next;
+	}
+}
+
+static NSVGgradient* nsvg__copyGradient(NSVGarena** arena, NSVGgradient* grad)
+{
+	size_t size = sizeof(NSVGgradient) + sizeof(NSVGgradientStop)*(grad->nstops-1);
+	NSVGgradient* copy = (NSVGgradient*)nsvg__alloc(arena, size);
+	if (copy != NULL) memcpy(copy, grad, size);
+	return copy;
+}
+
+// Copies an image that spans several blocks into one block of the size
+// actually used, unless memory runs out (FLTK).
+static NSVGimage* nsvg__compactImage(NSVGimage* image)
+{
+	NSVGarena *a, *arena;
+	NSVGimage* copy;
+	NSVGshape *shape, *s, **shapesTail;
+	NSVGpath *path, *d, **pathsTail;
+	size_t used = 0;
+
+	if (image->arena == NULL || image->arena->next == NULL) return image;
+	for (a = image->arena; a != NULL; a = a->next) used += a->used;
+	arena = (NSVGarena*)malloc(NSVG_ARENA_HEADER + used);
+	if (arena == NULL) return image;
+	arena->next = NULL;
+	arena->size = used;
+	arena->used = 0;
+
+	// All objects fit in the block, they are copied with the same sizes
+	copy = (NSVGimage*)nsvg__alloc(&arena, sizeof(NSVGimage));
+	*copy = *image;
+	shapesTail = &copy->shapes;
+	for (shape = image->shapes; shape != NULL; shape = shape->next) {
+		s = (NSVGshape*)nsvg__alloc(&arena, sizeof(NSVGshape));
+		*s = *shape;
+		if (s->fill.type == NSVG_PAINT_LINEAR_GRADIENT || s->fill.type == NSVG_PAINT_RADIAL_GRADIENT)
+			s->fill.gradient = nsvg__copyGradient(&arena, s->fill.gradient);
+		if (s->stroke.type == NSVG_PAINT_LINEAR_GRADIENT || s->stroke.type == NSVG_PAINT_RADIAL_GRADIENT)
+			s->stroke.gradient = nsvg__copyGradient(&arena, s->stroke.gradient);
+		pathsTail = &s->paths;
+		for (path = shape->paths; path != NULL; path = path->next) {
+			d = (NSVGpath*)nsvg__alloc(&arena, sizeof(NSVGpath));
+			*d = *path;
+			d->pts = (float*)nsvg__alloc(&arena, path->npts*2*sizeof(float));
+			memcpy(d->pts, path->pts, path->npts*2*sizeof(float));
+			*pathsTail = d;
+			pathsTail = &d->next;
+		}
+		*pathsTail = NULL;
+		*shapesTail = s;
+		shapesTail = &s->next;
+	}
+	*shapesTail = NULL;
+	copy->arena = arena;
+	nsvg__deleteArena(image->arena);
+	return copy;
+}
+
 static NSVGparser* nsvg__createParser(void)
 {
 	NSVGparser* p;
 	p = (NSVGparser*)malloc(sizeof(NSVGparser));
 	if (p == NULL) goto error;
-	memset(p, 0, sizeof(NSVGparser));
+	// The attribute stack is initialized by nsvg__pushAttr() (FLTK)
+	memset(&p->attrHead, 0, sizeof(NSVGparser) - offsetof(NSVGparser, attrHead));
+	memset(&p->attr[0], 0, sizeof(NSVGattrib));
 
-	p->image = (NSVGimage*)malloc(sizeof(NSVGimage));
+	p->image = (NSVGimage*)nsvg__alloc(&p->arena, sizeof(NSVGimage));
 	if (p->image == NULL) goto error;
 	memset(p->image, 0, sizeof(NSVGimage));
 
@@ -646,29 +775,12 @@ static NSVGparser* nsvg__createParser(void)
 
 error:
 	if (p) {
-		if (p->image) free(p->image);
+		nsvg__deleteArena(p->arena);
 		free(p);
 	}
 	return NULL;
 }
 
-static void nsvg__deletePaths(NSVGpath* path)
-{
-	while (path) {
-		NSVGpath *next = path->next;
-		if (path->pts != NULL)
-			free(path->pts);
-		free(path);
-		path = next;
-	}
-}
-
-static void nsvg__deletePaint(NSVGpaint* paint)
-{
-	if (paint->type == NSVG_PAINT_LINEAR_GRADIENT || paint->type == NSVG_PAINT_RADIAL_GRADIENT)
-		free(paint->gradient);
-}
-
 static void nsvg__deleteGradientData(NSVGgradientData* grad)
 {
 	NSVGgradientData* next;
@@ -683,9 +795,8 @@ static void nsvg__deleteGradientData(NSVGgradientData* grad)
 static void nsvg__deleteParser(NSVGparser* p)
 {
 	if (p != NULL) {
-		nsvg__deletePaths(p->plist);
 		nsvg__deleteGradientData(p->gradients);
-		nsvgDelete(p->image);
+		nsvg__deleteArena(p->arena); // the image, unless it was returned
 		free(p->pts);
 		free(p);
 	}
@@ -849,7 +960,7 @@ static NSVGgradient* nsvg__createGradient(NSVGparser* p, const char* id, const f
 	}
 	if (stops == NULL) return NULL;
 
-	grad = (NSVGgradient*)malloc(sizeof(NSVGgradient) + sizeof(NSVGgradientStop)*(nstops-1));
+	grad = (NSVGgradient*)nsvg__alloc(&p->arena, sizeof(NSVGgradient) + sizeof(NSVGgradientStop)*(nstops-1));
 	if (grad == NULL) return NULL;
 
 	// The shape width and height.
@@ -953,8 +1064,8 @@ static void nsvg__addShape(NSVGparser* p)
 	if (p->plist == NULL)
 		return;
 
-	shape = (NSVGshape*)malloc(sizeof(NSVGshape));
-	if (shape == NULL) goto error;
+	shape = (NSVGshape*)nsvg__alloc(&p->arena, sizeof(NSVGshape));
+	if (shape == NULL) return;
 	memset(shape, 0, sizeof(NSVGshape));
 
 	memcpy(shape->id, attr->id, sizeof shape->id);
@@ -1019,11 +1130,6 @@ static void nsvg__addShape(NSVGparser* p)
 	else
 		p->shapesTail->next = shape;
 	p->shapesTail = shape;
-
-	return;
-
-error:
-	if (shape) free(shape);
 }
 
 static void nsvg__addPath(NSVGparser* p, char closed)
@@ -1044,12 +1150,12 @@ static void nsvg__addPath(NSVGparser* p, char closed)
 	if ((p->npts % 3) != 1)
 		return;
 
-	path = (NSVGpath*)malloc(sizeof(NSVGpath));
-	if (path == NULL) goto error;
+	path = (NSVGpath*)nsvg__alloc(&p->arena, sizeof(NSVGpath));
+	if (path == NULL) return;
 	memset(path, 0, sizeof(NSVGpath));
 
-	path->pts = (float*)malloc(p->npts*2*sizeof(float));
-	if (path->pts == NULL) goto error;
+	path->pts = (float*)nsvg__alloc(&p->arena, p->npts*2*sizeof(float));
+	if (path->pts == NULL) return;
 	path->closed = closed;
 	path->npts = p->npts;
 
@@ -1076,14 +1182,6 @@ static void nsvg__addPath(NSVGparser* p, char closed)
 
 	path->next = p->plist;
 	p->plist = path;
-
-	return;
-
-error:
-	if (path != NULL) {
-		if (path->pts != NULL) free(path->pts);
-		free(path);
-	}
 }
 
 // We roll our own string to float because the std library one uses locale and messes things up.
@@ -3019,11 +3117,13 @@ NSVGimage* nsvgParse(char* input, const char* units, float dpi)
 	nsvg__scaleToViewbox(p, units);
 
 	ret = p->image;
+	ret->arena = p->arena;
 	p->image = NULL;
+	p->arena = NULL;
 
 	nsvg__deleteParser(p);
 
-	return ret;
+	return nsvg__compactImage(ret);
 }
 
 NSVGimage* nsvgParseFromFile(const char* filename, const char* units, float dpi)
@@ -3087,18 +3187,295 @@ error:
 
 void nsvgDelete(NSVGimage* image)
 {
-	NSVGshape *snext, *shape;
 	if (image == NULL) return;
-	shape = image->shapes;
-	while (shape != NULL) {
-		snext = shape->next;
-		nsvg__deletePaths(shape->paths);
-		nsvg__deletePaint(&shape->fill);
-		nsvg__deletePaint(&shape->stroke);
-		free(shape);
-		shape = snext;
-	}
-	free(image);
+	nsvg__deleteArena(image->arena); // includes the image
+}
+
+size_t nsvgImageSize(NSVGimage* image)
+{
+	NSVGarena* a;
+	size_t n = 0;
+	if (image == NULL) return 0;
+	for (a = image->arena; a != NULL; a = a->next)
+		n += NSVG_ARENA_HEADER + a->size;
+	return n;
+}
+
+// Binary form of an image (FLTK). All numbers are little endian, floats
+// are written as their IEEE 754 bits:
+//
+//   magic NSVG_SERIAL_MAGIC, version u8, width f32, height f32, shapes u32
+//   per shape: id length u8 and bytes, fill and stroke paint, opacity f32,
+//     strokeWidth f32, strokeDashOffset f32, strokeDashCount u8 and as many
+//     f32, strokeLineJoin u8, strokeLineCap u8, fillRule u8, flags u8,
+//     miterLimit f32, bounds 4 f32, paths u32
+//   per path: closed u8, npts u32, bounds 4 f32, pts 2*npts f32
+//   paint: type u8, then color u32 or for gradients xform 6 f32, spread u8,
+//     fx f32, fy f32, nstops u32 and per stop color u32, offset f32
+
+typedef struct NSVGwriter
+{
+	unsigned char* buf;			// NULL while counting
+	size_t pos;
+} NSVGwriter;
+
+static void nsvg__putInt(NSVGwriter* w, unsigned int v, int n)
+{
+	int i;
+	if (w->buf != NULL)
+		for (i = 0; i < n; i++)
+			w->buf[w->pos + i] = (unsigned char)(v >> (8 * i));
+	w->pos += n;
+}
+
+static void nsvg__putFloat(NSVGwriter* w, float f)
+{
+	unsigned int v;
+	memcpy(&v, &f, 4);
+	nsvg__putInt(w, v, 4);
+}
+
+static void nsvg__putFloats(NSVGwriter* w, const float* f, int n)
+{
+	int i;
+	for (i = 0; i < n; i++) nsvg__putFloat(w, f[i]);
+}
+
+static void nsvg__putPaint(NSVGwriter* w, NSVGpaint* paint)
+{
+	int i;
+	nsvg__putInt(w, (unsigned char)paint->type, 1);
+	if (paint->type == NSVG_PAINT_COLOR) {
+		nsvg__putInt(w, paint->color, 4);
+	} else if (paint->type == NSVG_PAINT_LINEAR_GRADIENT || paint->type == NSVG_PAINT_RADIAL_GRADIENT) {
+		NSVGgradient* grad = paint->gradient;
+		nsvg__putFloats(w, grad->xform, 6);
+		nsvg__putInt(w, (unsigned char)grad->spread, 1);
+		nsvg__putFloat(w, grad->fx);
+		nsvg__putFloat(w, grad->fy);
+		nsvg__putInt(w, grad->nstops, 4);
+		for (i = 0; i < grad->nstops; i++) {
+			nsvg__putInt(w, grad->stops[i].color, 4);
+			nsvg__putFloat(w, grad->stops[i].offset);
+		}
+	}
+}
+
+static void nsvg__writeImage(NSVGwriter* w, NSVGimage* image)
+{
+	NSVGshape* shape;
+	NSVGpath* path;
+	unsigned int n;
+	size_t len;
+	if (w->buf != NULL) memcpy(w->buf, NSVG_SERIAL_MAGIC, sizeof(NSVG_SERIAL_MAGIC) - 1);
+	w->pos = sizeof(NSVG_SERIAL_MAGIC) - 1;
+	nsvg__putInt(w, NSVG_SERIAL_VERSION, 1);
+	nsvg__putFloat(w, image->width);
+	nsvg__putFloat(w, image->height);
+	for (n = 0, shape = image->shapes; shape != NULL; shape = shape->next) n++;
+	nsvg__putInt(w, n, 4);
+	for (shape = image->shapes; shape != NULL; shape = shape->next) {
+		for (len = 0; len < sizeof(shape->id) - 1 && shape->id[len]; len++) {}
+		nsvg__putInt(w, (unsigned int)len, 1);
+		if (w->buf != NULL) memcpy(w->buf + w->pos, shape->id, len);
+		w->pos += len;
+		nsvg__putPaint(w, &shape->fill);
+		nsvg__putPaint(w, &shape->stroke);
+		nsvg__putFloat(w, shape->opacity);
+		nsvg__putFloat(w, shape->strokeWidth);
+		nsvg__putFloat(w, shape->strokeDashOffset);
+		nsvg__putInt(w, (unsigned char)shape->strokeDashCount, 1);
+		nsvg__putFloats(w, shape->strokeDashArray, shape->strokeDashCount);
+		nsvg__putInt(w, (unsigned char)shape->strokeLineJoin, 1);
+		nsvg__putInt(w, (unsigned char)shape->strokeLineCap, 1);
+		nsvg__putInt(w, (unsigned char)shape->fillRule, 1);
+		nsvg__putInt(w, shape->flags, 1);
+		nsvg__putFloat(w, shape->miterLimit);
+		nsvg__putFloats(w, shape->bounds, 4);
+		for (n = 0, path = shape->paths; path != NULL; path = path->next) n++;
+		nsvg__putInt(w, n, 4);
+		for (path = shape->paths; path != NULL; path = path->next) {
+			nsvg__putInt(w, (unsigned char)path->closed, 1);
+			nsvg__putInt(w, path->npts, 4);
+			nsvg__putFloats(w, path->bounds, 4);
+			nsvg__putFloats(w, path->pts, path->npts * 2);
+		}
+	}
+}
+
+size_t nsvgSerialize(NSVGimage* image, unsigned char* buf, size_t size)
+{
+	NSVGwriter w;
+	if (image == NULL) return 0;
+	w.buf = NULL;
+	nsvg__writeImage(&w, image);
+	if (buf != NULL && size >= w.pos) {
+		w.buf = buf;
+		nsvg__writeImage(&w, image);
+	}
+	return w.pos;
+}
+
+typedef struct NSVGreader
+{
+	const unsigned char* data;
+	size_t size;
+	size_t pos;
+	int error;
+} NSVGreader;
+
+// Returns 1 if n more bytes can be read, sets the error flag if not
+static int nsvg__canRead(NSVGreader* r, size_t n)
+{
+	if (r->error || n > r->size - r->pos) {
+		r->error = 1;
+		return 0;
+	}
+	return 1;
+}
+
+static unsigned int nsvg__getInt(NSVGreader* r, int n)
+{
+	unsigned int v = 0;
+	int i;
+	if (!nsvg__canRead(r, n)) return 0;
+	for (i = 0; i < n; i++)
+		v |= (unsigned int)r->data[r->pos + i] << (8 * i);
+	r->pos += n;
+	return v;
+}
+
+static float nsvg__getFloat(NSVGreader* r)
+{
+	unsigned int v = nsvg__getInt(r, 4);
+	float f;
+	memcpy(&f, &v, 4);
+	return f;
+}
+
+static void nsvg__getFloats(NSVGreader* r, float* f, int n)
+{
+	int i;
+	for (i = 0; i < n; i++) f[i] = nsvg__getFloat(r);
+}
+
+static void nsvg__getPaint(NSVGreader* r, NSVGarena** arena, NSVGpaint* paint)
+{
+	unsigned int nstops, i;
+	paint->type = (signed char)nsvg__getInt(r, 1);
+	if (paint->type == NSVG_PAINT_NONE) {
+		paint->color = 0;
+	} else if (paint->type == NSVG_PAINT_COLOR) {
+		paint->color = nsvg__getInt(r, 4);
+	} else if (paint->type == NSVG_PAINT_LINEAR_GRADIENT || paint->type == NSVG_PAINT_RADIAL_GRADIENT) {
+		float xform[6], fx, fy;
+		char spread;
+		NSVGgradient* grad;
+		nsvg__getFloats(r, xform, 6);
+		spread = (char)nsvg__getInt(r, 1);
+		fx = nsvg__getFloat(r);
+		fy = nsvg__getFloat(r);
+		nstops = nsvg__getInt(r, 4);
+		if (nstops < 1 || !nsvg__canRead(r, (size_t)nstops * 8)) {
+			r->error = 1;
+			return;
+		}
+		grad = (NSVGgradient*)nsvg__alloc(arena, sizeof(NSVGgradient) + sizeof(NSVGgradientStop)*(nstops-1));
+		if (grad == NULL) {
+			r->error = 1;
+			return;
+		}
+		memcpy(grad->xform, xform, sizeof(xform));
+		grad->spread = spread;
+		grad->fx = fx;
+		grad->fy = fy;
+		grad->nstops = (int)nstops;
+		for (i = 0; i < nstops; i++) {
+			grad->stops[i].color = nsvg__getInt(r, 4);
+			grad->stops[i].offset = nsvg__getFloat(r);
+		}
+		paint->gradient = grad;
+	} else {
+		r->error = 1;
+	}
+}
+
+NSVGimage* nsvgDeserialize(const unsigned char* data, size_t size)
+{
+	NSVGreader r;
+	NSVGarena* arena = NULL;
+	NSVGimage* image;
+	NSVGshape *shape, *shapesTail = NULL;
+	NSVGpath *path, *pathsTail;
+	unsigned int nshapes, npaths, npts, i, j;
+	size_t len;
+
+	if (data == NULL || size < sizeof(NSVG_SERIAL_MAGIC) ||
+		memcmp(data, NSVG_SERIAL_MAGIC, sizeof(NSVG_SERIAL_MAGIC) - 1) != 0 ||
+		data[sizeof(NSVG_SERIAL_MAGIC) - 1] != NSVG_SERIAL_VERSION)
+		return NULL;
+	r.data = data;
+	r.size = size;
+	r.pos = sizeof(NSVG_SERIAL_MAGIC);
+	r.error = 0;
+
+	image = (NSVGimage*)nsvg__alloc(&arena, sizeof(NSVGimage));
+	if (image == NULL) return NULL;
+	memset(image, 0, sizeof(NSVGimage));
+	image->width = nsvg__getFloat(&r);
+	image->height = nsvg__getFloat(&r);
+	nshapes = nsvg__getInt(&r, 4);
+	for (i = 0; i < nshapes && !r.error; i++) {
+		shape = (NSVGshape*)nsvg__alloc(&arena, sizeof(NSVGshape));
+		if (shape == NULL) goto error;
+		memset(shape, 0, sizeof(NSVGshape));
+		len = nsvg__getInt(&r, 1);
+		if (len >= sizeof(shape->id) || !nsvg__canRead(&r, len)) goto error;
+		memcpy(shape->id, r.data + r.pos, len);
+		r.pos += len;
+		nsvg__getPaint(&r, &arena, &shape->fill);
+		nsvg__getPaint(&r, &arena, &shape->stroke);
+		shape->opacity = nsvg__getFloat(&r);
+		shape->strokeWidth = nsvg__getFloat(&r);
+		shape->strokeDashOffset = nsvg__getFloat(&r);
+		shape->strokeDashCount = (char)nsvg__getInt(&r, 1);
+		if (shape->strokeDashCount < 0 || shape->strokeDashCount > NSVG_MAX_DASHES) goto error;
+		nsvg__getFloats(&r, shape->strokeDashArray, shape->strokeDashCount);
+		shape->strokeLineJoin = (char)nsvg__getInt(&r, 1);
+		shape->strokeLineCap = (char)nsvg__getInt(&r, 1);
+		shape->fillRule = (char)nsvg__getInt(&r, 1);
+		shape->flags = (unsigned char)nsvg__getInt(&r, 1);
+		shape->miterLimit = nsvg__getFloat(&r);
+		nsvg__getFloats(&r, shape->bounds, 4);
+		nsvg__xformIdentity(shape->xform);
+		npaths = nsvg__getInt(&r, 4);
+		pathsTail = NULL;
+		for (j = 0; j < npaths && !r.error; j++) {
+			path = (NSVGpath*)nsvg__alloc(&arena, sizeof(NSVGpath));
+			if (path == NULL) goto error;
+			memset(path, 0, sizeof(NSVGpath));
+			path->closed = (char)nsvg__getInt(&r, 1);
+			npts = nsvg__getInt(&r, 4);
+			// 1 + N*3 points, as made by nsvg__addPath() and expected by the rasterizer
+			if (npts < 4 || (npts % 3) != 1 || !nsvg__canRead(&r, 16 + (size_t)npts * 8)) goto error;
+			path->npts = (int)npts;
+			nsvg__getFloats(&r, path->bounds, 4);
+			path->pts = (float*)nsvg__alloc(&arena, npts*2*sizeof(float));
+			if (path->pts == NULL) goto error;
+			nsvg__getFloats(&r, path->pts, (int)npts * 2);
+			if (pathsTail == NULL) shape->paths = path; else pathsTail->next = path;
+			pathsTail = path;
+		}
+		if (shapesTail == NULL) image->shapes = shape; else shapesTail->next = shape;
+		shapesTail = shape;
+	}
+	if (r.error) goto error;
+	image->arena = arena;
+	return nsvg__compactImage(image);
+
+error:
+	nsvg__deleteArena(arena);
+	return NULL;
 }
 
 #endif // NANOSVG_IMPLEMENTATION
@@ -0,0 +1,174 @@
+//
+// XPM to RGBA converter for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2024 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+// Usage: xpm2rgba [-o out.h] file.xpm ...
+//
+// Turns the XPM images of C source files (static char arrays, as written
+// by most image editors) into arrays of RGBA pixels, so that icons can be
+// compiled in as Fl_RGB_Image and are not parsed when the program runs:
+//
+//   #include "icons.h"   // written by: xpm2rgba -o icons.h open.xpm ...
+//   Fl_RGB_Image open_icon(open_xpm_rgba, open_xpm_w, open_xpm_h, 4);
+//
+// Each array of a file is converted, its name is the name of the XPM
+// array followed by _rgba, _w and _h. Transparent pixels have alpha 0.
+// Color names are resolved with the X11 color table built into FLTK,
+// an X11 display is only opened for names that are not in it.
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fltk/hdr/Fl.h"
+#include "fltk/hdr/fl_draw.h"
+
+int fl_convert_pixmap(const char*const* cdata, uchar* out, Fl_Color bg); // in fl_draw_pixmap.cxx
+
+struct Xpm_Array {
+  char name[128];
+  char **lines;
+  int count, size;
+};
+
+static void add_line(Xpm_Array &a, const char *s, size_t n) {
+  if (a.count == a.size) {
+    a.size = a.size ? 2 * a.size : 64;
+    a.lines = (char **)realloc(a.lines, a.size * sizeof(char *));
+  }
+  char *l = (char *)malloc(n + 1);
+  memcpy(l, s, n);
+  l[n] = 0;
+  a.lines[a.count++] = l;
+}
+
+// Reads the next array of string literals, returns 0 at the end of text.
+// Adjacent literals are joined, as by the compiler.
+static const char *read_array(const char *p, Xpm_Array &a) {
+  a.count = 0;
+  a.name[0] = 0;
+  const char *brace = strchr(p, '{');
+  if (!brace) return 0;
+  // the name is the last identifier before '['
+  const char *q = brace;
+  while (q > p && *q != '[') q--;
+  const char *e = q;
+  while (e > p && isspace((uchar)e[-1])) e--;
+  const char *b = e;
+  while (b > p && (isalnum((uchar)b[-1]) || b[-1] == '_')) b--;
+  size_t n = (size_t)(e - b);
+  if (n >= sizeof(a.name)) n = sizeof(a.name) - 1;
+  memcpy(a.name, b, n);
+  a.name[n] = 0;
+  char *buf = 0;
+  size_t len = 0, cap = 0;
+  int open = 0;                 // a literal was read since the last ','
+  for (p = brace + 1; *p && *p != '}'; p++) {
+    if (*p == '/' && p[1] == '*') {
+      const char *c = strstr(p + 2, "*/");
+      if (!c) break;
+      p = c + 1;
+    } else if (*p == '"') {
+      for (p++; *p && *p != '"'; p++) {
+        char c = *p;
+        if (c == '\\' && p[1]) c = *++p; // only \" and \\ appear in XPM
+        if (len + 1 >= cap) buf = (char *)realloc(buf, cap = cap ? 2 * cap : 256);
+        buf[len++] = c;
+      }
+      open = 1;
+    } else if (*p == ',' && open) {
+      add_line(a, buf, len);
+      len = 0;
+      open = 0;
+    }
+  }
+  if (open) add_line(a, buf, len);
+  free(buf);
+  return *p ? p + 1 : p;
+}
+
+static char *read_file(const char *name) {
+  FILE *f = fopen(name, "rb");
+  if (!f) return 0;
+  fseek(f, 0, SEEK_END);
+  long n = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  char *text = (char *)malloc(n + 1);
+  n = (long)fread(text, 1, n, f);
+  text[n] = 0;
+  fclose(f);
+  return text;
+}
+
+static int convert(const char *file, FILE *out) {
+  char *text = read_file(file);
+  if (!text) {
+    fprintf(stderr, "xpm2rgba: can't read %s\n", file);
+    return 1;
+  }
+  Xpm_Array a;
+  memset(&a, 0, sizeof(a));
+  int found = 0, ret = 0;
+  for (const char *p = text; (p = read_array(p, a));) {
+    int w, h;
+    if (!a.count || !a.name[0] || !fl_measure_pixmap((const char *const *)a.lines, w, h))
+      continue;
+    uchar *rgba = new uchar[4 * w * h];
+    if (!fl_convert_pixmap((const char *const *)a.lines, rgba, FL_BLACK)) {
+      fprintf(stderr, "xpm2rgba: %s: can't convert %s\n", file, a.name);
+      ret = 1;
+    } else {
+      fprintf(out, "\n// %s from %s\n", a.name, file);
+      fprintf(out, "static const int %s_w = %d, %s_h = %d;\n", a.name, w, a.name, h);
+      fprintf(out, "static const unsigned char %s_rgba[%d] = {", a.name, 4 * w * h);
+      for (int i = 0; i < 4 * w * h; i++)
+        fprintf(out, "%s0x%02x,", i % 16 ? "" : "\n  ", rgba[i]);
+      fprintf(out, "\n};\n");
+      found++;
+    }
+    delete[] rgba;
+    for (int i = 0; i < a.count; i++) free(a.lines[i]);
+  }
+  free(a.lines);
+  free(text);
+  if (!found && !ret) {
+    fprintf(stderr, "xpm2rgba: no XPM image in %s\n", file);
+    ret = 1;
+  }
+  return ret;
+}
+
+int main(int argc, char **argv) {
+  FILE *out = stdout;
+  int i = 1;
+  if (i + 1 < argc && !strcmp(argv[i], "-o")) {
+    out = fopen(argv[i + 1], "w");
+    if (!out) {
+      fprintf(stderr, "xpm2rgba: can't write %s\n", argv[i + 1]);
+      return 1;
+    }
+    i += 2;
+  }
+  if (i >= argc) {
+    fprintf(stderr, "Usage: xpm2rgba [-o out.h] file.xpm ...\n");
+    return 1;
+  }
+  fprintf(out, "// Generated by xpm2rgba, do not edit.\n");
+  int ret = 0;
+  for (; i < argc; i++) ret |= convert(argv[i], out);
+  if (out != stdout) fclose(out);
+  return ret;
+}